@@ -0,0 +1,135 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OGLW_BARRIER_TRACKER_HPP
+#define OGLW_BARRIER_TRACKER_HPP
+
+#include <vector>
+#include <unordered_map>
+
+#include "OpenGL.hpp"
+
+namespace gl {
+	class VBO;
+	class VAO;
+	class Texture;
+	class Shader;
+
+	// How the next command accesses a resource. Each usage maps to one
+	// glMemoryBarrier bit.
+	enum ResourceUsage : uint32_t {
+		USAGE_SHADER_STORAGE = 0,
+		USAGE_IMAGE,
+		USAGE_ATOMIC_COUNTER,
+		USAGE_UNIFORM,
+		USAGE_TEXTURE_FETCH,
+		USAGE_VERTEX,
+		USAGE_INDEX,
+		USAGE_INDIRECT,
+		USAGE_PIXEL_BUFFER,
+		USAGE_TEXTURE_UPDATE,
+		USAGE_BUFFER_UPDATE,
+		USAGE_FRAMEBUFFER,
+		USAGE_TRANSFORM_FEEDBACK,
+		USAGE_QUERY_BUFFER,
+		USAGE_CLIENT_MAPPED,
+
+		USAGE_COUNT
+	};
+
+	enum ResourceAccess : uint32_t {
+		ACCESS_READ = 1,
+		ACCESS_WRITE = 2,
+		ACCESS_READ_WRITE = 3,
+	};
+
+	enum BarrierMode {
+		// issue minimal barriers automatically before each command
+		BARRIER_AUTOMATIC,
+		// do not issue barriers, report hazards not covered by barriers
+		// issued with BarrierTracker::MemoryBarrier
+		BARRIER_VALIDATE,
+	};
+
+	/*
+	 * Tracks incoherent shader writes (shader storage, image and atomic
+	 * counter) to buffers and textures. Before each command the resources it
+	 * accesses are declared with Use(), then Flush() (or one of dispatch/draw
+	 * helpers) issues glMemoryBarrier only with bits needed for declared
+	 * accesses of resources written by earlier commands.
+	 */
+	class BarrierTracker {
+	public:
+
+		BarrierTracker(BarrierMode mode = BARRIER_AUTOMATIC);
+
+		void Use(VBO& buffer, ResourceUsage usage, ResourceAccess access);
+		void Use(Texture& texture, ResourceUsage usage, ResourceAccess access);
+
+		// returns barrier bits required by accesses declared since last Flush
+		GLbitfield Flush();
+
+		void Dispatch(Shader& shader, uint32_t numGroupsX, uint32_t numGroupsY,
+				uint32_t numGroupsZ);
+		void DispatchRoundGroupNumbers(Shader& shader, uint32_t numThreadsX,
+				uint32_t numThreadsY, uint32_t numThreadsZ);
+		void DispatchBuffer(Shader& shader, VBO& dispatchBuffer,
+				uint32_t dispatchOffset);
+		void Draw(VAO& vao);
+
+		// Manually issued barrier, recorded for hazard tracking.
+		void MemoryBarrier(GLbitfield barriers);
+
+		// Forgets all pending writes, e.g. after gl::Finish().
+		void Reset();
+
+		void SetMode(BarrierMode mode);
+		inline BarrierMode GetMode() const { return mode; }
+
+		inline uint64_t GetIssuedBarriersCount() const { return issuedBarriers; }
+		inline uint64_t GetSkippedBarriersCount() const { return skippedBarriers; }
+		inline uint64_t GetReportedHazardsCount() const { return reportedHazards; }
+
+		static GLbitfield UsageBarrierBit(ResourceUsage usage);
+
+	private:
+
+		struct Access {
+			uint64_t key;
+			ResourceUsage usage;
+			ResourceAccess access;
+		};
+
+		void Use(uint64_t key, ResourceUsage usage, ResourceAccess access);
+		void StampBarrier(GLbitfield barriers, uint64_t stamp);
+
+		// epoch of command that made last incoherent write to resource
+		std::unordered_map<uint64_t, uint64_t> writeEpochs;
+		// epoch of last barrier issued with given bit, indexed by ResourceUsage
+		uint64_t barrierEpochs[USAGE_COUNT];
+		std::vector<Access> accesses;
+		uint64_t epoch;
+
+		BarrierMode mode;
+		uint64_t issuedBarriers;
+		uint64_t skippedBarriers;
+		uint64_t reportedHazards;
+	};
+}
+
+#endif
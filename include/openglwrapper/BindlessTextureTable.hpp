@@ -0,0 +1,118 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OGLW_BINDLESS_TEXTURE_TABLE_HPP
+#define OGLW_BINDLESS_TEXTURE_TABLE_HPP
+
+#include <vector>
+
+#include "Texture.hpp"
+#include "TextureArrayPool.hpp"
+#include "VBO.hpp"
+
+namespace gl {
+	/*
+	 * Shader storage buffer with one entry per registered 2D texture, so
+	 * single multi draw call can sample textures of every material indexed
+	 * by material or instance ID. GLSL side:
+	 *
+	 *   struct TextureEntry { uvec2 handle; uint layer; uint array; };
+	 *   layout(std430, binding=N) readonly buffer TextureTable {
+	 *       TextureEntry textures[];
+	 *   };
+	 *
+	 * With ARB_bindless_texture `sampler2D(entry.handle)` is sampled. Without
+	 * it registered textures are copied into layers of TextureArrayPool and
+	 * are sampled from `sampler2DArray arrays[entry.array]` at layer
+	 * `entry.layer`, arrays being bound with BindFallbackArrays().
+	 *
+	 * Handles are made resident on Use() and non-resident after not being
+	 * used for given number of frames.
+	 */
+	class BindlessTextureTable {
+	public:
+
+		struct Entry {
+			uint64_t handle;
+			uint32_t layer;
+			uint32_t array;
+		};
+
+		BindlessTextureTable(uint32_t evictAfterFrames = 8,
+				bool forceFallback = false);
+		~BindlessTextureTable();
+
+		// Returns index of texture in table or 0xFFFFFFFF on failure. In
+		// fallback mode texture contents are copied at registration, later
+		// changes of texture are not visible. Texture needs to be
+		// unregistered before it is destroyed.
+		uint32_t Register(Texture* texture);
+		void Unregister(uint32_t index);
+
+		// Needs to be called for every texture sampled in current frame,
+		// before the draw call.
+		void Use(uint32_t index);
+
+		// Call once per frame, before binding. Evicts unused handles and
+		// uploads changed entries.
+		void Update();
+
+		void Bind(uint32_t binding);
+		// binds fallback arrays to consecutive texture units
+		void BindFallbackArrays(uint32_t firstUnit);
+
+		inline bool IsBindless() const { return bindless; }
+		inline uint32_t GetResidentCount() const { return residentCount; }
+		inline uint32_t GetFallbackArraysCount() const {
+			return fallbackArrays.size();
+		}
+		inline VBO& GetBuffer() { return buffer; }
+
+	private:
+
+		struct Record {
+			Texture* texture;
+			uint64_t handle;
+			uint64_t lastUsedFrame;
+			TextureRegion region;
+			bool resident;
+		};
+
+		void MarkDirty(uint32_t index);
+		void MakeNonResident(Record& record);
+		void RebuildFallbackArrays();
+
+	private:
+
+		std::vector<Record> records;
+		std::vector<Entry> entries;
+		std::vector<uint32_t> freeIndices;
+		uint32_t dirtyBegin, dirtyEnd;
+		VBO buffer;
+
+		TextureArrayPool pool;
+		std::vector<Texture*> fallbackArrays;
+
+		uint64_t frame;
+		uint32_t evictAfterFrames;
+		uint32_t residentCount;
+		bool bindless;
+	};
+}
+
+#endif
@@ -0,0 +1,93 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OGLW_COMPUTE_PRIMITIVES_HPP
+#define OGLW_COMPUTE_PRIMITIVES_HPP
+
+#include <vector>
+#include <memory>
+
+#include "Shader.hpp"
+#include "VBO.hpp"
+#include "BarrierTracker.hpp"
+
+namespace gl {
+	/*
+	 * Data parallel building blocks running on compute shaders. All buffers
+	 * hold tightly packed 32-bit unsigned integers, accesses are declared in
+	 * given BarrierTracker so results can be consumed by later commands
+	 * tracked with the same object.
+	 *
+	 * Needs to be created after OpenGL context initialization.
+	 */
+	class ComputePrimitives {
+	public:
+
+		ComputePrimitives(BarrierTracker& barriers);
+		~ComputePrimitives();
+
+		// output[i] = input[0] + ... + input[i-1]; work-efficient (Blelloch)
+		// scan of 512 element blocks followed by recursive scan of block sums.
+		// input and output may be the same buffer.
+		void ExclusiveScan(VBO& input, VBO& output, uint32_t count);
+
+		// Stably copies elements of input whose flag is non zero into output.
+		// Element size is given by input.VertexSize() and has to be
+		// multiple of 4 bytes. Number of copied elements is written as uint
+		// at offset 0 of countBuffer, without CPU synchronization.
+		void Compact(VBO& input, VBO& flags, VBO& output, VBO& countBuffer,
+				uint32_t count);
+
+		// Stable ascending LSD radix sort of 32-bit keys with 32-bit values,
+		// 4 bits per pass. Result is written back to keys and values.
+		void RadixSort(VBO& keys, VBO& values, uint32_t count);
+
+		static const uint32_t SCAN_BLOCK_SIZE = 512;
+		static const uint32_t SORT_BLOCK_SIZE = 256;
+
+	private:
+
+		void ScanRecursive(VBO& input, VBO& output, uint32_t count,
+				uint32_t level, bool predicate);
+		void Dispatch(Shader& shader, uint32_t numGroups);
+		VBO& Scratch(std::vector<std::unique_ptr<VBO>>& buffers,
+				uint32_t id, uint32_t elements);
+
+		BarrierTracker& barriers;
+
+		Shader scanBlocks;
+		Shader scanAddOffsets;
+		Shader compactScatter;
+		Shader sortHistogram;
+		Shader sortScatter;
+
+		int scanBlocksCountLoc, scanBlocksPredicateLoc;
+		int scanAddOffsetsCountLoc;
+		int compactCountLoc, compactWordsLoc;
+		int histogramCountLoc, histogramShiftLoc;
+		int sortCountLoc, sortShiftLoc;
+
+		// block sums indexed by recursion level of scan
+		std::vector<std::unique_ptr<VBO>> scanSums;
+		// [0] offsets for compaction or histograms for radix sort,
+		// [1] and [2] ping-pong keys and values for radix sort
+		std::vector<std::unique_ptr<VBO>> temp;
+	};
+}
+
+#endif
@@ -22,8 +22,14 @@
 #include <GL/glew.h>
 
 #include <vector>
+#include <memory>
+#include <atomic>
+#include <functional>
 
 #include "Texture.hpp"
+#include "Renderbuffer.hpp"
+#include "VBO.hpp"
+#include "Sync.hpp"
 #include "OpenGL.hpp"
 
 namespace gl {
@@ -49,7 +55,49 @@ namespace gl {
 		ATTACHMENT_COLOR15 = GL_COLOR_ATTACHMENT15,
 		ATTACHMENT_NONE = GL_NONE,
 	};
+	
+	// What happens with attachment contents at Bind().
+	enum FboLoadAction : uint8_t {
+		LOAD_ACTION_LOAD,
+		LOAD_ACTION_CLEAR,
+		// contents are invalidated, pass overwrites every texel it reads
+		LOAD_ACTION_DONT_CARE,
+	};
+	
+	// What happens with attachment contents at EndPass().
+	enum FboStoreAction : uint8_t {
+		STORE_ACTION_STORE,
+		// contents are invalidated, no one reads them after the pass
+		STORE_ACTION_DISCARD,
+	};
 
+	// Finished asynchronous readback of FBO::ReadPixelsAsync().
+	class PixelReadback {
+	public:
+		
+		// Points into persistently mapped pixel pack buffer, tightly packed
+		// rows. Valid until Release().
+		const void* pixels;
+		uint32_t bytes;
+		int x, y, width, height;
+		TextureDataFormat format;
+		DataType type;
+		// sequential number of ReadPixelsAsync() call on the FBO
+		uint64_t id;
+		
+		// Returns buffer to ring, may be called from any thread.
+		void Release() const;
+		
+	private:
+		
+		friend class FBO;
+		std::atomic<uint8_t>* state;
+	};
+	
+	// Return true to keep pixels after returning, until
+	// PixelReadback::Release(), e.g. to hand them to worker thread.
+	using ReadbackCallback = std::function<bool(const PixelReadback&)>;
+	
 	class FBO {
 	public:
 		
@@ -58,7 +106,15 @@ namespace gl {
 		
 		void Destroy();
 		
-		void AttachTexture(Texture* texture, FboAttachmentType  attachmentType, uint32_t bindLocation);
+		// Textures of TEXTURE_2D_MULTISAMPLE target are attached as
+		// multisampled attachments. Array, cube map and 3D textures are
+		// attached whole as layered attachments, rendered layer is chosen
+		// with gl_Layer (see LayeredPass).
+		void AttachTexture(Texture* texture, FboAttachmentType  attachmentType, uint32_t bindLocation, uint32_t level = 0);
+		// Attaches single layer of array or 3D texture, face of cube map or
+		// layer-face (6*cube+face) of cube map array.
+		void AttachTextureLayer(Texture* texture, FboAttachmentType attachmentType, uint32_t bindLocation, uint32_t layer, uint32_t level = 0);
+		void AttachRenderbuffer(Renderbuffer* renderbuffer, FboAttachmentType attachmentType, uint32_t bindLocation);
 		void DetachTexture(FboAttachmentType  attachmentType);
 		void AttachColor(Texture* texture, int colorId, uint32_t bindLocation);
 		void DetachColor(int colorId);
@@ -69,21 +125,122 @@ namespace gl {
 		void Clear(bool color, bool depth);
 		void SetClearColor(glm::vec4 clearColor);
 		
+		/*
+		 * Load and store actions of attachments. Bind() clears attachments
+		 * with LOAD_ACTION_CLEAR, each one separately with
+		 * glClearNamedFramebuffer*, and invalidates ones with
+		 * LOAD_ACTION_DONT_CARE. EndPass() invalidates attachments with
+		 * STORE_ACTION_DISCARD, so tiled and bandwidth bound GPUs do not
+		 * write back e.g. depth or multisampled color never read again.
+		 * Invalidation covers the area set with Viewport() or whole
+		 * attachments when none was set. Clears obey scissor test.
+		 */
+		void SetLoadAction(FboAttachmentType attachmentType, FboLoadAction action);
+		void SetStoreAction(FboAttachmentType attachmentType, FboStoreAction action);
+		void SetClearValue(FboAttachmentType attachmentType, glm::vec4 value);
+		void SetClearDepthStencil(float depth, int32_t stencil);
+		
+		void ClearAttachment(FboAttachmentType attachmentType);
+		void Invalidate(const FboAttachmentType* attachmentTypes, uint32_t count);
+		
+		/*
+		 * Copies rectangle of read buffer, depth or stencil to target with
+		 * glBlitNamedFramebuffer, target == nullptr is default framebuffer.
+		 * Color is written to all draw buffers of target. Scaled blits of
+		 * color may use LINEAR filter, depth and stencil need NEAREST.
+		 * Destination is affected by scissor test.
+		 */
+		void Blit(FBO* target, int srcX0, int srcY0, int srcX1, int srcY1,
+				int dstX0, int dstY0, int dstX1, int dstY1,
+				GLbitfield mask, GLenum filter = GL_NEAREST);
+		// Resolves multisampled attachments into single sampled ones of
+		// the same size, every color attachment into attachment of the same
+		// type in target.
+		void ResolveTo(FBO& target, GLbitfield mask = GL_COLOR_BUFFER_BIT,
+				GLenum filter = GL_NEAREST);
+		void SetReadBuffer(FboAttachmentType attachmentType);
+		
+		/*
+		 * Reads rectangle of attachment into next buffer of pixel pack
+		 * buffer ring with glReadPixels and fences it, without waiting for
+		 * rendering. UpdateReadbacks() calls callback with mapped pointer
+		 * once fence signals, usually few frames later. Returns false when
+		 * every buffer of ring is in flight or kept by callbacks, so the
+		 * read is skipped. Destroy() delivers readbacks in flight, kept
+		 * ones need to be released before it.
+		 */
+		bool ReadPixelsAsync(FboAttachmentType attachmentType, int x, int y,
+				int width, int height, TextureDataFormat format,
+				DataType type, ReadbackCallback callback);
+		// Delivers finished readbacks in issue order, call once per frame.
+		// wait == true blocks until all readbacks in flight finish.
+		void UpdateReadbacks(bool wait = false);
+		// Number of pixel pack buffers, default 3. Buffers in use are kept.
+		void SetReadbackRingSize(uint32_t buffers);
+		uint32_t GetReadbacksInFlight() const;
+		
+		// size of first attachment
+		uint32_t GetWidth() const;
+		uint32_t GetHeight() const;
+		
 		void SimpleBind();
 		void Bind();
+		void EndPass();
 		static void Unbind();
 		
 		GLenum CheckStatus();
 		
 		inline uint32_t FboId() const { return fbo; }
 		
+	private:
+		
+		struct Attachment {
+			FboAttachmentType type;
+			Texture* texture;
+			Renderbuffer* renderbuffer;
+			FboLoadAction load;
+			FboStoreAction store;
+			glm::vec4 clearValue;
+		};
+		
+		Attachment* FindAttachment(FboAttachmentType attachmentType);
+		void SetAttachment(FboAttachmentType attachmentType,
+				Texture* texture, Renderbuffer* renderbuffer,
+				uint32_t bindLocation);
+		void UpdateDrawBuffers();
+		
+		enum ReadbackState : uint8_t {
+			READBACK_FREE,
+			READBACK_IN_FLIGHT,
+			READBACK_HELD,
+		};
+		
+		struct ReadbackSlot {
+			std::unique_ptr<VBO> buffer;
+			Sync fence;
+			ReadbackCallback callback;
+			PixelReadback readback;
+			std::atomic<uint8_t> state;
+		};
+		void InvalidateWhere(bool load);
+		
 	private:
 		
 		uint32_t fbo;
 		uint32_t x, y, width, height;
 		glm::vec4 clearColor;
+		float clearDepth;
+		int32_t clearStencil;
+		
+		FboAttachmentType readBuffer;
 		
 		std::vector<FboAttachmentType> attachmentBuffers;
+		std::vector<Attachment> attachments;
+		
+		std::vector<std::unique_ptr<ReadbackSlot>> readbacks;
+		uint32_t readbackHead;
+		uint64_t readbacksIssued;
+		uint64_t readbacksDelivered;
 		
 		
 		static FBO* currentlyBoundFBO;
@@ -0,0 +1,101 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OGLW_FRAME_SYNC_HPP
+#define OGLW_FRAME_SYNC_HPP
+
+#include <vector>
+
+#include "Sync.hpp"
+
+namespace gl {
+	/*
+	 * Limits number of frames CPU records ahead of GPU.
+	 *
+	 * BeginFrame() waits until the frame recorded framesInFlight frames
+	 * earlier finished on GPU, so resources written by CPU in frame N can
+	 * be reused in frame N + framesInFlight. Wait is bounded by
+	 * maxWaitNanoseconds, frames exceeding it are counted as timeouts and
+	 * not waited for further. EndFrame() fences the frame, fences are kept
+	 * in ring of framesInFlight slots.
+	 */
+	class FrameSync {
+	public:
+
+		struct Stats {
+			uint64_t frames;
+			// BeginFrame() calls that had to wait for GPU
+			uint64_t waits;
+			uint64_t timeouts;
+			// CPU time spent waiting in BeginFrame()
+			uint64_t lastWaitNanoseconds;
+			uint64_t maxWaitNanoseconds;
+			uint64_t totalWaitNanoseconds;
+
+			inline double GetAverageWaitMilliseconds() const {
+				return frames ? totalWaitNanoseconds * 1e-6 / frames : 0.0;
+			}
+		};
+
+		FrameSync(uint32_t framesInFlight = 2,
+				uint64_t maxWaitNanoseconds = 100000000);
+		FrameSync(const FrameSync&) = delete;
+		FrameSync& operator=(const FrameSync&) = delete;
+
+		// Returns id of started frame, ids start from 0.
+		uint64_t BeginFrame();
+		void EndFrame();
+
+		// True for frames that finished on GPU, false for frames not ended
+		// yet.
+		bool IsFrameComplete(uint64_t frameId);
+		// Waits for all ended frames without time limit.
+		void WaitIdle();
+
+		// Changes ring size, waits for all frames in flight.
+		void SetFramesInFlight(uint32_t framesInFlight);
+		inline uint32_t GetFramesInFlight() const { return slots.size(); }
+		inline void SetMaxWait(uint64_t nanoseconds) { maxWait = nanoseconds; }
+
+		// id of frame started by last BeginFrame()
+		inline uint64_t GetCurrentFrame() const { return nextFrame - 1; }
+		inline const Stats& GetStats() const { return stats; }
+		void ResetStats();
+
+	private:
+
+		struct Slot {
+			Sync fence;
+			uint64_t frameId = 0;
+		};
+
+		void MarkComplete(uint64_t frameId);
+
+	private:
+
+		std::vector<Slot> slots;
+		uint64_t nextFrame;
+		// frames before this id are complete
+		uint64_t completeBefore;
+		uint64_t maxWait;
+		bool frameOpen;
+		Stats stats;
+	};
+}
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OGLW_LAYERED_PASS_HPP
+#define OGLW_LAYERED_PASS_HPP
+
+#include <string>
+#include <vector>
+
+#include "Shader.hpp"
+#include "VAO.hpp"
+
+namespace gl {
+	/*
+	 * Shader drawing geometry into all layers of a layered FBO attachment
+	 * with single submission, e.g. six cube map faces or shadow cascades
+	 * of a 2D array texture.
+	 *
+	 * Vertex shader writes position in space common to all layers (e.g.
+	 * world space) to gl_Position, which is then transformed by
+	 * oglwLayerMatrices[layer] and sent to gl_Layer = layer. With
+	 * ARB_shader_viewport_layer_array or AMD_vertex_shader_layer draws are
+	 * instanced GetInstancesMultiplier() times and layer is selected in
+	 * vertex shader, which needs to use OGLW_INSTANCE_ID instead of
+	 * gl_InstanceID; per instance attributes need divisor multiplied by
+	 * GetInstancesMultiplier(). Otherwise geometry shader with invocation
+	 * per layer replicates triangles. It forwards only gl_Position, so
+	 * fragment shader cannot read vertex shader outputs, which is enough
+	 * for depth and shadow passes. Only triangle primitives are supported.
+	 *
+	 * Macros OGLW_LAYERS and OGLW_INSTANCE_ID are inserted after #version
+	 * of vertex shader.
+	 */
+	class LayeredPass {
+	public:
+
+		// guaranteed minimum of GL_MAX_GEOMETRY_SHADER_INVOCATIONS
+		static constexpr uint32_t MAX_LAYERS = 32;
+
+		// return 0 if no errors
+		int Compile(const std::string& vertexCode,
+				const std::string& fragmentCode, uint32_t layers,
+				bool forceGeometryShader = false);
+
+		// one matrix per layer
+		void SetLayerMatrices(const std::vector<glm::mat4>& matrices);
+
+		void Use();
+		// Draws vao into all layers, instances is count of user instances.
+		void Draw(VAO& vao, uint32_t instances = 1);
+		void Draw(VAO& vao, uint32_t start, uint32_t count,
+				uint32_t instances = 1);
+
+		inline Shader& GetShader() { return shader; }
+		inline uint32_t GetLayers() const { return layers; }
+		// instance count factor needed by indirect draws
+		inline uint32_t GetInstancesMultiplier() const {
+			return geometryShader ? 1 : layers;
+		}
+		inline bool UsesGeometryShader() const { return geometryShader; }
+
+		static bool HasVertexShaderLayer();
+
+	private:
+
+		Shader shader;
+		int matricesLocation = -1;
+		uint32_t layers = 0;
+		bool geometryShader = false;
+	};
+}
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OGLW_MATERIAL_DESCRIPTOR_HPP
+#define OGLW_MATERIAL_DESCRIPTOR_HPP
+
+#include <vector>
+
+#include "Texture.hpp"
+#include "Sampler.hpp"
+#include "Shader.hpp"
+
+namespace gl {
+	/*
+	 * Set of textures, samplers and images of a material. Bind() binds
+	 * contiguous range of texture units with single glBindTextures and
+	 * glBindSamplers call and image units with single glBindImageTextures
+	 * call. Units are taken from Shader::GetTextureUnit/GetImageUnit, so
+	 * no uniforms are written while drawing.
+	 *
+	 * Images are bound by multi-bind rules: level 0, all layers, read-write
+	 * access and internal format of texture.
+	 */
+	class MaterialDescriptor {
+	public:
+
+		// sampler == nullptr uses texture's own sampling parameters
+		void SetTexture(uint32_t unit, Texture* texture,
+				const Sampler* sampler = nullptr);
+		void SetImage(uint32_t unit, Texture* texture);
+
+		// Returns false when shader has no such uniform.
+		bool SetTexture(const Shader& shader, const char* uniformName,
+				Texture* texture, const Sampler* sampler = nullptr);
+		bool SetImage(const Shader& shader, const char* uniformName,
+				Texture* texture);
+
+		void Bind() const;
+		// unbinds units used by this descriptor
+		void Unbind() const;
+		void Clear();
+
+	private:
+
+		struct Range {
+			std::vector<GLuint> ids;
+			uint32_t first = 0xFFFFFFFF;
+
+			void Set(uint32_t unit, GLuint id);
+			inline GLsizei Count() const { return ids.size() - first; }
+			inline const GLuint* Ids() const { return ids.data() + first; }
+		};
+
+	private:
+
+		Range textures;
+		Range samplers;
+		Range images;
+	};
+}
+
+#endif
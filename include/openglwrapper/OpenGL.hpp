@@ -20,6 +20,9 @@
 #define OGLW_OPEN_GL_ENGINE_HPP
 
 #include <vector>
+#include <set>
+#include <string>
+#include <chrono>
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -109,6 +112,18 @@ namespace gl {
 		
 		void PushCustomError(ErrorStruct err);
 		int StackError(int line, const char* file);
+		// Stacks errors reported by debug callback since previous call with
+		// given source location. Falls back to StackError() when debug
+		// output is not available.
+		inline int StackDebugErrors(int line, const char* file) {
+			if(debugOutput == false) {
+				return StackError(line, file);
+			}
+			return pendingDebugErrors.empty() ? GL_NO_ERROR
+				: FlushDebugErrors(line, file);
+		}
+		inline bool HasDebugOutput() const { return debugOutput; }
+		// Invalidates ErrorStruct::msg of errors reported by debug callback.
 		void ClearErrors();
 		ErrorStruct PopError();
 		ErrorStruct GetLastError();
@@ -136,10 +151,41 @@ namespace gl {
 		unsigned int GetWidth() const;
 		unsigned int GetHeight() const;
 		
+		// When library is built with OGLW_HEADLESS and environment
+		// variable OGLW_HEADLESS is set to non zero, creates headless
+		// context with InitHeadless() instead of window.
 		int Init(const char* windowName, unsigned int width, unsigned int height,
 				bool resizable, bool fullscreen, bool limitFrames = true,
 				int majorOpenglVersion=4, int minorOpenglVersion=5);
 		
+		/*
+		 * Creates OpenGL context without window and X server through EGL,
+		 * e.g. with Mesa llvmpipe on machines without GPU. Uses surfaceless
+		 * platform when available. Default framebuffer is a pbuffer of
+		 * given size, or none when driver cannot create pbuffers, so
+		 * rendering to FBOs behaves the same as with window. Input
+		 * functions report no input. GLFW is not initialized, so main loops
+		 * need ShouldClose() and GetTime() instead of GLFW functions.
+		 * Needs library built with OGLW_HEADLESS, returns 3 otherwise.
+		 */
+		int InitHeadless(unsigned int width, unsigned int height,
+				int majorOpenglVersion=4, int minorOpenglVersion=5);
+		inline bool IsHeadless() const { return headless; }
+		
+		// Replacement of glfwWindowShouldClose(window) for main loops, call
+		// once per frame. Headless context has no window to close and runs
+		// until SetShouldClose(true) or until frame limit is reached. Limit
+		// is read from environment variable OGLW_HEADLESS_FRAMES by
+		// InitHeadless(), 0 means no limit.
+		bool ShouldClose();
+		void SetShouldClose(bool shouldClose);
+		inline void SetHeadlessFrameLimit(uint64_t frames) {
+			headlessFrameLimit = frames;
+		}
+		// Seconds since initialization, replacement of glfwGetTime() which
+		// does not work when GLFW cannot be initialized without display.
+		double GetTime() const;
+		
 		void SetKeyCallback(void (GLFWwindow*, int, int, int, int));
 		void SetScrollCallback(void (GLFWwindow*, double, double));
 		void SetMouseCallback(void (GLFWwindow*, double, double));
@@ -157,9 +203,35 @@ namespace gl {
 		
 		bool firstMouse;
 		
+	private:
+		
+		// Enables debug output callback with OGLW_ERROR_CHECK_DEBUG_CALLBACK.
+		void InitErrorCheck();
+		int FlushDebugErrors(int line, const char* file);
+		static void APIENTRY DebugMessageCallback(GLenum source, GLenum type,
+				GLuint id, GLenum severity, GLsizei length,
+				const GLchar* message, const void* userParam);
+		
 	private:
 		
 		std::vector<ErrorStruct> errors;
+		
+		bool debugOutput;
+		// errors reported by callback, not yet attributed to source location
+		std::vector<ErrorStruct> pendingDebugErrors;
+		// storage of callback messages pointed by ErrorStruct::msg, valid
+		// until ClearErrors()
+		std::set<std::string> debugMessages;
+		
+		bool headless;
+		bool headlessShouldClose;
+		uint64_t headlessFrames;
+		uint64_t headlessFrameLimit;
+		std::chrono::steady_clock::time_point headlessStartTime;
+		// EGLDisplay, EGLContext and EGLSurface of headless context
+		void* eglDisplay;
+		void* eglContext;
+		void* eglSurface;
 	};
 	
 	void Flush();
@@ -169,8 +241,33 @@ namespace gl {
 	extern OpenGL openGL;
 }
 
+/*
+ * Checking of OpenGL errors by GL_CHECK_* macros, selected at build time
+ * with OGLW_ERROR_CHECK:
+ *  OFF            - macros compile to nothing
+ *  DEBUG_CALLBACK - errors are reported by KHR_debug callback during the
+ *                   failing call and stacked by the next GL_CHECK_* macro
+ *                   with its source location, no glGetError round trips
+ *  GET_ERROR      - glGetError after every checked call
+ */
+#define OGLW_ERROR_CHECK_OFF 0
+#define OGLW_ERROR_CHECK_DEBUG_CALLBACK 1
+#define OGLW_ERROR_CHECK_GET_ERROR 2
+
+#ifndef OGLW_ERROR_CHECK
+#define OGLW_ERROR_CHECK OGLW_ERROR_CHECK_GET_ERROR
+#endif
+
+#if OGLW_ERROR_CHECK == OGLW_ERROR_CHECK_OFF
+#define GL_CHECK_PUSH_PRINT_ERROR {}
+#define GL_CHECK_PUSH_ERROR ((void)0)
+#elif OGLW_ERROR_CHECK == OGLW_ERROR_CHECK_DEBUG_CALLBACK
+#define GL_CHECK_PUSH_PRINT_ERROR {if(gl::openGL.StackDebugErrors(__LINE__, __FILE__)){gl::openGL.PrintError(gl::openGL.GetLastError());}}
+#define GL_CHECK_PUSH_ERROR gl::openGL.StackDebugErrors(__LINE__, __FILE__)
+#else
 #define GL_CHECK_PUSH_PRINT_ERROR {if(gl::openGL.StackError(__LINE__, __FILE__)){gl::openGL.PrintError(gl::openGL.GetLastError());}}
 #define GL_CHECK_PUSH_ERROR gl::openGL.StackError(__LINE__, __FILE__)
+#endif
 #define GL_PUSH_CUSTOM_ERROR(code, msg) gl::openGL.PushCustomError({code, msg, __FILE__, __LINE__})
 #define GL_PUSH_DEBUG_MESSAGE GL_PUSH_CUSTOM_ERROR(0, "Debug")
 
@@ -0,0 +1,156 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OGLW_PROFILER_HPP
+#define OGLW_PROFILER_HPP
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <string>
+
+#include <GL/glew.h>
+
+namespace gl {
+	/*
+	 * CPU and GPU time of nested named scopes.
+	 *
+	 * Every scope records CPU time and issues a pair of GL_TIMESTAMP
+	 * queries taken from a pool. Query results of a frame are read in a
+	 * later BeginFrame() once available, so reading never stalls. Scopes
+	 * of the same name under the same parent scope are aggregated into
+	 * statistics over the last samplesPerScope frames. Resolved frames
+	 * are kept for export to Chrome trace_event JSON (chrome://tracing,
+	 * Perfetto), with GPU timestamps moved to CPU clock.
+	 *
+	 * Scopes may be opened only between BeginFrame() and EndFrame() of
+	 * the same frame.
+	 */
+	class Profiler {
+	public:
+
+		class Scope {
+		public:
+			inline Scope(Profiler& profiler, const char* name) :
+				profiler(profiler) {
+				profiler.Push(name);
+			}
+			inline ~Scope() {
+				profiler.Pop();
+			}
+		private:
+			Profiler& profiler;
+		};
+
+		// Times in milliseconds.
+		struct ScopeStats {
+			// names of parent scopes and this scope joined with '/'
+			std::string path;
+			uint32_t depth;
+			uint64_t count;
+			double gpuMin, gpuAvg, gpuP99, gpuMax;
+			double cpuMin, cpuAvg, cpuP99, cpuMax;
+		};
+
+		Profiler(uint32_t samplesPerScope = 1024,
+				uint32_t historyFrames = 600);
+		Profiler(const Profiler&) = delete;
+		Profiler& operator=(const Profiler&) = delete;
+		~Profiler();
+
+		// Resolves finished frames and opens new one.
+		void BeginFrame();
+		void EndFrame();
+
+		void Push(const char* name);
+		void Pop();
+
+		// Resolves all ended frames, waiting for GPU.
+		void Flush();
+
+		std::vector<ScopeStats> GetStats() const;
+		void PrintStats() const;
+		bool ExportChromeTrace(const std::string& fileName) const;
+
+		inline void SetEnabled(bool enabled) { this->enabled = enabled; }
+		inline bool IsEnabled() const { return enabled; }
+		inline uint32_t GetPendingFramesCount() const { return pending.size(); }
+		// Removes statistics and history.
+		void Clear();
+
+	private:
+
+		struct Event {
+			uint32_t scope;
+			GLuint beginQuery, endQuery;
+			uint64_t cpuBegin, cpuEnd;
+			uint64_t gpuBegin, gpuEnd;
+		};
+
+		struct Frame {
+			uint64_t id;
+			std::vector<Event> events;
+			GLuint lastQuery;
+			// added to GPU timestamps gives CPU clock
+			int64_t gpuToCpu;
+		};
+
+		struct ScopeData {
+			std::string name;
+			int32_t parent;
+			uint32_t depth;
+			uint64_t count;
+			uint32_t sampleHead;
+			std::vector<uint64_t> gpuSamples, cpuSamples;
+			uint64_t gpuTotal, cpuTotal;
+			uint64_t gpuMin, gpuMax, cpuMin, cpuMax;
+		};
+
+		GLuint AllocateQuery();
+		uint32_t GetScope(int32_t parent, const char* name);
+		bool Resolve(Frame& frame, bool wait);
+		std::string GetPath(uint32_t scope) const;
+		static uint64_t CpuNow();
+
+	private:
+
+		std::vector<GLuint> freeQueries;
+		std::vector<GLuint> allQueries;
+
+		std::vector<ScopeData> scopes;
+		std::map<std::pair<int32_t, std::string>, uint32_t> scopeIds;
+
+		Frame current;
+		std::vector<uint32_t> stack;
+		std::deque<Frame> pending;
+		std::deque<Frame> history;
+		uint64_t frameCounter;
+
+		uint32_t samplesPerScope;
+		uint32_t historyFrames;
+		bool frameOpen;
+		bool enabled;
+	};
+}
+
+#define OGLW_PROFILE_CONCAT_(a, b) a##b
+#define OGLW_PROFILE_CONCAT(a, b) OGLW_PROFILE_CONCAT_(a, b)
+#define OGLW_PROFILE_SCOPE(profiler, name) \
+	gl::Profiler::Scope OGLW_PROFILE_CONCAT(oglwProfileScope, __LINE__)(profiler, name)
+
+#endif
@@ -0,0 +1,239 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OGLW_QUERY_HPP
+#define OGLW_QUERY_HPP
+
+#include <map>
+#include <vector>
+#include <memory>
+
+#include <GL/glew.h>
+
+#include "VBO.hpp"
+
+namespace gl {
+	enum QueryTarget : GLenum {
+		QUERY_SAMPLES_PASSED = GL_SAMPLES_PASSED,
+		QUERY_ANY_SAMPLES_PASSED = GL_ANY_SAMPLES_PASSED,
+		QUERY_ANY_SAMPLES_PASSED_CONSERVATIVE
+			= GL_ANY_SAMPLES_PASSED_CONSERVATIVE,
+		QUERY_PRIMITIVES_GENERATED = GL_PRIMITIVES_GENERATED,
+		QUERY_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN
+			= GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN,
+		QUERY_TIME_ELAPSED = GL_TIME_ELAPSED,
+		QUERY_TIMESTAMP = GL_TIMESTAMP,
+		
+		// ARB_pipeline_statistics_query
+		QUERY_VERTICES_SUBMITTED = GL_VERTICES_SUBMITTED_ARB,
+		QUERY_PRIMITIVES_SUBMITTED = GL_PRIMITIVES_SUBMITTED_ARB,
+		QUERY_VERTEX_SHADER_INVOCATIONS = GL_VERTEX_SHADER_INVOCATIONS_ARB,
+		QUERY_TESS_CONTROL_SHADER_PATCHES = GL_TESS_CONTROL_SHADER_PATCHES_ARB,
+		QUERY_TESS_EVALUATION_SHADER_INVOCATIONS
+			= GL_TESS_EVALUATION_SHADER_INVOCATIONS_ARB,
+		QUERY_GEOMETRY_SHADER_INVOCATIONS = GL_GEOMETRY_SHADER_INVOCATIONS,
+		QUERY_GEOMETRY_SHADER_PRIMITIVES_EMITTED
+			= GL_GEOMETRY_SHADER_PRIMITIVES_EMITTED_ARB,
+		QUERY_FRAGMENT_SHADER_INVOCATIONS
+			= GL_FRAGMENT_SHADER_INVOCATIONS_ARB,
+		QUERY_COMPUTE_SHADER_INVOCATIONS = GL_COMPUTE_SHADER_INVOCATIONS_ARB,
+		QUERY_CLIPPING_INPUT_PRIMITIVES = GL_CLIPPING_INPUT_PRIMITIVES_ARB,
+		QUERY_CLIPPING_OUTPUT_PRIMITIVES = GL_CLIPPING_OUTPUT_PRIMITIVES_ARB,
+	};
+	
+	enum QueryBufferResult : GLenum {
+		// GPU waits for result before writing it
+		QUERY_BUFFER_RESULT_WAIT = GL_QUERY_RESULT,
+		// leaves buffer untouched when result is not available
+		QUERY_BUFFER_RESULT_NO_WAIT = GL_QUERY_RESULT_NO_WAIT,
+		QUERY_BUFFER_RESULT_AVAILABLE = GL_QUERY_RESULT_AVAILABLE,
+	};
+	
+	enum ConditionalRenderMode : GLenum {
+		CONDITIONAL_RENDER_WAIT = GL_QUERY_WAIT,
+		CONDITIONAL_RENDER_NO_WAIT = GL_QUERY_NO_WAIT,
+		CONDITIONAL_RENDER_BY_REGION_WAIT = GL_QUERY_BY_REGION_WAIT,
+		CONDITIONAL_RENDER_BY_REGION_NO_WAIT = GL_QUERY_BY_REGION_NO_WAIT,
+		CONDITIONAL_RENDER_WAIT_INVERTED = GL_QUERY_WAIT_INVERTED,
+		CONDITIONAL_RENDER_NO_WAIT_INVERTED = GL_QUERY_NO_WAIT_INVERTED,
+		CONDITIONAL_RENDER_BY_REGION_WAIT_INVERTED
+			= GL_QUERY_BY_REGION_WAIT_INVERTED,
+		CONDITIONAL_RENDER_BY_REGION_NO_WAIT_INVERTED
+			= GL_QUERY_BY_REGION_NO_WAIT_INVERTED,
+	};
+	
+	class QueryPool;
+	
+	/*
+	 * Single query object. Query object is created at first use, so Query
+	 * may be constructed before OpenGL context.
+	 *
+	 * Results are read without stalling by checking IsAvailable() frames
+	 * later, or stay on GPU with WriteResult() into QUERY_BUFFER, from
+	 * where shaders and indirect draws read them after
+	 * glMemoryBarrier(GL_QUERY_BUFFER_BARRIER_BIT).
+	 */
+	class Query final {
+	public:
+		
+		Query();
+		Query(QueryTarget target);
+		Query(Query&&);
+		Query& operator=(Query&&);
+		~Query();
+		
+		Query(const Query&) = delete;
+		Query& operator=(const Query&) = delete;
+		
+		// destroys previous query object when target differs
+		void SetTarget(QueryTarget target);
+		void Destroy();
+		
+		// index selects vertex stream of PRIMITIVES_GENERATED and
+		// TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, 0 for other targets
+		void Begin(uint32_t index = 0);
+		void End();
+		// records GPU time into QUERY_TIMESTAMP query
+		void Timestamp();
+		
+		bool IsAvailable() const;
+		// Returns false when result is not available yet and wait == false.
+		bool GetResult(uint64_t& result, bool wait = false) const;
+		// Writes 64 or 32 bit result at offset bytes of buffer.
+		void WriteResult(VBO& buffer, uint32_t offset,
+				QueryBufferResult mode = QUERY_BUFFER_RESULT_WAIT,
+				bool bits64 = true) const;
+		
+		// Draws until EndConditionalRender() are discarded by GPU when
+		// this occlusion query passed no samples (inverted modes discard
+		// when it passed any).
+		void BeginConditionalRender(ConditionalRenderMode mode
+				= CONDITIONAL_RENDER_BY_REGION_WAIT) const;
+		static void EndConditionalRender();
+		
+		inline QueryTarget GetTarget() const { return target; }
+		inline GLuint GetIdGL() const { return id; }
+		inline bool IsActive() const { return active; }
+		// true when Begin()/End() or Timestamp() were called since
+		// creation
+		inline bool IsIssued() const { return issued; }
+		
+	private:
+		
+		friend class QueryPool;
+		
+		void Create();
+		
+	private:
+		
+		GLuint id;
+		QueryTarget target;
+		uint32_t index;
+		bool active;
+		bool issued;
+	};
+	
+	/*
+	 * Recycles query objects of many short living queries, eg. one
+	 * occlusion query per object per frame. Query objects of a target are
+	 * created in batches with single glGenQueries call.
+	 */
+	class QueryPool {
+	public:
+		
+		QueryPool(uint32_t batchSize = 64);
+		QueryPool(const QueryPool&) = delete;
+		QueryPool& operator=(const QueryPool&) = delete;
+		~QueryPool();
+		
+		// returned query is owned by pool
+		Query* Acquire(QueryTarget target);
+		void Release(Query* query);
+		void Clear();
+		
+		inline uint32_t GetQueriesCount() const { return queries.size(); }
+		uint32_t GetFreeCount() const;
+		
+	private:
+		
+		std::vector<std::unique_ptr<Query>> queries;
+		std::map<GLenum, std::vector<Query*>> freeQueries;
+		uint32_t batchSize;
+	};
+	
+	/*
+	 * Counts work done by GPU between Begin() and End(): pipeline
+	 * statistics of ARB_pipeline_statistics_query, primitives generated
+	 * and samples passed. Without the extension only the last two are
+	 * counted and other statistics stay 0.
+	 *
+	 * Queries of these targets can not be active elsewhere between
+	 * Begin() and End().
+	 */
+	class PipelineStatisticsQuery final {
+	public:
+		
+		// Layout of results written by WriteResults().
+		struct Statistics {
+			uint64_t verticesSubmitted;
+			uint64_t primitivesSubmitted;
+			uint64_t vertexShaderInvocations;
+			uint64_t tessControlShaderPatches;
+			uint64_t tessEvaluationShaderInvocations;
+			uint64_t geometryShaderInvocations;
+			uint64_t geometryShaderPrimitivesEmitted;
+			uint64_t fragmentShaderInvocations;
+			uint64_t computeShaderInvocations;
+			uint64_t clippingInputPrimitives;
+			uint64_t clippingOutputPrimitives;
+			uint64_t primitivesGenerated;
+			uint64_t samplesPassed;
+			
+			// fragment shader invocations per pixel of render target
+			inline double GetOverdraw(uint64_t pixels) const {
+				return pixels ? (double)fragmentShaderInvocations / pixels : 0.0;
+			}
+		};
+		
+		static constexpr uint32_t COUNTERS
+			= sizeof(Statistics) / sizeof(uint64_t);
+		
+		PipelineStatisticsQuery();
+		PipelineStatisticsQuery(const PipelineStatisticsQuery&) = delete;
+		PipelineStatisticsQuery& operator=(const PipelineStatisticsQuery&)
+			= delete;
+		
+		void Begin();
+		void End();
+		
+		bool IsAvailable() const;
+		bool GetResult(Statistics& statistics, bool wait = false) const;
+		// Writes Statistics at offset bytes of buffer, zeroes unsupported
+		// counters.
+		void WriteResults(VBO& buffer, uint32_t offset,
+				QueryBufferResult mode = QUERY_BUFFER_RESULT_WAIT) const;
+		
+		static bool IsSupported();
+		
+	private:
+		
+		Query queries[COUNTERS];
+	};
+}
+
+#endif
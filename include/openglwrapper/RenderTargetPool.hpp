@@ -0,0 +1,113 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OGLW_RENDER_TARGET_POOL_HPP
+#define OGLW_RENDER_TARGET_POOL_HPP
+
+#include <map>
+#include <vector>
+#include <memory>
+#include <initializer_list>
+
+#include "Texture.hpp"
+#include "FBO.hpp"
+
+namespace gl {
+	/*
+	 * Transient render targets of passes executed every frame.
+	 *
+	 * Acquire() returns a texture with requested size, format and sample
+	 * count that is not used by any other pass. Release() ends its lifetime,
+	 * so a pass acquiring the same description later in the frame aliases
+	 * the same texture. All targets are released at NextFrame(). Targets
+	 * not acquired for releaseAfterFrames frames are destroyed, so after
+	 * window resize targets of old size go away without recreating
+	 * everything in the resize callback.
+	 *
+	 * GetFBO() returns framebuffer with given attachment set, created and
+	 * validated once and reused as long as the set is requested.
+	 */
+	class RenderTargetPool {
+	public:
+
+		struct Desc {
+			uint32_t width, height;
+			TextureSizedInternalFormat format;
+			// values above 1 create TEXTURE_2D_MULTISAMPLE
+			uint32_t samples = 1;
+
+			bool operator==(const Desc& other) const;
+		};
+
+		struct Attachment {
+			FboAttachmentType type;
+			Texture* texture;
+		};
+
+		RenderTargetPool(uint32_t releaseAfterFrames = 3);
+		RenderTargetPool(const RenderTargetPool&) = delete;
+		RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+		~RenderTargetPool();
+
+		Texture* Acquire(const Desc& desc);
+		Texture* Acquire(uint32_t width, uint32_t height,
+				TextureSizedInternalFormat format, uint32_t samples = 1);
+		void Release(Texture* texture);
+
+		// Color attachments are bound to draw buffers in given order.
+		// Textures do not need to come from the pool.
+		FBO* GetFBO(std::initializer_list<Attachment> attachments);
+
+		void NextFrame();
+		void Clear();
+
+		inline uint32_t GetTexturesCount() const { return targets.size(); }
+		inline uint32_t GetFBOsCount() const { return fbos.size(); }
+		uint32_t GetAcquiredCount() const;
+		uint64_t GetVramUsage() const;
+
+	private:
+
+		struct Target {
+			std::unique_ptr<Texture> texture;
+			Desc desc;
+			uint64_t lastUsed;
+			bool acquired;
+		};
+
+		struct CachedFBO {
+			std::unique_ptr<FBO> fbo;
+			uint64_t lastUsed;
+		};
+
+		// pairs of attachment type and Texture::GetGeneration(), GL names
+		// can not be used as they are reused after textures are deleted
+		using FBOKey = std::vector<std::pair<GLenum, uint64_t>>;
+
+		void DestroyFBOsUsing(uint64_t textureGeneration);
+
+	private:
+
+		std::vector<Target> targets;
+		std::map<FBOKey, CachedFBO> fbos;
+		uint64_t frame;
+		uint32_t releaseAfterFrames;
+	};
+}
+
+#endif
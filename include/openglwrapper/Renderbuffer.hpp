@@ -0,0 +1,63 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OGLW_RENDERBUFFER_HPP
+#define OGLW_RENDERBUFFER_HPP
+
+#include "Texture.hpp"
+
+namespace gl {
+	/*
+	 * Render target that cannot be sampled. Suited for multisampled depth
+	 * or color that is only resolved with FBO::ResolveTo(), since driver
+	 * may keep it in compressed or on-chip layout.
+	 */
+	class Renderbuffer {
+	public:
+
+		Renderbuffer();
+		Renderbuffer(const Renderbuffer&) = delete;
+		Renderbuffer& operator=(const Renderbuffer&) = delete;
+		~Renderbuffer();
+
+		// samples <= 1 creates single sampled storage
+		void Storage(uint32_t width, uint32_t height,
+				TextureSizedInternalFormat internalFormat,
+				uint32_t samples = 1);
+		void Destroy();
+
+		inline bool Loaded() const { return renderbufferID; }
+		inline uint32_t GetIdGL() const { return renderbufferID; }
+		inline uint32_t GetWidth() const { return width; }
+		inline uint32_t GetHeight() const { return height; }
+		// actual count chosen by driver, may exceed requested one
+		inline uint32_t GetSamples() const { return samples; }
+		inline TextureSizedInternalFormat GetInternalFormat() const {
+			return internalFormat;
+		}
+		uint64_t GetVramUsage() const;
+
+	private:
+
+		uint32_t renderbufferID;
+		uint32_t width, height, samples;
+		TextureSizedInternalFormat internalFormat;
+	};
+}
+
+#endif
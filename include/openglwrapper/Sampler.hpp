@@ -0,0 +1,110 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OGLW_SAMPLER_HPP
+#define OGLW_SAMPLER_HPP
+
+#include <map>
+#include <memory>
+
+#include "Texture.hpp"
+
+namespace gl {
+	enum SamplerCompareFunc : GLenum {
+		COMPARE_NEVER = GL_NEVER,
+		COMPARE_LESS = GL_LESS,
+		COMPARE_EQUAL = GL_EQUAL,
+		COMPARE_LEQUAL = GL_LEQUAL,
+		COMPARE_GREATER = GL_GREATER,
+		COMPARE_NOTEQUAL = GL_NOTEQUAL,
+		COMPARE_GEQUAL = GL_GEQUAL,
+		COMPARE_ALWAYS = GL_ALWAYS
+	};
+
+	// Defaults are equal to OpenGL defaults.
+	struct SamplerState {
+		TextureMinFilter minFilter = NEAREST_MIPMAP_LINEAR;
+		TextureMagFilter magFilter = MAG_LINEAR;
+		TextureWrapParam wrapX = REPEAT;
+		TextureWrapParam wrapY = REPEAT;
+		TextureWrapParam wrapZ = REPEAT;
+		// values above 1 need anisotropic filtering extension, clamped to
+		// maximum supported
+		float maxAnisotropy = 1.0f;
+		float lodBias = 0.0f;
+		float minLod = -1000.0f;
+		float maxLod = 1000.0f;
+		// depth comparison for shadow samplers
+		bool compare = false;
+		SamplerCompareFunc compareFunc = COMPARE_LEQUAL;
+		float borderColor[4] = {0, 0, 0, 0};
+
+		bool operator<(const SamplerState& other) const;
+		bool operator==(const SamplerState& other) const;
+	};
+
+	/*
+	 * Sampler object overrides sampling parameters of any texture bound to
+	 * the same unit, so textures do not need their own filtering and
+	 * wrapping state.
+	 */
+	class Sampler {
+	public:
+
+		Sampler();
+		Sampler(const SamplerState& state);
+		Sampler(const Sampler&) = delete;
+		Sampler& operator=(const Sampler&) = delete;
+		~Sampler();
+
+		void Set(const SamplerState& state);
+		inline const SamplerState& GetState() const { return state; }
+
+		void Bind(uint32_t unit) const;
+		static void Unbind(uint32_t unit);
+		// Binds samplers to consecutive units with single glBindSamplers
+		// call, nullptr entries unbind.
+		static void BindSamplers(uint32_t firstUnit, uint32_t count,
+				const Sampler* const* samplers);
+
+		inline uint32_t GetIdGL() const { return samplerID; }
+
+	private:
+
+		uint32_t samplerID;
+		SamplerState state;
+	};
+
+	/*
+	 * Owns one Sampler per distinct SamplerState, textures sharing
+	 * parameters share sampler object.
+	 */
+	class SamplerCache {
+	public:
+
+		Sampler* Get(const SamplerState& state);
+		inline uint32_t GetCount() const { return samplers.size(); }
+		void Clear();
+
+	private:
+
+		std::map<SamplerState, std::unique_ptr<Sampler>> samplers;
+	};
+}
+
+#endif
@@ -21,10 +21,13 @@
 
 #include <vector>
 #include <string>
+#include <unordered_map>
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
+#include "ShaderPreprocessor.hpp"
+
 namespace gl {
 	enum ShaderType : GLenum {
 		VERTEX_SHADER = GL_VERTEX_SHADER,
@@ -34,6 +37,7 @@ namespace gl {
 	};
 	
 	class VBO;
+	class ShaderWatcher;
 
 	class Shader {
 	public:
@@ -53,11 +57,25 @@ namespace gl {
 		void DispatchRoundGroupNumbers(uint32_t numThreadsX, uint32_t numThreadsY, uint32_t numThreadsZ);
 		void DispatchBuffer(VBO& dispatchBuffer, uint32_t dispatchOffset);
 		
+		// All files read by the last Load call, including files reached
+		// through #include directives.
+		const std::vector<std::string>& GetSourceFiles() const;
+		
 		int GetUniformLocation(const char* name) const;
 		int GetAttributeLocation(const char* name) const;
 		int GetUniformLocation(const std::string& name) const;
 		int GetAttributeLocation(const std::string& name) const;
 		
+		// Texture and image units assigned to sampler and image uniforms at
+		// link time. Nonzero units given in shader with layout(binding) are
+		// kept. Binding 0 can not be told apart from no binding, so unit 0
+		// stays with the first sampler (and the first image) reading 0, and
+		// other uniforms get lowest free units in declaration order, so
+		// textures can be bound without writing sampler uniforms per draw.
+		// Returns -1 for unknown uniform.
+		int GetTextureUnit(const char* name) const;
+		int GetImageUnit(const char* name) const;
+		
 		void SetTexture(int location, class Texture* texture, uint32_t textureId);
 		void SetTextureImage(int location, class Texture* texture,
 				uint32_t unit, int32_t level, bool array,
@@ -80,6 +98,19 @@ namespace gl {
 		void SetMat4(int location, const glm::mat4 &mat);
 		void SetMat4(int location, const std::vector<glm::mat4>& array);
 		
+		// Uniform setters write through glProgramUniform* without binding the
+		// program, and skip the call when the value equals the last one written
+		// through this object. Call InvalidateUniformShadow after changing
+		// uniforms with raw OpenGL calls.
+		struct UniformWriteStats {
+			uint64_t writes;
+			uint64_t filtered;
+		};
+		void InvalidateUniformShadow();
+		UniformWriteStats GetUniformWriteStats() const;
+		void ResetUniformWriteStats();
+		static UniformWriteStats GetGlobalUniformWriteStats();
+		
 		void Destroy();
 		
 		Shader();
@@ -92,14 +123,60 @@ namespace gl {
 		
 	private:
 		
+		friend class ShaderWatcher;
+		
 		unsigned CheckBuildStatus();
+		static unsigned CheckProgramStatus(unsigned program);
+		void AssignTextureUnits();
+		void ReplaceProgram(unsigned newProgram);
+		
+		// Maps uniform locations returned to the user before hot-reload onto
+		// locations of current program.
+		inline int RemapLocation(int location) const {
+			if(location < 0 || locationRemap.empty())
+				return location;
+			if(location < (int)locationRemap.size())
+				return locationRemap[location];
+			return -1;
+		}
+		void SetSourceFiles(const ShaderPreprocessor::Result* stages, int count,
+				int compileStatus);
 		
 		static unsigned currentProgram;
 		
-		static unsigned CompileGLSL(const std::string& code, gl::ShaderType type);
+		static unsigned CompileGLSL(const std::string& code, gl::ShaderType type,
+				bool checkStatus=true);
 		static void PrintCode(const std::string& code);
 		
 		unsigned int program;
+		std::vector<std::string> sourceFiles;
+		std::vector<std::string> stagePaths;
+		// user location -> current location, empty when identity
+		mutable std::vector<int> locationRemap;
+		// current location -> user location, inverse of locationRemap
+		mutable std::unordered_map<int, int> locationInverse;
+		ShaderWatcher* watcher;
+		
+		struct UnitAssignment {
+			std::string name;
+			int unit;
+			bool image;
+		};
+		std::vector<UnitAssignment> unitAssignments;
+		
+		struct ShadowEntry {
+			uint32_t offset;
+			uint32_t bytes;
+			// bytes reserved in shadowData, reused by smaller values
+			uint32_t capacity;
+		};
+		// bytes of single element, count elements at consecutive locations
+		bool UpdateShadow(int location, const void* data, uint32_t bytes,
+				uint32_t count = 1);
+		std::vector<ShadowEntry> shadowEntries;
+		std::vector<uint8_t> shadowData;
+		UniformWriteStats uniformWriteStats;
+		static UniformWriteStats globalUniformWriteStats;
 	};
 }
 
@@ -0,0 +1,60 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OGLW_SHADER_PREPROCESSOR_HPP
+#define OGLW_SHADER_PREPROCESSOR_HPP
+
+#include <vector>
+#include <string>
+
+namespace gl {
+	/*
+	 * Resolves `#include "file"` directives of GLSL sources.
+	 *
+	 * Files are cached by normalized path and revalidated by modification
+	 * time, so a file shared by many shaders is read from disk only once.
+	 * Every included file gets its own GLSL source string number, announced
+	 * with `#line` directives, so compiler messages point at the right file
+	 * and line. `#pragma once` is supported and include cycles are reported
+	 * with `#error`.
+	 */
+	class ShaderPreprocessor {
+	public:
+
+		struct Result {
+			std::string code;
+			// files[i] is a file with GLSL source string number i, files[0]
+			// is the root file
+			std::vector<std::string> files;
+			bool success;
+		};
+
+		static Result Process(const std::string& filePath);
+
+		// Returns all cached files that directly or indirectly include
+		// filePath, together with filePath itself.
+		static std::vector<std::string> GetDependents(const std::string& filePath);
+
+		static std::string NormalizePath(const std::string& filePath);
+
+		static void Invalidate(const std::string& filePath);
+		static void ClearCache();
+	};
+}
+
+#endif
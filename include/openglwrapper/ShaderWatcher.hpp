@@ -0,0 +1,105 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OGLW_SHADER_WATCHER_HPP
+#define OGLW_SHADER_WATCHER_HPP
+
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <atomic>
+
+#include "ShaderPreprocessor.hpp"
+
+namespace gl {
+	class Shader;
+
+	/*
+	 * Optional hot-reload of shaders loaded with Shader::Load.
+	 *
+	 * A background thread watches every file reached through the include
+	 * graph of watched shaders (inotify on Linux, modification time polling
+	 * elsewhere) and preprocesses changed programs. Update(), called once per
+	 * frame on the rendering thread, compiles them without waiting for the
+	 * driver and swaps a program in only after it has linked successfully.
+	 * Without KHR_parallel_shader_compile the driver compiles synchronously,
+	 * then Update() runs one stage compilation or link per frame, so a
+	 * reload is spread over several frames, each blocking for one step.
+	 * Uniform locations, uniform values, vertex attribute locations and buffer
+	 * block bindings of the old program are carried over.
+	 *
+	 * Needs to be created after OpenGL context initialization.
+	 */
+	class ShaderWatcher {
+	public:
+
+		ShaderWatcher();
+		~ShaderWatcher();
+
+		void Watch(Shader* shader);
+		void Unwatch(Shader* shader);
+
+		void Update();
+
+		// Reloads all watched shaders depending on given file.
+		void NotifyChanged(const std::string& filePath);
+
+	private:
+
+		struct Entry {
+			std::vector<std::string> stagePaths;
+			std::vector<std::string> files;
+		};
+
+		struct Compilation {
+			Shader* shader;
+			std::vector<ShaderPreprocessor::Result> stages;
+			unsigned program;
+			std::vector<unsigned> shaders;
+			// compiled stages, stages.size() + 1 after link
+			size_t step = 0;
+		};
+
+		void Run();
+		void AddDirectories(const std::vector<std::string>& files);
+		void ProcessChanges(const std::set<std::string>& files);
+		void StartCompilation(Compilation& compilation);
+		void AdvanceCompilation(Compilation& compilation);
+		bool FinishCompilation(Compilation& compilation);
+		static void DeleteCompilation(Compilation& compilation);
+
+	private:
+
+		std::map<Shader*, Entry> shaders;
+		std::map<std::string, int> directories;
+		std::map<int, std::string> watchDescriptors;
+		std::vector<Compilation> ready;
+		std::vector<Compilation> compiling;
+
+		std::mutex mutex;
+		std::thread thread;
+		std::atomic<bool> running;
+		int inotifyFd;
+		bool parallelCompile;
+	};
+}
+
+#endif
@@ -42,9 +42,14 @@ namespace gl {
 		Sync& operator=(Sync&) = delete;
 		Sync& operator=(const Sync&) = delete;
 		
+		// destroys previous fence
 		void StartFence();
 		void Destroy();
+		// True when fence signaled or was not started. Fence is kept until
+		// Destroy() or next StartFence(), signaled state is cached so
+		// repeated queries do not reach driver.
 		bool IsDone();
+		inline bool IsStarted() const { return sync; }
 		SyncWaitResult WaitClient(uint64_t timeoutNanoseconds);
 		void WaitServer(); // what ever it does??
 		
@@ -52,6 +57,7 @@ namespace gl {
 		
 		Sync(void* glsync);
 		void* sync;
+		bool signaled;
 	};
 }
 
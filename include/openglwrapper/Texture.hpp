@@ -21,6 +21,10 @@
 
 #include <GL/glew.h>
 
+#include <string>
+#include <vector>
+#include <utility>
+
 #include "OpenGL.hpp"
 
 namespace gl {
@@ -54,10 +58,13 @@ namespace gl {
 		PROXY_TEXTURE_CUBE_MAP_ARRAY = GL_PROXY_TEXTURE_CUBE_MAP_ARRAY,
 		
 		TEXTURE_2D = GL_TEXTURE_2D,
+		TEXTURE_CUBE_MAP = GL_TEXTURE_CUBE_MAP,
 		PROXY_TEXTURE_2D = GL_PROXY_TEXTURE_2D,
 		TEXTURE_1D_ARRAY = GL_TEXTURE_1D_ARRAY,
 		PROXY_TEXTURE_1D_ARRAY = GL_PROXY_TEXTURE_1D_ARRAY,
 		TEXTURE_RECTANGLE = GL_TEXTURE_RECTANGLE,
+		TEXTURE_2D_MULTISAMPLE = GL_TEXTURE_2D_MULTISAMPLE,
+		TEXTURE_2D_MULTISAMPLE_ARRAY = GL_TEXTURE_2D_MULTISAMPLE_ARRAY,
 		PROXY_TEXTURE_RECTANGLE = GL_PROXY_TEXTURE_RECTANGLE,
 		TEXTURE_CUBE_MAP_POSITIVE_X = GL_TEXTURE_CUBE_MAP_POSITIVE_X,
 		TEXTURE_CUBE_MAP_NEGATIVE_X = GL_TEXTURE_CUBE_MAP_NEGATIVE_X,
@@ -158,20 +165,128 @@ namespace gl {
 		DEPTH_COMPONENT32F = GL_DEPTH_COMPONENT32F,
 		DEPTH_COMPONENT32 = GL_DEPTH_COMPONENT32,
 		DEPTH_COMPONENT16 = GL_DEPTH_COMPONENT16,
+		
+		// block compressed formats, 4x4 texel blocks
+		COMPRESSED_RGB_BC1 = GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+		COMPRESSED_RGBA_BC1 = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,
+		COMPRESSED_SRGB_BC1 = GL_COMPRESSED_SRGB_S3TC_DXT1_EXT,
+		COMPRESSED_SRGB_ALPHA_BC1 = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT,
+		COMPRESSED_RGBA_BC3 = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,
+		COMPRESSED_SRGB_ALPHA_BC3 = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT,
+		COMPRESSED_RED_BC4 = GL_COMPRESSED_RED_RGTC1,
+		COMPRESSED_SIGNED_RED_BC4 = GL_COMPRESSED_SIGNED_RED_RGTC1,
+		COMPRESSED_RG_BC5 = GL_COMPRESSED_RG_RGTC2,
+		COMPRESSED_SIGNED_RG_BC5 = GL_COMPRESSED_SIGNED_RG_RGTC2,
+		COMPRESSED_RGBA_BC7 = GL_COMPRESSED_RGBA_BPTC_UNORM,
+		COMPRESSED_SRGB_ALPHA_BC7 = GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM,
+	};
+	
+	// Bytes of one block of blockWidth x blockHeight texels, blocks are
+	// single texels for uncompressed formats. 24 bit depth and 12 bit per
+	// channel formats are counted with padding used by drivers.
+	struct TextureFormatInfo {
+		GLenum format;
+		uint8_t bytes;
+		uint8_t blockWidth, blockHeight;
+	};
+	
+	inline constexpr TextureFormatInfo TEXTURE_FORMATS[] = {
+		{GL_R8, 1, 1, 1}, {GL_R8_SNORM, 1, 1, 1}, {GL_R16, 2, 1, 1},
+		{GL_R16_SNORM, 2, 1, 1}, {GL_RG8, 2, 1, 1}, {GL_RG8_SNORM, 2, 1, 1},
+		{GL_RG16, 4, 1, 1}, {GL_RG16_SNORM, 4, 1, 1}, {GL_R3_G3_B2, 1, 1, 1},
+		{GL_RGB4, 2, 1, 1}, {GL_RGB5, 2, 1, 1}, {GL_RGB565, 2, 1, 1},
+		{GL_RGB8, 3, 1, 1}, {GL_RGB8_SNORM, 3, 1, 1}, {GL_RGB10, 4, 1, 1},
+		{GL_RGB12, 6, 1, 1}, {GL_RGB16, 6, 1, 1}, {GL_RGB16_SNORM, 6, 1, 1},
+		{GL_RGBA2, 1, 1, 1}, {GL_RGBA4, 2, 1, 1}, {GL_RGB5_A1, 2, 1, 1},
+		{GL_RGBA8, 4, 1, 1}, {GL_RGBA8_SNORM, 4, 1, 1}, {GL_RGB10_A2, 4, 1, 1},
+		{GL_RGB10_A2UI, 4, 1, 1}, {GL_RGBA12, 6, 1, 1}, {GL_RGBA16, 8, 1, 1},
+		{GL_RGBA16_SNORM, 8, 1, 1}, {GL_SRGB8, 3, 1, 1},
+		{GL_SRGB8_ALPHA8, 4, 1, 1},
+		{GL_R16F, 2, 1, 1}, {GL_RG16F, 4, 1, 1}, {GL_RGB16F, 6, 1, 1},
+		{GL_RGBA16F, 8, 1, 1}, {GL_R32F, 4, 1, 1}, {GL_RG32F, 8, 1, 1},
+		{GL_RGB32F, 12, 1, 1}, {GL_RGBA32F, 16, 1, 1},
+		{GL_R11F_G11F_B10F, 4, 1, 1}, {GL_RGB9_E5, 4, 1, 1},
+		{GL_R8I, 1, 1, 1}, {GL_R8UI, 1, 1, 1}, {GL_R16I, 2, 1, 1},
+		{GL_R16UI, 2, 1, 1}, {GL_R32I, 4, 1, 1}, {GL_R32UI, 4, 1, 1},
+		{GL_RG8I, 2, 1, 1}, {GL_RG8UI, 2, 1, 1}, {GL_RG16I, 4, 1, 1},
+		{GL_RG16UI, 4, 1, 1}, {GL_RG32I, 8, 1, 1}, {GL_RG32UI, 8, 1, 1},
+		{GL_RGB8I, 3, 1, 1}, {GL_RGB8UI, 3, 1, 1}, {GL_RGB16I, 6, 1, 1},
+		{GL_RGB16UI, 6, 1, 1}, {GL_RGB32I, 12, 1, 1}, {GL_RGB32UI, 12, 1, 1},
+		{GL_RGBA8I, 4, 1, 1}, {GL_RGBA8UI, 4, 1, 1}, {GL_RGBA16I, 8, 1, 1},
+		{GL_RGBA16UI, 8, 1, 1}, {GL_RGBA32I, 16, 1, 1},
+		{GL_RGBA32UI, 16, 1, 1},
+		// unsized RGBA is stored as RGBA8
+		{GL_RGBA, 4, 1, 1},
+		
+		{GL_DEPTH_COMPONENT16, 2, 1, 1}, {GL_DEPTH_COMPONENT24, 4, 1, 1},
+		{GL_DEPTH_COMPONENT32, 4, 1, 1}, {GL_DEPTH_COMPONENT32F, 4, 1, 1},
+		{GL_DEPTH24_STENCIL8, 4, 1, 1}, {GL_DEPTH32F_STENCIL8, 8, 1, 1},
+		{GL_STENCIL_INDEX8, 1, 1, 1},
+		
+		{GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 8, 4, 4},
+		{GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 8, 4, 4},
+		{GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, 8, 4, 4},
+		{GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, 8, 4, 4},
+		{GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 16, 4, 4},
+		{GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, 16, 4, 4},
+		{GL_COMPRESSED_RED_RGTC1, 8, 4, 4},
+		{GL_COMPRESSED_SIGNED_RED_RGTC1, 8, 4, 4},
+		{GL_COMPRESSED_RG_RGTC2, 16, 4, 4},
+		{GL_COMPRESSED_SIGNED_RG_RGTC2, 16, 4, 4},
+		{GL_COMPRESSED_RGBA_BPTC_UNORM, 16, 4, 4},
+		{GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM, 16, 4, 4},
+		{GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT, 16, 4, 4},
+		{GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT, 16, 4, 4},
 	};
+	
+	// bytes == 0 for unknown formats
+	constexpr TextureFormatInfo GetTextureFormatInfo(GLenum format) {
+		for(const TextureFormatInfo& info : TEXTURE_FORMATS) {
+			if(info.format == format) {
+				return info;
+			}
+		}
+		return {format, 0, 1, 1};
+	}
 
 	class Texture {
 	private:
 		
 		int width, height, depth;
 		uint32_t textureID;
+		// unique for every texture object created by any Texture
+		uint64_t generation;
 		gl::TextureTarget target;
 		uint64_t vramUsage;
 		
 		TextureSizedInternalFormat internalFormat;
 		bool hasMipmaps;
+		bool immutable;
+		bool sparse;
+		uint32_t levels;
+		uint32_t samples;
+		
+		// virtual page size of sparse texture and committed pages of levels
+		// below sparseLevels, mip tail is committed as a whole
+		uint32_t pageSizeX, pageSizeY, pageSizeZ;
+		uint32_t sparseLevels;
+		std::vector<std::vector<bool>> committedPages;
+		bool mipTailCommitted;
+		
+		// reset whenever texture object is deleted
+		uint64_t bindlessHandle;
+		TextureMinFilter minFilter;
+		
+		uint32_t memoryTag;
 		
 		void UpdateVramUsage();
+		void SetVramUsage(uint64_t bytes);
+		void CreateForStorage(gl::TextureTarget target);
+		// pages of sparse level along x (0), y (1) or layers (2)
+		uint32_t GetSparsePagesCount(uint32_t level, int axis) const;
+		inline uint32_t GetSparseLayers() const {
+			return target == TEXTURE_CUBE_MAP ? 6 : depth;
+		}
 		
 	public:
 		
@@ -180,9 +295,16 @@ namespace gl {
 		TextureSizedInternalFormat GetInternalFormat() const { return internalFormat; }
 		
 		inline bool Loaded() const { return textureID; }
+		// Changes whenever texture object is recreated, unlike GL name that
+		// is reused after deletion. 0 before first creation.
+		inline uint64_t GetGeneration() const { return generation; }
 		inline int GetWidth() const { return width; }
 		inline int GetHeight() const { return height; }
 		inline int GetDepth() const { return depth; }
+		inline bool IsImmutable() const { return immutable; }
+		inline uint32_t GetLevels() const { return levels; }
+		inline uint32_t GetSamples() const { return samples; }
+		inline gl::TextureTarget GetTarget() const { return target; }
 		
 		bool Load(const char* fileName, bool generateMipMap,
 				int forceChannelsCount=0);		// return 0 if no errors
@@ -191,6 +313,47 @@ namespace gl {
 				int forceChannelsCount=0);		// return 0 if no errors
 		
 		
+		// Immutable storage allocated with glTextureStorage*D, all mip levels
+		// are allocated up front and can not be resized later. levels == 0
+		// allocates full mip chain. Preferred for assets, use mutable
+		// Generate* for render targets that get resized.
+		void Storage1(gl::TextureTarget target,
+				uint32_t w, uint32_t levels,
+				gl::TextureSizedInternalFormat internalformat);
+		void Storage2(gl::TextureTarget target,
+				uint32_t w, uint32_t h, uint32_t levels,
+				gl::TextureSizedInternalFormat internalformat);
+		void Storage3(gl::TextureTarget target,
+				uint32_t w, uint32_t h, uint32_t d, uint32_t levels,
+				gl::TextureSizedInternalFormat internalformat);
+		
+		// Immutable storage of TEXTURE_2D_MULTISAMPLE or
+		// TEXTURE_2D_MULTISAMPLE_ARRAY with d layers. Used as render target
+		// only, sampling parameters can not be set.
+		void Storage2Multisample(gl::TextureTarget target,
+				uint32_t w, uint32_t h, uint32_t d, uint32_t samples,
+				gl::TextureSizedInternalFormat internalformat,
+				bool fixedSampleLocations=true);
+		
+		// Immutable sparse storage of ARB_sparse_texture, no memory is
+		// backing the texture until pages are committed with CommitPages.
+		// pageSizeIndex selects one of GL_VIRTUAL_PAGE_SIZE_*_ARB of format.
+		// Returns false when sparse textures are not supported or format
+		// has no such page size.
+		bool SparseStorage2(gl::TextureTarget target,
+				uint32_t w, uint32_t h, uint32_t levels,
+				gl::TextureSizedInternalFormat internalformat,
+				int pageSizeIndex=0);
+		// Region needs to be aligned to virtual page size or reach edge of
+		// level. Committing any level of mip tail commits whole tail. VRAM
+		// usage counts whole pages, each page once.
+		void CommitPages(uint32_t level, uint32_t x, uint32_t y, uint32_t z,
+				uint32_t w, uint32_t h, uint32_t d, bool commit);
+		inline bool IsSparse() const { return sparse; }
+		
+		static uint32_t GetFullMipLevelsCount(uint32_t w, uint32_t h=1,
+				uint32_t d=1);
+		
 		void Generate1(gl::TextureTarget target,
 				uint32_t w,
 				gl::TextureSizedInternalFormat internalformat,
@@ -216,6 +379,11 @@ namespace gl {
 				uint32_t w, uint32_t h,
 				uint32_t level,
 				gl::TextureDataFormat dataformat, gl::DataType datatype);
+		// uploads data already compressed in texture internal format
+		void UpdateCompressed2(const void* data,
+				uint32_t x, uint32_t y,
+				uint32_t w, uint32_t h,
+				uint32_t level, uint32_t bytes);
 		void Fetch2(void* pixels,
 				uint32_t x, uint32_t y,
 				uint32_t w, uint32_t h,
@@ -232,6 +400,10 @@ namespace gl {
 				uint32_t w, uint32_t h, uint32_t d,
 				uint32_t level,
 				gl::TextureDataFormat dataformat, gl::DataType datatype);
+		void UpdateCompressed3(const void* data,
+				uint32_t x, uint32_t y, uint32_t z,
+				uint32_t w, uint32_t h, uint32_t d,
+				uint32_t level, uint32_t bytes);
 		void Fetch3(void* pixels,
 				uint32_t x, uint32_t y, uint32_t z,
 				uint32_t w, uint32_t h, uint32_t d,
@@ -265,13 +437,48 @@ namespace gl {
 		void BindImage(uint32_t unit, int32_t level, bool array,
 				int arrayLayerId, bool read, bool write, GLenum format);
 		
+		// Bindless handle from glGetTextureHandleARB, needs to be made
+		// resident before use, see BindlessTextureTable. Texture parameters
+		// are frozen after first call. Recreating texture storage creates
+		// new handle.
+		uint64_t GetHandle();
+		// 0 when handle was not created for current texture object
+		inline uint64_t GetCreatedHandle() const { return bindlessHandle; }
+		static bool IsBindlessSupported();
+		
 		void Destroy();
 		
 		static uint8_t* LoadImageData(const char* fileName, int* width,
 				int* height, int* channels, int forceChannelsCount=0);
 		static void FreeImageData(uint8_t* imageData);
 		
+		// Memory of texture storage: exact sizes of all mip levels, layers,
+		// cube faces and samples. Sparse textures count committed pages.
+		inline uint64_t GetVramUsage() const { return vramUsage; }
+		// Tagged textures are summed per tag, empty tag removes texture
+		// from its group.
+		void SetMemoryTag(const std::string& tag);
+		std::string GetMemoryTag() const;
+		// Totals are updated whenever storage changes, reading is O(1).
 		static uint64_t CountAllTextureMemoryUsage();
+		static uint64_t CountTagMemoryUsage(const std::string& tag);
+		static std::vector<std::pair<std::string, uint64_t>>
+			CountMemoryUsageByTag();
+		// Sum of GL_TEXTURE_COMPRESSED_IMAGE_SIZE of all levels, 0 when
+		// texture is not compressed or is a cube map.
+		uint64_t QueryCompressedImageBytes() const;
+		
+		// Size in bytes of w x h x d image, rounded up to whole blocks for
+		// compressed formats.
+		static uint64_t GetImageBytes(gl::TextureSizedInternalFormat format,
+				uint32_t w, uint32_t h, uint32_t d=1);
+		static bool IsCompressedFormat(gl::TextureSizedInternalFormat format);
+		// Size in bytes of storage with given number of mip levels. d is
+		// depth of 3D textures, layers of arrays or layer-faces of cube map
+		// arrays.
+		static uint64_t GetStorageBytes(gl::TextureTarget target,
+				gl::TextureSizedInternalFormat format, uint32_t w, uint32_t h,
+				uint32_t d, uint32_t levels, uint32_t samples=1);
 		
 		Texture();
 		~Texture();
@@ -0,0 +1,109 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OGLW_TEXTURE_ARRAY_POOL_HPP
+#define OGLW_TEXTURE_ARRAY_POOL_HPP
+
+#include <vector>
+#include <map>
+#include <memory>
+
+#include <glm/glm.hpp>
+
+#include "Texture.hpp"
+
+namespace gl {
+	/*
+	 * Part of TEXTURE_2D_ARRAY. Shaders sample it with
+	 * texture(array, vec3(mix(uvRect.xy, uvRect.zw, uv), layer)), so
+	 * objects using textures from the same array can be drawn with a single
+	 * call, selecting layer and uvRect by instance or draw ID.
+	 */
+	struct TextureRegion {
+		Texture* array = nullptr;
+		uint32_t layer = 0;
+		// {u0, v0, u1, v1}
+		glm::vec4 uvRect = {0, 0, 1, 1};
+		// region in texels of array layer
+		uint32_t x = 0, y = 0, width = 0, height = 0;
+
+		inline bool Valid() const { return array != nullptr; }
+
+		void Update(const void* pixels, gl::TextureDataFormat dataformat,
+				gl::DataType datatype, uint32_t level=0) const;
+		void UpdateCompressed(const void* data, uint32_t bytes,
+				uint32_t level=0) const;
+	};
+
+	/*
+	 * Allocates whole layers of immutable TEXTURE_2D_ARRAYs grouped by size,
+	 * format and mip levels count. New array is created when all layers of
+	 * existing ones with matching parameters are taken.
+	 */
+	class TextureArrayPool {
+	public:
+
+		// layersPerArray is clamped to GL_MAX_ARRAY_TEXTURE_LAYERS
+		TextureArrayPool(uint32_t layersPerArray = 64);
+		~TextureArrayPool();
+
+		// levels == 0 allocates full mip chain
+		TextureRegion Allocate(uint32_t width, uint32_t height,
+				gl::TextureSizedInternalFormat format, uint32_t levels = 0);
+		void Free(const TextureRegion& region);
+
+		// Allocates layer and uploads image. Mip levels are generated by
+		// Flush(), once for all layers loaded since previous Flush().
+		TextureRegion Load(const char* fileName, bool generateMipMap,
+				gl::TextureSizedInternalFormat format = SRGB8_ALPHA8);
+		// Generates mip levels of arrays changed by Load(), call before
+		// sampling them, e.g. once per frame.
+		void Flush();
+
+		inline uint32_t GetArraysCount() const { return arrays.size(); }
+		uint32_t GetUsedLayersCount() const;
+
+	private:
+
+		struct Key {
+			uint32_t width, height, levels;
+			gl::TextureSizedInternalFormat format;
+			inline bool operator<(const Key& o) const {
+				if(width != o.width) return width < o.width;
+				if(height != o.height) return height < o.height;
+				if(levels != o.levels) return levels < o.levels;
+				return format < o.format;
+			}
+		};
+
+		struct Array {
+			Texture texture;
+			Key key;
+			std::vector<uint32_t> freeLayers;
+			bool mipmapsDirty = false;
+		};
+
+	private:
+
+		std::map<Key, std::vector<Array*>> byKey;
+		std::map<Texture*, std::unique_ptr<Array>> arrays;
+		uint32_t layersPerArray;
+	};
+}
+
+#endif
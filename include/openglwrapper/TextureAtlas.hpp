@@ -0,0 +1,96 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OGLW_TEXTURE_ATLAS_HPP
+#define OGLW_TEXTURE_ATLAS_HPP
+
+#include <vector>
+
+#include "TextureArrayPool.hpp"
+
+namespace gl {
+	/*
+	 * Bottom-left skyline rectangle packer. Rectangles can not be freed
+	 * individually, only whole packer can be reset.
+	 */
+	class SkylinePacker {
+	public:
+
+		SkylinePacker(uint32_t width = 0, uint32_t height = 0);
+
+		void Reset(uint32_t width, uint32_t height);
+		bool Insert(uint32_t w, uint32_t h, uint32_t& x, uint32_t& y);
+
+		// fraction of area covered by inserted rectangles
+		float GetOccupancy() const;
+
+	private:
+
+		struct Node {
+			uint32_t x, y, width;
+		};
+
+		// returns false when rectangle does not fit at skyline node
+		bool Fit(size_t index, uint32_t w, uint32_t h, uint32_t& y) const;
+
+	private:
+
+		std::vector<Node> skyline;
+		uint32_t width, height;
+		uint64_t usedArea;
+	};
+
+	/*
+	 * Packs small textures into layers of single TEXTURE_2D_ARRAY. Each
+	 * region is surrounded by `padding` texels filled with its edge texels
+	 * by Load(), which prevents bleeding of neighbours with linear
+	 * filtering. Mip levels beyond log2(padding)+1 will still bleed.
+	 */
+	class TextureAtlas {
+	public:
+
+		TextureAtlas(uint32_t size, uint32_t layers,
+				gl::TextureSizedInternalFormat format = SRGB8_ALPHA8,
+				uint32_t padding = 1, uint32_t levels = 1);
+		~TextureAtlas();
+
+		// Returns invalid region when all layers are full.
+		TextureRegion Allocate(uint32_t w, uint32_t h);
+		TextureRegion Load(const char* fileName);
+		// Uploads tightly packed RGBA8 pixels with padding filled. Only
+		// level 0 is written, call GetTexture().GenerateMipmaps() after
+		// inserting batch of images into atlas with mip levels.
+		TextureRegion Insert(const uint8_t* pixels, uint32_t w, uint32_t h);
+
+		// Forgets all regions, texture contents are left as they are.
+		void Clear();
+
+		inline Texture& GetTexture() { return texture; }
+		inline uint32_t GetLayersCount() const { return packers.size(); }
+		float GetOccupancy(uint32_t layer) const;
+
+	private:
+
+		Texture texture;
+		std::vector<SkylinePacker> packers;
+		uint32_t size;
+		uint32_t padding;
+	};
+}
+
+#endif
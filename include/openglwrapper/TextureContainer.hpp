@@ -0,0 +1,110 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OGLW_TEXTURE_CONTAINER_HPP
+#define OGLW_TEXTURE_CONTAINER_HPP
+
+#include <vector>
+#include <string>
+
+#include "Texture.hpp"
+
+namespace gl {
+	inline constexpr char COOKED_TEXTURE_MAGIC[8] = {'O', 'G', 'L', 'W', 'T',
+		'E', 'X', '1'};
+
+	/*
+	 * Layout of files written by TextureCooker. Header is followed by
+	 * `levels` pairs of uint64_t {offset, bytes}, images within a level are
+	 * ordered by layer, then by face.
+	 */
+	struct CookedTextureHeader {
+		char magic[8];
+		uint32_t format; // TextureSizedInternalFormat
+		uint32_t width, height;
+		uint32_t levels, layers, faces;
+		uint32_t reserved;
+	};
+
+	/*
+	 * Parser of GPU ready texture files: DDS (with DX10 extension header),
+	 * KTX2 without supercompression and cooked textures written by
+	 * TextureCooker. Supported are 2D textures, 2D arrays and cube maps in
+	 * BC1/BC3/BC4/BC5/BC7 or RGBA8 formats. Mip levels stored in file are
+	 * uploaded as they are, without any CPU decoding.
+	 */
+	class TextureContainer {
+	public:
+
+		struct Image {
+			const uint8_t* data;
+			uint32_t bytes;
+			uint32_t width, height;
+		};
+
+		TextureContainer();
+		TextureContainer(const TextureContainer&) = delete;
+		TextureContainer& operator=(const TextureContainer&) = delete;
+		~TextureContainer();
+
+		// Maps file into memory where mmap is available, reads whole file
+		// otherwise. Memory is owned by container.
+		bool Load(const std::string& fileName);
+		// Parses data without copying it, data needs to outlive container.
+		bool Parse(const uint8_t* data, size_t size);
+
+		// Allocates immutable storage and uploads all images. Mip chain is
+		// generated on GPU only when the file has single level and format
+		// is not compressed.
+		bool Upload(Texture& texture, bool generateMipMap=false) const;
+
+		// image of given mip level, array layer and cube face
+		const Image& GetImage(uint32_t level, uint32_t layer,
+				uint32_t face) const;
+
+		inline TextureSizedInternalFormat GetFormat() const { return format; }
+		inline uint32_t GetWidth() const { return width; }
+		inline uint32_t GetHeight() const { return height; }
+		inline uint32_t GetLevels() const { return levels; }
+		inline uint32_t GetLayers() const { return layers; }
+		inline uint32_t GetFaces() const { return faces; }
+
+		// true for file names with .dds, .ktx2 or .oglwtex extension
+		static bool IsContainerFile(const std::string& fileName);
+
+	private:
+
+		bool ParseDDS(const uint8_t* data, size_t size);
+		bool ParseKTX2(const uint8_t* data, size_t size);
+		bool ParseCooked(const uint8_t* data, size_t size);
+		void Unmap();
+
+	private:
+
+		std::vector<uint8_t> fileData;
+		void* mapped;
+		size_t mappedSize;
+		// indexed by (level * layers + layer) * faces + face
+		std::vector<Image> images;
+		TextureSizedInternalFormat format;
+		uint32_t width, height;
+		uint32_t levels, layers, faces;
+	};
+}
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OGLW_TEXTURE_COOKER_HPP
+#define OGLW_TEXTURE_COOKER_HPP
+
+#include <vector>
+#include <string>
+
+#include "Texture.hpp"
+
+namespace gl {
+	/*
+	 * Converts source images into GPU ready mip chains written in cooked
+	 * texture format read by TextureContainer. Works entirely on CPU, does
+	 * not need OpenGL context.
+	 *
+	 * Mip levels are filtered in linear space when target format is sRGB.
+	 * Supported output formats: RGBA8, SRGB8_ALPHA8, COMPRESSED_*_BC1,
+	 * COMPRESSED_*_BC3, COMPRESSED_RED_BC4 and COMPRESSED_RG_BC5.
+	 */
+	class TextureCooker {
+	public:
+
+		enum MipFilter {
+			MIP_FILTER_BOX,
+			MIP_FILTER_KAISER,
+		};
+
+		struct Settings {
+			TextureSizedInternalFormat format = SRGB8_ALPHA8;
+			MipFilter filter = MIP_FILTER_KAISER;
+			bool generateMipMap = true;
+		};
+
+		// pixels are tightly packed RGBA8
+		bool Cook(const uint8_t* pixels, uint32_t width, uint32_t height,
+				const Settings& settings);
+		bool CookFile(const std::string& fileName, const Settings& settings);
+		bool Write(const std::string& fileName) const;
+
+		inline TextureSizedInternalFormat GetFormat() const { return format; }
+		inline uint32_t GetWidth() const { return width; }
+		inline uint32_t GetHeight() const { return height; }
+		inline const std::vector<std::vector<uint8_t>>& GetLevels() const {
+			return levels;
+		}
+
+		static bool IsSupportedFormat(TextureSizedInternalFormat format);
+		static bool IsSRGBFormat(TextureSizedInternalFormat format);
+
+	private:
+
+		void Encode(const std::vector<uint8_t>& rgba, uint32_t w, uint32_t h,
+				std::vector<uint8_t>& out) const;
+
+	private:
+
+		std::vector<std::vector<uint8_t>> levels;
+		TextureSizedInternalFormat format = RGBA8;
+		uint32_t width = 0, height = 0;
+	};
+}
+
+#endif
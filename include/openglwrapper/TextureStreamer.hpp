@@ -0,0 +1,159 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OGLW_TEXTURE_STREAMER_HPP
+#define OGLW_TEXTURE_STREAMER_HPP
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "Texture.hpp"
+#include "VBO.hpp"
+#include "Sync.hpp"
+
+namespace gl {
+	class TextureStreamer;
+
+	class StreamedTexture {
+	public:
+
+		enum State {
+			QUEUED,
+			UPLOADING,
+			RESIDENT,
+			FAILED,
+		};
+
+		// Returns loaded texture when it is resident, placeholder otherwise.
+		inline Texture* Get() {
+			return state == RESIDENT ? &texture : placeholder;
+		}
+		inline State GetState() const { return state; }
+		inline bool IsResident() const { return state == RESIDENT; }
+		inline const std::string& GetFileName() const { return fileName; }
+
+		Texture texture;
+
+	private:
+
+		friend class TextureStreamer;
+
+		std::string fileName;
+		TextureSizedInternalFormat internalFormat;
+		int forceChannelsCount;
+		bool generateMipMap;
+		Texture* placeholder;
+		std::atomic<State> state;
+	};
+
+	/*
+	 * Loads textures without stalling rendering thread.
+	 *
+	 * Worker threads decode images with Texture::LoadImageData and copy
+	 * pixels into a persistently mapped pixel unpack buffer ring. Update(),
+	 * called once per frame on the rendering thread, issues uploads from the
+	 * ring up to per frame byte budget and fences them; ring space is reused
+	 * after fences signal. Images larger than the ring are uploaded from
+	 * client memory.
+	 *
+	 * Needs to be created after OpenGL context initialization.
+	 */
+	class TextureStreamer {
+	public:
+
+		// threads == 0 uses hardware concurrency - 1, at least 1
+		TextureStreamer(uint32_t threads = 0,
+				uint32_t ringBytes = 64*1024*1024,
+				uint32_t frameBudgetBytes = 8*1024*1024);
+		~TextureStreamer();
+
+		std::shared_ptr<StreamedTexture> Load(const std::string& fileName,
+				bool generateMipMap, int forceChannelsCount=0);
+		std::shared_ptr<StreamedTexture> Load(const std::string& fileName,
+				bool generateMipMap,
+				gl::TextureSizedInternalFormat forceSizedInternalFormat,
+				int forceChannelsCount=0);
+
+		void Update();
+
+		inline void SetFrameBudget(uint32_t bytes) { frameBudgetBytes = bytes; }
+		inline uint32_t GetFrameBudget() const { return frameBudgetBytes; }
+		inline uint64_t GetUploadedBytesLastFrame() const { return uploadedLastFrame; }
+		// textures requested and not yet resident or failed
+		inline uint32_t GetPendingCount() const { return pending; }
+
+		inline Texture* GetPlaceholder() { return &placeholder; }
+
+	private:
+
+		struct Staged {
+			std::shared_ptr<StreamedTexture> texture;
+			uint8_t* pixels;
+			int width, height, channels;
+			// offset of pixels in ring and bytes taken from ring, including
+			// space skipped at ring end
+			uint32_t ringOffset, ringBytes;
+			bool ready;
+		};
+
+		struct Batch {
+			Sync fence;
+			uint32_t count;
+		};
+
+		void Run();
+		bool RingAllocate(uint32_t bytes, uint32_t& offset, uint32_t& taken);
+		void Upload(Staged& staged);
+		void Retire();
+
+	private:
+
+		Texture placeholder;
+		VBO ring;
+		uint8_t* ringPointer;
+		uint32_t ringSize, ringHead, ringTail, ringUsed;
+
+		// uploads in ring allocation order, first `uploaded` of them are in
+		// flight
+		std::deque<Staged> staged;
+		uint32_t uploaded;
+		std::deque<Batch> batches;
+
+		std::deque<std::shared_ptr<StreamedTexture>> jobs;
+		// dropped or failed requests, released on rendering thread
+		std::vector<std::shared_ptr<StreamedTexture>> finished;
+
+		std::vector<std::thread> workers;
+		std::mutex mutex;
+		std::condition_variable jobsCondition;
+		std::condition_variable ringCondition;
+		bool running;
+
+		uint32_t frameBudgetBytes;
+		uint64_t uploadedLastFrame;
+		std::atomic<uint32_t> pending;
+	};
+}
+
+#endif
@@ -0,0 +1,271 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OGLW_VIRTUAL_TEXTURE_HPP
+#define OGLW_VIRTUAL_TEXTURE_HPP
+
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <list>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "Texture.hpp"
+#include "FBO.hpp"
+#include "VBO.hpp"
+#include "Sync.hpp"
+#include "Shader.hpp"
+
+namespace gl {
+	class TextureCooker;
+
+	inline constexpr char VIRTUAL_TEXTURE_MAGIC[8] = {'O', 'G', 'L', 'W', 'V',
+		'T', 'X', '1'};
+
+	/*
+	 * Layout of tiled virtual texture files. Header is followed by tiles of
+	 * every page level, levels from finest, tiles of a level in row major
+	 * order. Every tile is (tileSize + 2*border)^2 RGBA8 texels, border
+	 * texels are copied from neighbouring tiles of the same level, so any
+	 * tile is read with single seek at computable offset.
+	 */
+	struct VirtualTextureHeader {
+		char magic[8];
+		uint32_t format; // RGBA8 or SRGB8_ALPHA8
+		uint32_t width, height;
+		uint32_t tileSize, border;
+		uint32_t levels;
+		uint32_t reserved;
+	};
+
+	/*
+	 * Reader and writer of tiled virtual texture files. Width and height
+	 * need to be power of two multiples of tileSize. Page levels end at the
+	 * first level that fits in single tile.
+	 */
+	class VirtualTextureFile {
+	public:
+
+		// cooker needs RGBA8 or SRGB8_ALPHA8 levels
+		static bool Write(const std::string& fileName,
+				const TextureCooker& cooker, uint32_t tileSize = 128,
+				uint32_t border = 1);
+
+		bool Open(const std::string& fileName);
+		void Close();
+		// pixels needs GetTileBytes() bytes
+		bool ReadTile(uint32_t level, uint32_t x, uint32_t y, uint8_t* pixels);
+
+		inline const VirtualTextureHeader& GetHeader() const { return header; }
+		inline uint32_t GetTileBytes() const { return tileBytes; }
+		inline uint32_t GetPagesX(uint32_t level) const {
+			return std::max<uint32_t>((header.width/header.tileSize)>>level, 1);
+		}
+		inline uint32_t GetPagesY(uint32_t level) const {
+			return std::max<uint32_t>((header.height/header.tileSize)>>level, 1);
+		}
+		// index of first tile of level, GetFirstTile(levels) is tiles count
+		inline uint32_t GetFirstTile(uint32_t level) const {
+			return firstTile[level];
+		}
+
+		static uint32_t GetPageLevelsCount(uint32_t width, uint32_t height,
+				uint32_t tileSize);
+
+	private:
+
+		std::ifstream file;
+		VirtualTextureHeader header;
+		std::vector<uint32_t> firstTile;
+		uint32_t tileBytes = 0;
+	};
+
+	/*
+	 * Texture much larger than video memory of which only pages seen on
+	 * screen are resident.
+	 *
+	 * Each frame scene is rendered at reduced resolution between
+	 * BeginFeedback() and EndFeedback() with a fragment shader writing
+	 * VTFeedback(uv) into `layout(location=0) out uint`. EndFeedback() runs
+	 * compute pass deduplicating page IDs into short request list, which is
+	 * read back a frame later without stalling. Update() marks requested
+	 * pages and their parents as used, queues missing pages to loader
+	 * thread reading tiles from VirtualTextureFile and uploads loaded tiles,
+	 * evicting least recently used pages when cache is full. Coarsest page
+	 * level is always resident.
+	 *
+	 * With ARB_sparse_texture, when virtual page size of format equals tile
+	 * size, pages are committed with glTexPageCommitmentARB into single
+	 * sparse mip mapped texture, sampled with LOD clamped by a per page
+	 * minimum resident LOD map. Otherwise pages are stored in slots of a
+	 * physical cache texture and translated with page table texture, with
+	 * bilinear filtering of single level.
+	 *
+	 * GetGLSL() returns declarations of vtPageTable/vtCache or
+	 * vtTexture/vtMinLod samplers and functions VTFeedback(uv) and
+	 * VTSample(uv) to be pasted after #version of the shaders.
+	 */
+	class VirtualTexture {
+	public:
+
+		struct Settings {
+			// pages resident besides coarsest level
+			uint32_t cachePages = 256;
+			uint32_t uploadsPerFrame = 16;
+			// feedback is rendered at 1/feedbackDivisor of screen resolution
+			uint32_t feedbackDivisor = 8;
+			// request list capacity per frame
+			uint32_t maxRequests = 4096;
+			bool forceSoftware = false;
+		};
+
+		VirtualTexture();
+		VirtualTexture(const VirtualTexture&) = delete;
+		VirtualTexture& operator=(const VirtualTexture&) = delete;
+		~VirtualTexture();
+
+		bool Open(const std::string& fileName, const Settings& settings);
+		inline bool Open(const std::string& fileName) {
+			return Open(fileName, Settings());
+		}
+		void Destroy();
+
+		// Binds feedback FBO, sets viewport and clears it.
+		void BeginFeedback(uint32_t screenWidth, uint32_t screenHeight);
+		void EndFeedback();
+		void Update();
+
+		// binds textures to units assigned to samplers declared by GetGLSL()
+		void Bind(const Shader& shader) const;
+		inline const std::string& GetGLSL() const { return glsl; }
+
+		inline bool IsSparse() const { return sparse; }
+		// streamed pages, without always resident ones
+		inline uint32_t GetResidentPagesCount() const { return residentCount; }
+		inline uint32_t GetPendingPagesCount() const { return pendingCount; }
+		inline uint32_t GetRequestsLastFrame() const { return requestsLastFrame; }
+		inline uint32_t GetUploadsLastFrame() const { return uploadsLastFrame; }
+		inline uint32_t GetEvictionsLastFrame() const { return evictionsLastFrame; }
+		inline Texture& GetFeedbackTexture() { return feedbackColor; }
+
+		static uint32_t EncodePageId(uint32_t level, uint32_t x, uint32_t y);
+
+	private:
+
+		enum PageState : uint8_t {
+			PAGE_EMPTY,
+			PAGE_LOADING,
+			PAGE_RESIDENT,
+			PAGE_PINNED,
+			PAGE_FAILED,
+		};
+
+		struct Page {
+			std::list<uint32_t>::iterator lru;
+			uint64_t lastUsed = 0;
+			uint32_t slot = 0xFFFFFFFF;
+			PageState state = PAGE_EMPTY;
+		};
+
+		struct LoadedTile {
+			uint32_t page;
+			std::vector<uint8_t> pixels;
+			bool ok;
+		};
+
+		struct Readback {
+			Readback() : requests(sizeof(uint32_t), SHADER_STORAGE_BUFFER,
+					STREAM_DRAW) {}
+			VBO requests;
+			Sync fence;
+			bool pending = false;
+		};
+
+		void Run();
+		bool CreateSparse();
+		bool CreateSoftware();
+		void CreateFeedbackPass();
+		void GenerateGLSL();
+
+		uint32_t PageIndex(uint32_t level, uint32_t x, uint32_t y) const;
+		void DecodePage(uint32_t page, uint32_t& level, uint32_t& x,
+				uint32_t& y) const;
+		void Touch(uint32_t page);
+		void Request(uint32_t page, std::vector<uint32_t>& loads);
+		bool AllocateSlot(uint32_t& slot);
+		void Evict(uint32_t page);
+		void Upload(uint32_t page, const uint8_t* pixels);
+		void Commit(uint32_t page, bool commit);
+		void UpdatePageTable();
+
+	private:
+
+		VirtualTextureFile file;
+		Settings settings;
+		uint32_t levels;
+		bool sparse;
+		bool opened;
+
+		std::vector<Page> pages;
+		std::list<uint32_t> lru;
+		std::vector<uint32_t> freeSlots;
+		uint32_t residentCount;
+		uint32_t pendingCount;
+		uint64_t frame;
+		bool pageTableDirty;
+
+		// sparse mode
+		Texture texture;
+		Texture minLod;
+		uint32_t sparseLevels;
+
+		// software mode
+		Texture cache;
+		Texture pageTable;
+		uint32_t slotsX;
+
+		// feedback
+		FBO feedbackFbo;
+		Texture feedbackColor;
+		Texture feedbackDepth;
+		Shader dedupShader;
+		VBO seen;
+		Readback readbacks[2];
+		uint32_t readbackHead;
+		uint32_t feedbackWidth, feedbackHeight;
+		std::vector<uint32_t> requestIds;
+		std::string glsl;
+
+		uint32_t requestsLastFrame;
+		uint32_t uploadsLastFrame;
+		uint32_t evictionsLastFrame;
+
+		std::deque<uint32_t> jobs;
+		std::deque<LoadedTile> loaded;
+		std::thread worker;
+		std::mutex mutex;
+		std::condition_variable jobsCondition;
+		bool running;
+	};
+}
+
+#endif
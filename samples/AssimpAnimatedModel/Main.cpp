@@ -87,7 +87,7 @@ int main() {
 	// Init camera position
 //     camera.ProcessMouseMovement(150, -200);
 	
-	while(!glfwWindowShouldClose(gl::openGL.window)) {
+	while(!gl::openGL.ShouldClose()) {
 		DefaultIterationStart();
 		
 		if(WasPressed(GLFW_KEY_P))
@@ -2,6 +2,7 @@
 #include "../DefaultCameraAndOtherConfig.hpp"
 #include "openglwrapper/basic_mesh_loader/AssimpLoader.hpp"
 #include "openglwrapper/basic_mesh_loader/Value.hpp"
+#include "../../include/openglwrapper/ShaderWatcher.hpp"
 
 #include <cstring>
 
@@ -17,6 +18,10 @@ int main() {
 			"",
 			"../samples/AssimpModelWithShading/fragment.glsl");
 	
+	// Reload shader when its files are modified
+	gl::ShaderWatcher shaderWatcher;
+	shaderWatcher.Watch(&ourShader);
+	
 	// Load model
 	gl::BasicMeshLoader::AssimpLoader l;
 	l.Load("../samples/Monkey.fbx");
@@ -77,8 +82,9 @@ int main() {
 	// Init camera position
 //     camera.ProcessMouseMovement(150, -200);
 	
-    while(!glfwWindowShouldClose(gl::openGL.window)) {
+    while(!gl::openGL.ShouldClose()) {
 		DefaultIterationStart();
+		shaderWatcher.Update();
         
 		// Use shader
         ourShader.Use();
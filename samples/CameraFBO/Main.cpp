@@ -84,7 +84,7 @@ int main() {
 		return false;
 	}
 	
-	while(!glfwWindowShouldClose(gl::openGL.window)) {
+	while(!gl::openGL.ShouldClose()) {
 		DefaultIterationStart();
 		
 		// Use shader
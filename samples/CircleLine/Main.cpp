@@ -46,9 +46,9 @@ int main() {
 	gl::openGL.Init("Window test name 311", 800, 600, true, false);
 	gl::openGL.InitGraphic();
 	
-	glfwSetKeyCallback(gl::openGL.window, KeyCallback);
-	glfwSetCursorPosCallback(gl::openGL.window, MouseCallback);
-	glfwSetScrollCallback(gl::openGL.window, ScrollCallback);
+	gl::openGL.SetKeyCallback(KeyCallback);
+	gl::openGL.SetMouseCallback(MouseCallback);
+	gl::openGL.SetScrollCallback(ScrollCallback);
 	
 	gl::Shader shaderLine;
 	shaderLine.Load(
@@ -80,9 +80,9 @@ int main() {
 	unsigned colorLoc =    shaderLine.GetUniformLocation("color");
 	unsigned viewportloc = shaderLine.GetUniformLocation("viewport_size");
 	
-	while(!glfwWindowShouldClose(gl::openGL.window)) {
+	while(!gl::openGL.ShouldClose()) {
 		/*
-		GLfloat currentFrame = glfwGetTime();
+		GLfloat currentFrame = gl::openGL.GetTime();
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 		*/
@@ -11,6 +11,7 @@
 #include "../../include/openglwrapper/VAO.hpp"
 #include "../../include/openglwrapper/VBO.hpp"
 #include "../../include/openglwrapper/BufferAccessor.hpp"
+#include "../../include/openglwrapper/BarrierTracker.hpp"
 
 namespace ComplexCompute {
 
@@ -81,10 +82,11 @@ int main() {
 	infosBuffer.Generate(infosVbo);
 	
 	int FRAME = 0;
+	gl::BarrierTracker barriers;
 	
-    while(!glfwWindowShouldClose(gl::openGL.window) && FRAME<4) {
+    while(!gl::openGL.ShouldClose() && FRAME<4) {
 		++FRAME;
-        GLfloat currentFrame = glfwGetTime();
+        GLfloat currentFrame = gl::openGL.GetTime();
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
         glfwPollEvents();
@@ -105,24 +107,31 @@ int main() {
 			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, indirectBuffer.GetIdGL());
 			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, infosBuffer.GetIdGL());
 			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, atomicBuffer.GetIdGL());
-			computeShader.Use();
-			computeShader.Dispatch(
+			barriers.Use(indirectBuffer, gl::USAGE_SHADER_STORAGE,
+					gl::ACCESS_READ_WRITE);
+			barriers.Use(infosBuffer, gl::USAGE_SHADER_STORAGE,
+					gl::ACCESS_READ_WRITE);
+			barriers.Use(atomicBuffer, gl::USAGE_SHADER_STORAGE,
+					gl::ACCESS_READ_WRITE);
+			barriers.Dispatch(computeShader,
 					32*(OBJECTS_COUNT-1+computeShader.workgroupSize[0])/
 					computeShader.workgroupSize[0], 1, 1);
 			emptyShader.Use();
 			
-			gl::MemoryBarrier(gl::ALL_BARRIER_BITS);
+			barriers.Use(atomicBuffer, gl::USAGE_BUFFER_UPDATE,
+					gl::ACCESS_READ_WRITE);
+			barriers.Flush();
 			atomicBuffer.FetchAll(atomicVbo);
-			
-			gl::MemoryBarrier(gl::ALL_BARRIER_BITS);
 		}
 		
-		float T = (glfwGetTime()-currentFrame);
+		float T = (gl::openGL.GetTime()-currentFrame);
 		
+		barriers.Use(indirectBuffer, gl::USAGE_BUFFER_UPDATE, gl::ACCESS_READ);
+		barriers.Use(infosBuffer, gl::USAGE_BUFFER_UPDATE, gl::ACCESS_READ);
+		barriers.Flush();
 		indirectBuffer.FetchAll(indirectVbo);
 		infosBuffer.FetchAll(infosVbo);
 		atomicBuffer.FetchAll(atomicVbo);
-		gl::MemoryBarrier(gl::ALL_BARRIER_BITS);
 		
 // 		int components = *(unsigned*)&(atomicBuffer.Buffer()[0]);
 		int components = sum;
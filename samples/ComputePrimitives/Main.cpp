@@ -0,0 +1,180 @@
+#include <cstdio>
+#include <ctime>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "../../include/openglwrapper/OpenGL.hpp"
+#include "../../include/openglwrapper/VBO.hpp"
+#include "../../include/openglwrapper/BarrierTracker.hpp"
+#include "../../include/openglwrapper/ComputePrimitives.hpp"
+
+namespace ComputePrimitives {
+
+const uint32_t SIZES[] = {1, 511, 512, 513, 100000, (1<<20)+3};
+const int BENCHMARK_ITERATIONS = 8;
+
+std::mt19937 rng;
+int correct = 0, wrong = 0;
+
+void Upload(gl::VBO& vbo, const std::vector<uint32_t>& data) {
+	vbo.Generate(data.data(), data.size());
+}
+
+std::vector<uint32_t> Download(gl::VBO& vbo, uint32_t count) {
+	std::vector<uint32_t> data(count);
+	vbo.Fetch(data.data(), 0, count*sizeof(uint32_t));
+	return data;
+}
+
+void Report(const char* name, uint32_t count, bool valid, double seconds) {
+	if(valid)
+		correct++;
+	else
+		wrong++;
+	printf(" %-14s %9u elements: %s %10.2f Melements/s\n", name, count,
+			valid ? "correct" : "WRONG  ", count / seconds * 1e-6);
+}
+
+template<typename T>
+double Measure(T&& func) {
+	gl::Finish();
+	double start = gl::openGL.GetTime();
+	for(int i=0; i<BENCHMARK_ITERATIONS; ++i) {
+		func();
+	}
+	gl::Finish();
+	return (gl::openGL.GetTime() - start) / BENCHMARK_ITERATIONS;
+}
+
+void TestScan(gl::ComputePrimitives& primitives, gl::BarrierTracker& barriers,
+		uint32_t count) {
+	std::vector<uint32_t> input(count);
+	for(uint32_t& v : input) {
+		v = rng() & 0xFF;
+	}
+	gl::VBO in(sizeof(uint32_t), gl::SHADER_STORAGE_BUFFER, gl::DYNAMIC_DRAW);
+	gl::VBO out(sizeof(uint32_t), gl::SHADER_STORAGE_BUFFER, gl::DYNAMIC_DRAW);
+	Upload(in, input);
+	out.Init(count);
+
+	primitives.ExclusiveScan(in, out, count);
+	barriers.Use(out, gl::USAGE_BUFFER_UPDATE, gl::ACCESS_READ);
+	barriers.Flush();
+	std::vector<uint32_t> result = Download(out, count);
+
+	bool valid = true;
+	uint32_t sum = 0;
+	for(uint32_t i=0; i<count; ++i) {
+		valid &= result[i] == sum;
+		sum += input[i];
+	}
+
+	double t = Measure([&](){ primitives.ExclusiveScan(in, out, count); });
+	Report("exclusive scan", count, valid, t);
+}
+
+void TestCompact(gl::ComputePrimitives& primitives,
+		gl::BarrierTracker& barriers, uint32_t count) {
+	// two words per element to exercise element size other than 4 bytes
+	std::vector<uint32_t> input(count*2), flags(count), expected;
+	for(uint32_t i=0; i<count; ++i) {
+		input[i*2] = i;
+		input[i*2+1] = rng();
+		flags[i] = (rng() % 3 == 0) ? rng() | 1 : 0;
+		if(flags[i]) {
+			expected.emplace_back(input[i*2]);
+			expected.emplace_back(input[i*2+1]);
+		}
+	}
+	gl::VBO in(2*sizeof(uint32_t), gl::SHADER_STORAGE_BUFFER, gl::DYNAMIC_DRAW);
+	gl::VBO flg(sizeof(uint32_t), gl::SHADER_STORAGE_BUFFER, gl::DYNAMIC_DRAW);
+	gl::VBO out(2*sizeof(uint32_t), gl::SHADER_STORAGE_BUFFER, gl::DYNAMIC_DRAW);
+	gl::VBO cnt(sizeof(uint32_t), gl::SHADER_STORAGE_BUFFER, gl::DYNAMIC_DRAW);
+	in.Generate(input.data(), count);
+	Upload(flg, flags);
+	out.Init(count);
+	cnt.Init(1);
+
+	primitives.Compact(in, flg, out, cnt, count);
+	barriers.Use(out, gl::USAGE_BUFFER_UPDATE, gl::ACCESS_READ);
+	barriers.Use(cnt, gl::USAGE_BUFFER_UPDATE, gl::ACCESS_READ);
+	barriers.Flush();
+	uint32_t resultCount = Download(cnt, 1)[0];
+	std::vector<uint32_t> result = Download(out, expected.size());
+
+	bool valid = resultCount*2 == expected.size() && result == expected;
+
+	double t = Measure([&](){ primitives.Compact(in, flg, out, cnt, count); });
+	Report("compact", count, valid, t);
+}
+
+void TestSort(gl::ComputePrimitives& primitives, gl::BarrierTracker& barriers,
+		uint32_t count) {
+	std::vector<uint32_t> keys(count), values(count);
+	for(uint32_t i=0; i<count; ++i) {
+		// few distinct low keys check stability, high bits check all passes
+		keys[i] = (i&1) ? rng() : rng() & 0xF;
+		values[i] = i;
+	}
+	gl::VBO k(sizeof(uint32_t), gl::SHADER_STORAGE_BUFFER, gl::DYNAMIC_DRAW);
+	gl::VBO v(sizeof(uint32_t), gl::SHADER_STORAGE_BUFFER, gl::DYNAMIC_DRAW);
+	Upload(k, keys);
+	Upload(v, values);
+
+	primitives.RadixSort(k, v, count);
+	barriers.Use(k, gl::USAGE_BUFFER_UPDATE, gl::ACCESS_READ);
+	barriers.Use(v, gl::USAGE_BUFFER_UPDATE, gl::ACCESS_READ);
+	barriers.Flush();
+	std::vector<uint32_t> resultKeys = Download(k, count);
+	std::vector<uint32_t> resultValues = Download(v, count);
+
+	std::vector<uint32_t> order(count);
+	for(uint32_t i=0; i<count; ++i) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+			return keys[a] < keys[b];
+		});
+	bool valid = true;
+	for(uint32_t i=0; i<count; ++i) {
+		valid &= resultKeys[i] == keys[order[i]];
+		valid &= resultValues[i] == order[i];
+	}
+
+	Upload(k, keys);
+	double t = Measure([&](){ primitives.RadixSort(k, v, count); });
+	Report("radix sort", count, valid, t);
+}
+
+int main() {
+	rng.seed(time(nullptr));
+
+	// init open gl
+    gl::openGL.Init("Compute primitives", 800, 600, true, false);
+    gl::openGL.InitGraphic();
+
+	{
+		gl::BarrierTracker barriers;
+		gl::ComputePrimitives primitives(barriers);
+		for(uint32_t count : SIZES) {
+			TestScan(primitives, barriers, count);
+		}
+		for(uint32_t count : SIZES) {
+			TestCompact(primitives, barriers, count);
+		}
+		for(uint32_t count : SIZES) {
+			TestSort(primitives, barriers, count);
+		}
+		printf(" Correct = %i\n   Wrong = %i\n", correct, wrong);
+	}
+
+	// deinit opengl
+	gl::openGL.Destroy();
+	glfwTerminate();
+    return wrong ? 1 : 0;
+}
+
+}
+
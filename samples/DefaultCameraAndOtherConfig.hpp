@@ -32,7 +32,7 @@ static bool WasPressed(int key) {
 }
 
 static void DefaultIterationStart() {
-	float currentFrame = glfwGetTime();
+	float currentFrame = gl::openGL.GetTime();
 	deltaTime = currentFrame - lastFrame;
 	lastFrame = currentFrame;
 	
@@ -52,7 +52,7 @@ static void DefaultIterationEnd() {
 
 static void DoMovement() {
 	if(gl::openGL.WasKeyPressed(GLFW_KEY_ESCAPE)) {
-        glfwSetWindowShouldClose(gl::openGL.window, GL_TRUE);
+        gl::openGL.SetShouldClose(true);
 	}
 	float mult = 1;
 	if(gl::openGL.IsKeyDown(GLFW_KEY_LEFT_SHIFT)) {
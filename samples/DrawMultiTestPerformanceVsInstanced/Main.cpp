@@ -3,6 +3,7 @@
 #include "openglwrapper/basic_mesh_loader/AssimpLoader.hpp"
 #include "openglwrapper/basic_mesh_loader/Value.hpp"
 #include "../../include/openglwrapper/BufferAccessor.hpp"
+#include "../../include/openglwrapper/Profiler.hpp"
 
 #include <cstring>
 
@@ -159,10 +160,13 @@ int main() {
 	// Init camera position
 //     camera.ProcessMouseMovement(150, -200);
 	
+	gl::Profiler profiler;
+	
 	int frameCount = 0;
 	float start = -1;
-    while(!glfwWindowShouldClose(gl::openGL.window)) {
+    while(!gl::openGL.ShouldClose()) {
 		DefaultIterationStart();
+		profiler.BeginFrame();
 		if(start < 0)
 			start = lastFrame;
 		frameCount++;
@@ -194,16 +198,20 @@ int main() {
 
 		
 		// Draw VAO
-		vao.DrawMultiElementsIndirect(nullptr, MAX_OBJECTS);
+		{
+			OGLW_PROFILE_SCOPE(profiler, "DrawMultiElementsIndirect");
+			vao.DrawMultiElementsIndirect(nullptr, MAX_OBJECTS);
+		}
 		// Draw VAO
 // 		vao.SetInstances(objectsToRender);
 // 		vao.Draw();
 
         
+		profiler.EndFrame();
 		DefaultIterationEnd();
 		
 		printf(" fps = %f vertices=%ld, triangles=%ld, instances=%i   => all triangles = %lli\n",
-				((float)frameCount)/(glfwGetTime()-start),
+				((float)frameCount)/(gl::openGL.GetTime()-start),
 				Vbo.size() / vbo.VertexSize(),
 				Ebo.size() / indices.VertexSize(),
 				objectsToRender,
@@ -211,6 +219,10 @@ int main() {
 				);
     }
 	
+	profiler.Flush();
+	profiler.PrintStats();
+	profiler.ExportChromeTrace("DrawMultiTestPerformanceVsInstanced.trace.json");
+	
 	gl::openGL.Destroy();
 	glfwTerminate();
 	
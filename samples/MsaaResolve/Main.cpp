@@ -0,0 +1,186 @@
+#include <cstdio>
+#include <cstdlib>
+
+#include <vector>
+
+#include "../../include/openglwrapper/OpenGL.hpp"
+#include "../../include/openglwrapper/Shader.hpp"
+#include "../../include/openglwrapper/Texture.hpp"
+#include "../../include/openglwrapper/FBO.hpp"
+#include "../../include/openglwrapper/VAO.hpp"
+
+namespace MsaaResolve {
+
+const uint32_t WIDTH = 1920, HEIGHT = 1080;
+const uint32_t SAMPLES[] = {2, 4, 8};
+const int BENCHMARK_ITERATIONS = 32;
+
+int correct = 0, wrong = 0;
+
+const char* FULLSCREEN_VERTEX = R"(
+#version 450 core
+void main() {
+	vec2 pos = vec2((gl_VertexID & 1) * 4 - 1, (gl_VertexID & 2) * 2 - 1);
+	gl_Position = vec4(pos, 0, 1);
+}
+)";
+
+// edges of rotated triangles give varying coverage inside pixels
+const char* SCENE_VERTEX = R"(
+#version 450 core
+out vec3 color;
+void main() {
+	float a = float(gl_VertexID) * 2.39996;
+	float r = 0.2 + 0.8 * fract(float(gl_VertexID) * 0.618);
+	gl_Position = vec4(cos(a) * r, sin(a) * r, 0, 1);
+	color = vec3(fract(a), fract(r * 7.0), fract(a * r));
+}
+)";
+
+const char* SCENE_FRAGMENT = R"(
+#version 450 core
+in vec3 color;
+out vec4 fragColor;
+void main() {
+	fragColor = vec4(color, 1);
+}
+)";
+
+const char* RESOLVE_FRAGMENT = R"(
+#version 450 core
+uniform sampler2DMS source;
+uniform int samples;
+out vec4 fragColor;
+void main() {
+	ivec2 coord = ivec2(gl_FragCoord.xy);
+	vec4 sum = vec4(0);
+	for(int i=0; i<samples; ++i) {
+		sum += texelFetch(source, coord, i);
+	}
+	fragColor = sum / float(samples);
+}
+)";
+
+template<typename T>
+double Measure(T&& func) {
+	func();
+	gl::Finish();
+	double start = gl::openGL.GetTime();
+	for(int i=0; i<BENCHMARK_ITERATIONS; ++i) {
+		func();
+	}
+	gl::Finish();
+	return (gl::openGL.GetTime() - start) / BENCHMARK_ITERATIONS;
+}
+
+// samples is count allocated by driver
+void Report(const char* name, uint32_t samples, double seconds) {
+	// every sample read once and every resolved texel written once
+	const double bytes = (double)WIDTH*HEIGHT*4*(samples+1);
+	printf(" %-14s %ux: %8.3f ms %8.2f GB/s\n", name, samples,
+			seconds*1000.0, bytes / seconds * 1e-9);
+}
+
+std::vector<uint8_t> Download(gl::Texture& texture) {
+	std::vector<uint8_t> pixels(WIDTH*HEIGHT*4);
+	texture.Fetch2(pixels.data(), 0, 0, WIDTH, HEIGHT, 0, gl::RGBA,
+			gl::UNSIGNED_BYTE, pixels.size());
+	return pixels;
+}
+
+void Benchmark(uint32_t samples, gl::Shader& scene, gl::Shader& resolve,
+		gl::VAO& vao) {
+	gl::Texture msaaColor, blitColor, shaderColor;
+	msaaColor.Storage2Multisample(gl::TEXTURE_2D_MULTISAMPLE, WIDTH, HEIGHT,
+			1, samples, gl::RGBA8);
+	blitColor.Storage2(gl::TEXTURE_2D, WIDTH, HEIGHT, 1, gl::RGBA8);
+	shaderColor.Storage2(gl::TEXTURE_2D, WIDTH, HEIGHT, 1, gl::RGBA8);
+	gl::Renderbuffer msaaDepth;
+	msaaDepth.Storage(WIDTH, HEIGHT, gl::DEPTH_COMPONENT32F, samples);
+
+	gl::FBO msaa, blitTarget, shaderTarget;
+	msaa.AttachTexture(&msaaColor, gl::ATTACHMENT_COLOR0, 0);
+	msaa.AttachRenderbuffer(&msaaDepth, gl::ATTACHMENT_DEPTH, 0);
+	blitTarget.AttachTexture(&blitColor, gl::ATTACHMENT_COLOR0, 0);
+	shaderTarget.AttachTexture(&shaderColor, gl::ATTACHMENT_COLOR0, 0);
+	if(msaa.CheckStatus() != GL_FRAMEBUFFER_COMPLETE
+			|| blitTarget.CheckStatus() != GL_FRAMEBUFFER_COMPLETE
+			|| shaderTarget.CheckStatus() != GL_FRAMEBUFFER_COMPLETE) {
+		printf(" %ux MSAA framebuffer incomplete\n", samples);
+		wrong++;
+		return;
+	}
+
+	// depth is only needed while rendering the scene
+	msaa.SetLoadAction(gl::ATTACHMENT_COLOR0, gl::LOAD_ACTION_CLEAR);
+	msaa.SetLoadAction(gl::ATTACHMENT_DEPTH, gl::LOAD_ACTION_CLEAR);
+	msaa.SetStoreAction(gl::ATTACHMENT_DEPTH, gl::STORE_ACTION_DISCARD);
+	msaa.Bind();
+	msaa.Viewport(0, 0, WIDTH, HEIGHT);
+	scene.Use();
+	vao.DrawArrays(0, 3*300);
+	msaa.EndPass();
+
+	const int samplesLocation = resolve.GetUniformLocation("samples");
+	const int sourceLocation = resolve.GetUniformLocation("source");
+	auto shaderResolve = [&]() {
+		shaderTarget.Bind();
+		shaderTarget.Viewport(0, 0, WIDTH, HEIGHT);
+		resolve.Use();
+		resolve.SetInt(samplesLocation, msaaColor.GetSamples());
+		resolve.SetTexture(sourceLocation, &msaaColor, 0);
+		vao.DrawArrays(0, 3);
+	};
+
+	double blitTime = Measure([&](){ msaa.ResolveTo(blitTarget); });
+	double shaderTime = Measure(shaderResolve);
+	gl::FBO::Unbind();
+
+	std::vector<uint8_t> a = Download(blitColor), b = Download(shaderColor);
+	uint32_t differ = 0;
+	for(size_t i=0; i<a.size(); ++i) {
+		differ += abs((int)a[i] - (int)b[i]) > 1;
+	}
+	if(differ == 0) {
+		correct++;
+	} else {
+		wrong++;
+		printf(" %ux resolve results differ in %u bytes\n", samples, differ);
+	}
+	Report("blit resolve", msaaColor.GetSamples(), blitTime);
+	Report("shader resolve", msaaColor.GetSamples(), shaderTime);
+}
+
+int main() {
+	// init open gl
+	gl::openGL.Init("MSAA resolve", 800, 600, true, false);
+	gl::openGL.InitGraphic();
+
+	{
+		gl::Shader scene, resolve;
+		if(scene.Compile(SCENE_VERTEX, "", SCENE_FRAGMENT)
+				|| resolve.Compile(FULLSCREEN_VERTEX, "", RESOLVE_FRAGMENT)) {
+			gl::openGL.Destroy();
+			glfwTerminate();
+			return 1;
+		}
+		gl::VAO vao(gl::TRIANGLES);
+		vao.Init();
+
+		GLint maxSamples = 1;
+		glGetIntegerv(GL_MAX_COLOR_TEXTURE_SAMPLES, &maxSamples);
+		for(uint32_t samples : SAMPLES) {
+			if((GLint)samples <= maxSamples) {
+				Benchmark(samples, scene, resolve, vao);
+			}
+		}
+		printf(" Correct = %i\n   Wrong = %i\n", correct, wrong);
+	}
+
+	// deinit opengl
+	gl::openGL.Destroy();
+	glfwTerminate();
+	return wrong ? 1 : 0;
+}
+
+}
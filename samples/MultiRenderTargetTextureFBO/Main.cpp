@@ -69,7 +69,7 @@ int main() {
 	gl::Texture* drawingTexture = &renderTextureColor;
 	Camera camera2;
 	
-	while(!glfwWindowShouldClose(gl::openGL.window)) {
+	while(!gl::openGL.ShouldClose()) {
 		DefaultIterationStart();
 		
 		if(renderTextureColor.GetWidth() != gl::openGL.GetWidth() ||
@@ -73,7 +73,7 @@ int main() {
 	ourShader.SetTexture(ourShader.GetUniformLocation("ourTexture1"), &texture,
 			0);
 	
-	while(!glfwWindowShouldClose(gl::openGL.window)) {
+	while(!gl::openGL.ShouldClose()) {
 		DefaultIterationStart();
 		
 		ourShader.Use();
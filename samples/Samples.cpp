@@ -53,6 +53,14 @@ namespace MultiRenderTargetTextureFBO {
 	int main();
 }
 
+namespace ComputePrimitives {
+	int main();
+}
+
+namespace MsaaResolve {
+	int main();
+}
+
 
 
 struct Entry {
@@ -108,6 +116,14 @@ const Entry entries[] = {
 	{
 		"multi_render_target_texture_fbo",
 		MultiRenderTargetTextureFBO::main
+	},
+	{
+		"compute_primitives",
+		ComputePrimitives::main
+	},
+	{
+		"msaa_resolve",
+		MsaaResolve::main
 	}
 };
 
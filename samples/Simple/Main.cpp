@@ -56,7 +56,7 @@ int main() {
 	GLint viewLoc = ourShader.GetUniformLocation("view");
 	GLint projLoc = ourShader.GetUniformLocation("projection");
 
-	while(!glfwWindowShouldClose(gl::openGL.window)) {
+	while(!gl::openGL.ShouldClose()) {
 		DefaultIterationStart();
 
 		ourShader.Use();
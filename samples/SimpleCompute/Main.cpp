@@ -10,6 +10,7 @@
 #include "../../include/openglwrapper/VAO.hpp"
 #include "../../include/openglwrapper/VBO.hpp"
 #include "../../include/openglwrapper/BufferAccessor.hpp"
+#include "../../include/openglwrapper/BarrierTracker.hpp"
 
 namespace SimpleCompute {
 	
@@ -55,12 +56,15 @@ int main() {
 		destinyBuffer.BindBufferBase(gl::SHADER_STORAGE_BUFFER, 5);
 		
 		// call compute shader
-		computeShader.Use();
-		computeShader.Dispatch(128, 1, 1);
+		gl::BarrierTracker barriers;
+		barriers.Use(sourceBuffer, gl::USAGE_SHADER_STORAGE, gl::ACCESS_READ);
+		barriers.Use(destinyBuffer, gl::USAGE_SHADER_STORAGE, gl::ACCESS_WRITE);
+		barriers.Dispatch(computeShader, 128, 1, 1);
 		emptyShader.Use();
 				
 		// fetch data
-		gl::MemoryBarrier(gl::ALL_BARRIER_BITS);
+		barriers.Use(destinyBuffer, gl::USAGE_BUFFER_UPDATE, gl::ACCESS_READ);
+		barriers.Flush();
 		destinyBuffer.FetchAll(Dst);
 		
 		// validate data
@@ -56,7 +56,7 @@ int main() {
 	// Init camera position
     camera.ProcessMouseMovement(150, 200);
 	
-    while(!glfwWindowShouldClose(gl::openGL.window)) {
+    while(!gl::openGL.ShouldClose()) {
 		DefaultIterationStart();
         
 		// Use shader
@@ -0,0 +1,191 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+
+#include "../include/openglwrapper/OpenGL.hpp"
+#include "../include/openglwrapper/VBO.hpp"
+#include "../include/openglwrapper/VAO.hpp"
+#include "../include/openglwrapper/Texture.hpp"
+#include "../include/openglwrapper/Shader.hpp"
+
+#include "../include/openglwrapper/BarrierTracker.hpp"
+
+namespace gl {
+
+namespace {
+	enum ResourceKind : uint64_t {
+		RESOURCE_BUFFER = 1,
+		RESOURCE_TEXTURE = 2,
+	};
+
+	inline uint64_t MakeKey(ResourceKind kind, uint32_t id) {
+		return (((uint64_t)kind) << 32) | id;
+	}
+
+	// Only writes made by shaders through these paths are incoherent and need
+	// a barrier, all other writes are ordered by OpenGL itself.
+	inline bool IsIncoherentWrite(ResourceUsage usage) {
+		return usage == USAGE_SHADER_STORAGE || usage == USAGE_IMAGE
+			|| usage == USAGE_ATOMIC_COUNTER;
+	}
+}
+
+BarrierTracker::BarrierTracker(BarrierMode mode) : mode(mode) {
+	epoch = 0;
+	issuedBarriers = 0;
+	skippedBarriers = 0;
+	reportedHazards = 0;
+	Reset();
+}
+
+GLbitfield BarrierTracker::UsageBarrierBit(ResourceUsage usage) {
+	static const GLbitfield bits[USAGE_COUNT] = {
+		SHADER_STORAGE_BARRIER_BIT,
+		SHADER_IMAGE_ACCESS_BARRIER_BIT,
+		ATOMIC_COUNTER_BARRIER_BIT,
+		UNIFORM_BARRIER_BIT,
+		TEXTURE_FETCH_BARRIER_BIT,
+		VERTEX_ATTRIB_ARRAY_BARRIER_BIT,
+		ELEMENT_ARRAY_BARRIER_BIT,
+		COMMAND_BARRIER_BIT,
+		PIXEL_BUFFER_BARRIER_BIT,
+		TEXTURE_UPDATE_BARRIER_BIT,
+		BUFFER_UPDATE_BARRIER_BIT,
+		FRAMEBUFFER_BARRIER_BIT,
+		TRANSFORM_FEEDBACK_BARRIER_BIT,
+		QUERY_BUFFER_BARRIER_BIT,
+		CLIENT_MAPPED_BUFFER_BARRIER_BIT,
+	};
+	return usage < USAGE_COUNT ? bits[usage] : 0;
+}
+
+void BarrierTracker::Use(VBO& buffer, ResourceUsage usage,
+		ResourceAccess access) {
+	Use(MakeKey(RESOURCE_BUFFER, buffer.GetIdGL()), usage, access);
+}
+
+void BarrierTracker::Use(Texture& texture, ResourceUsage usage,
+		ResourceAccess access) {
+	Use(MakeKey(RESOURCE_TEXTURE, texture.GetTexture()), usage, access);
+}
+
+void BarrierTracker::Use(uint64_t key, ResourceUsage usage,
+		ResourceAccess access) {
+	if(usage >= USAGE_COUNT) {
+		GL_PUSH_CUSTOM_ERROR(-1, "BarrierTracker::Use: invalid resource usage");
+		return;
+	}
+	accesses.push_back({key, usage, access});
+}
+
+GLbitfield BarrierTracker::Flush() {
+	++epoch;
+	GLbitfield required = 0;
+	for(const Access& a : accesses) {
+		auto it = writeEpochs.find(a.key);
+		if(it == writeEpochs.end()) {
+			continue;
+		}
+		// hazard when no barrier with needed bit was issued after last write
+		if(barrierEpochs[a.usage] <= it->second) {
+			required |= UsageBarrierBit(a.usage);
+		}
+	}
+
+	if(required) {
+		if(mode == BARRIER_AUTOMATIC) {
+			gl::MemoryBarrier(required);
+			StampBarrier(required, epoch);
+			++issuedBarriers;
+		} else {
+			++reportedHazards;
+			printf("\n ERROR::BARRIER_TRACKER::MISSING_BARRIER: bits 0x%X\n",
+					required);
+			GL_PUSH_CUSTOM_ERROR(-1, "BarrierTracker: missing memory barrier "
+					"before command");
+			// report each hazard only once
+			StampBarrier(required, epoch);
+		}
+	} else {
+		++skippedBarriers;
+	}
+
+	for(const Access& a : accesses) {
+		if((a.access & ACCESS_WRITE) && IsIncoherentWrite(a.usage)) {
+			writeEpochs[a.key] = epoch;
+		}
+	}
+	accesses.clear();
+	return required;
+}
+
+void BarrierTracker::Dispatch(Shader& shader, uint32_t numGroupsX,
+		uint32_t numGroupsY, uint32_t numGroupsZ) {
+	Flush();
+	shader.Use();
+	shader.Dispatch(numGroupsX, numGroupsY, numGroupsZ);
+}
+
+void BarrierTracker::DispatchRoundGroupNumbers(Shader& shader,
+		uint32_t numThreadsX, uint32_t numThreadsY, uint32_t numThreadsZ) {
+	Flush();
+	shader.Use();
+	shader.DispatchRoundGroupNumbers(numThreadsX, numThreadsY, numThreadsZ);
+}
+
+void BarrierTracker::DispatchBuffer(Shader& shader, VBO& dispatchBuffer,
+		uint32_t dispatchOffset) {
+	Use(dispatchBuffer, USAGE_INDIRECT, ACCESS_READ);
+	Flush();
+	shader.Use();
+	shader.DispatchBuffer(dispatchBuffer, dispatchOffset);
+}
+
+void BarrierTracker::Draw(VAO& vao) {
+	Flush();
+	vao.Draw();
+}
+
+void BarrierTracker::MemoryBarrier(GLbitfield barriers) {
+	gl::MemoryBarrier(barriers);
+	// barrier covers all commands issued so far
+	StampBarrier(barriers, epoch+1);
+}
+
+void BarrierTracker::StampBarrier(GLbitfield barriers, uint64_t stamp) {
+	for(uint32_t i=0; i<USAGE_COUNT; ++i) {
+		if(barriers & UsageBarrierBit((ResourceUsage)i)) {
+			barrierEpochs[i] = stamp;
+		}
+	}
+}
+
+void BarrierTracker::Reset() {
+	writeEpochs.clear();
+	accesses.clear();
+	for(uint64_t& e : barrierEpochs) {
+		e = 0;
+	}
+}
+
+void BarrierTracker::SetMode(BarrierMode mode) {
+	this->mode = mode;
+}
+
+} // namespace gl
@@ -0,0 +1,211 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "../include/openglwrapper/OpenGL.hpp"
+
+#include "../include/openglwrapper/BindlessTextureTable.hpp"
+
+namespace gl {
+
+BindlessTextureTable::BindlessTextureTable(uint32_t evictAfterFrames,
+		bool forceFallback) :
+	buffer(sizeof(Entry), SHADER_STORAGE_BUFFER, DYNAMIC_DRAW),
+	evictAfterFrames(evictAfterFrames) {
+	bindless = Texture::IsBindlessSupported() && !forceFallback;
+	dirtyBegin = 0xFFFFFFFF;
+	dirtyEnd = 0;
+	frame = 0;
+	residentCount = 0;
+}
+
+BindlessTextureTable::~BindlessTextureTable() {
+	for(Record& record : records) {
+		MakeNonResident(record);
+	}
+}
+
+uint32_t BindlessTextureTable::Register(Texture* texture) {
+	if(texture == nullptr || texture->Loaded() == false) {
+		return 0xFFFFFFFF;
+	}
+	Record record{texture, 0, frame, {}, false};
+	Entry entry{0, 0, 0};
+	if(bindless) {
+		record.handle = entry.handle = texture->GetHandle();
+		if(record.handle == 0) {
+			return 0xFFFFFFFF;
+		}
+	} else {
+		if(texture->GetTarget() != TEXTURE_2D) {
+			GL_PUSH_CUSTOM_ERROR(-1, "BindlessTextureTable fallback supports "
+					"only TEXTURE_2D textures");
+			return 0xFFFFFFFF;
+		}
+		const uint32_t w = texture->GetWidth(), h = texture->GetHeight();
+		const uint32_t levels = std::max<uint32_t>(texture->GetLevels(), 1);
+		record.region = pool.Allocate(w, h, texture->GetInternalFormat(),
+				levels);
+		if(record.region.Valid() == false) {
+			return 0xFFFFFFFF;
+		}
+		for(uint32_t level=0; level<levels; ++level) {
+			glCopyImageSubData(texture->GetTexture(), GL_TEXTURE_2D, level,
+					0, 0, 0, record.region.array->GetTexture(),
+					GL_TEXTURE_2D_ARRAY, level, 0, 0, record.region.layer,
+					std::max<uint32_t>(w>>level, 1),
+					std::max<uint32_t>(h>>level, 1), 1);
+		}
+		GL_CHECK_PUSH_PRINT_ERROR;
+		entry.layer = record.region.layer;
+		auto it = std::find(fallbackArrays.begin(), fallbackArrays.end(),
+				record.region.array);
+		entry.array = it - fallbackArrays.begin();
+		if(it == fallbackArrays.end()) {
+			fallbackArrays.emplace_back(record.region.array);
+		}
+	}
+
+	uint32_t index;
+	if(freeIndices.size()) {
+		index = freeIndices.back();
+		freeIndices.pop_back();
+		records[index] = record;
+		entries[index] = entry;
+	} else {
+		index = records.size();
+		records.emplace_back(record);
+		entries.emplace_back(entry);
+	}
+	MarkDirty(index);
+	return index;
+}
+
+void BindlessTextureTable::Unregister(uint32_t index) {
+	Record& record = records[index];
+	if(record.texture == nullptr) {
+		return;
+	}
+	MakeNonResident(record);
+	const bool fallback = record.region.Valid();
+	if(fallback) {
+		pool.Free(record.region);
+	}
+	record = Record{nullptr, 0, 0, {}, false};
+	entries[index] = Entry{0, 0, 0};
+	MarkDirty(index);
+	freeIndices.emplace_back(index);
+	if(fallback) {
+		// pool destroys arrays with no layers in use
+		RebuildFallbackArrays();
+	}
+}
+
+void BindlessTextureTable::Use(uint32_t index) {
+	Record& record = records[index];
+	record.lastUsedFrame = frame;
+	if(!bindless) {
+		return;
+	}
+	if(record.texture->GetCreatedHandle() != record.handle) {
+		// texture object was recreated, old handle died with it
+		if(record.resident) {
+			record.resident = false;
+			--residentCount;
+		}
+		record.handle = entries[index].handle = record.texture->GetHandle();
+		MarkDirty(index);
+	}
+	if(!record.resident && record.handle) {
+		glMakeTextureHandleResidentARB(record.handle);
+		record.resident = true;
+		++residentCount;
+	}
+}
+
+void BindlessTextureTable::Update() {
+	++frame;
+	for(Record& record : records) {
+		if(record.resident && record.lastUsedFrame + evictAfterFrames < frame) {
+			MakeNonResident(record);
+		}
+	}
+
+	if(dirtyBegin < dirtyEnd) {
+		if(buffer.GetVertexCount() < entries.size()) {
+			buffer.Generate(entries.data(), entries.size());
+		} else {
+			buffer.Update(entries.data() + dirtyBegin, dirtyBegin*sizeof(Entry),
+					(dirtyEnd - dirtyBegin)*sizeof(Entry));
+		}
+		dirtyBegin = 0xFFFFFFFF;
+		dirtyEnd = 0;
+	}
+}
+
+void BindlessTextureTable::Bind(uint32_t binding) {
+	buffer.BindBufferBase(SHADER_STORAGE_BUFFER, binding);
+}
+
+void BindlessTextureTable::BindFallbackArrays(uint32_t firstUnit) {
+	std::vector<GLuint> textures(fallbackArrays.size());
+	for(size_t i=0; i<textures.size(); ++i) {
+		textures[i] = fallbackArrays[i]->GetTexture();
+	}
+	glBindTextures(firstUnit, textures.size(), textures.data());
+	GL_CHECK_PUSH_ERROR;
+}
+
+void BindlessTextureTable::MarkDirty(uint32_t index) {
+	dirtyBegin = std::min(dirtyBegin, index);
+	dirtyEnd = std::max(dirtyEnd, index+1);
+}
+
+void BindlessTextureTable::MakeNonResident(Record& record) {
+	if(record.resident == false) {
+		return;
+	}
+	// handle of deleted texture is already gone
+	if(record.texture->GetCreatedHandle() == record.handle) {
+		glMakeTextureHandleNonResidentARB(record.handle);
+	}
+	record.resident = false;
+	--residentCount;
+}
+
+void BindlessTextureTable::RebuildFallbackArrays() {
+	fallbackArrays.clear();
+	for(uint32_t i=0; i<records.size(); ++i) {
+		if(records[i].region.Valid() == false) {
+			continue;
+		}
+		auto it = std::find(fallbackArrays.begin(), fallbackArrays.end(),
+				records[i].region.array);
+		const uint32_t array = it - fallbackArrays.begin();
+		if(it == fallbackArrays.end()) {
+			fallbackArrays.emplace_back(records[i].region.array);
+		}
+		if(entries[i].array != array) {
+			entries[i].array = array;
+			MarkDirty(i);
+		}
+	}
+}
+
+} // namespace gl
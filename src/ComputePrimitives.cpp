@@ -0,0 +1,400 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "../include/openglwrapper/OpenGL.hpp"
+
+#include "../include/openglwrapper/ComputePrimitives.hpp"
+
+namespace gl {
+
+namespace {
+	// Work groups are laid out in 2D to exceed the limit of 65535 groups per
+	// dimension, groups past the end of data return immediately.
+	const char* HEADER_GLSL = R"(
+#version 450 core
+layout(local_size_x = 256) in;
+uint GroupId() {
+	return gl_WorkGroupID.x + gl_WorkGroupID.y * gl_NumWorkGroups.x;
+}
+)";
+
+	const char* SCAN_BLOCKS_GLSL = R"(
+layout(std430, binding = 0) readonly buffer Input { uint inputData[]; };
+layout(std430, binding = 1) writeonly buffer Output { uint outputData[]; };
+layout(std430, binding = 2) writeonly buffer BlockSums { uint blockSums[]; };
+uniform uint count;
+uniform uint predicate;
+shared uint temp[512];
+void main() {
+	uint block = GroupId();
+	uint t = gl_LocalInvocationID.x;
+	uint a = block * 512u + t;
+	uint b = a + 256u;
+	if(block * 512u >= count) {
+		return;
+	}
+	uint va = a < count ? inputData[a] : 0u;
+	uint vb = b < count ? inputData[b] : 0u;
+	if(predicate != 0u) {
+		va = va != 0u ? 1u : 0u;
+		vb = vb != 0u ? 1u : 0u;
+	}
+	temp[t] = va;
+	temp[t + 256u] = vb;
+
+	uint offset = 1u;
+	for(uint d = 256u; d > 0u; d >>= 1) {
+		barrier();
+		if(t < d) {
+			uint ai = offset * (2u * t + 1u) - 1u;
+			uint bi = offset * (2u * t + 2u) - 1u;
+			temp[bi] += temp[ai];
+		}
+		offset <<= 1;
+	}
+	barrier();
+	if(t == 0u) {
+		blockSums[block] = temp[511];
+		temp[511] = 0u;
+	}
+	for(uint d = 1u; d < 512u; d <<= 1) {
+		offset >>= 1;
+		barrier();
+		if(t < d) {
+			uint ai = offset * (2u * t + 1u) - 1u;
+			uint bi = offset * (2u * t + 2u) - 1u;
+			uint x = temp[ai];
+			temp[ai] = temp[bi];
+			temp[bi] += x;
+		}
+	}
+	barrier();
+	if(a < count) {
+		outputData[a] = temp[t];
+	}
+	if(b < count) {
+		outputData[b] = temp[t + 256u];
+	}
+}
+)";
+
+	const char* SCAN_ADD_OFFSETS_GLSL = R"(
+layout(std430, binding = 1) buffer Output { uint outputData[]; };
+layout(std430, binding = 2) readonly buffer BlockOffsets { uint blockOffsets[]; };
+uniform uint count;
+void main() {
+	uint block = GroupId();
+	uint a = block * 512u + gl_LocalInvocationID.x;
+	uint b = a + 256u;
+	if(block == 0u || block * 512u >= count) {
+		return;
+	}
+	uint offset = blockOffsets[block];
+	if(a < count) {
+		outputData[a] += offset;
+	}
+	if(b < count) {
+		outputData[b] += offset;
+	}
+}
+)";
+
+	const char* COMPACT_SCATTER_GLSL = R"(
+layout(std430, binding = 0) readonly buffer Input { uint inputData[]; };
+layout(std430, binding = 1) readonly buffer Flags { uint flags[]; };
+layout(std430, binding = 2) readonly buffer Offsets { uint offsets[]; };
+layout(std430, binding = 3) writeonly buffer Output { uint outputData[]; };
+layout(std430, binding = 4) writeonly buffer Count { uint outputCount; };
+uniform uint count;
+uniform uint words;
+void main() {
+	uint i = GroupId() * 256u + gl_LocalInvocationID.x;
+	if(i >= count) {
+		return;
+	}
+	uint o = offsets[i];
+	bool keep = flags[i] != 0u;
+	if(keep) {
+		for(uint w = 0u; w < words; ++w) {
+			outputData[o * words + w] = inputData[i * words + w];
+		}
+	}
+	if(i == count - 1u) {
+		outputCount = o + (keep ? 1u : 0u);
+	}
+}
+)";
+
+	// Histograms are stored digit major, so that their exclusive scan gives
+	// global output offset of each digit of each block.
+	const char* SORT_HISTOGRAM_GLSL = R"(
+layout(std430, binding = 0) readonly buffer Keys { uint keys[]; };
+layout(std430, binding = 1) writeonly buffer Histograms { uint histograms[]; };
+uniform uint count;
+uniform uint shift;
+shared uint counts[16];
+void main() {
+	uint block = GroupId();
+	uint numBlocks = (count + 255u) / 256u;
+	uint t = gl_LocalInvocationID.x;
+	if(block >= numBlocks) {
+		return;
+	}
+	if(t < 16u) {
+		counts[t] = 0u;
+	}
+	barrier();
+	uint i = block * 256u + t;
+	if(i < count) {
+		atomicAdd(counts[(keys[i] >> shift) & 15u], 1u);
+	}
+	barrier();
+	if(t < 16u) {
+		histograms[t * numBlocks + block] = counts[t];
+	}
+}
+)";
+
+	// Block is sorted locally by digit with four stable 1-bit splits, then
+	// each element is written at global offset of its digit increased by its
+	// rank among elements with the same digit within block.
+	const char* SORT_SCATTER_GLSL = R"(
+layout(std430, binding = 0) readonly buffer KeysIn { uint keysIn[]; };
+layout(std430, binding = 1) readonly buffer ValuesIn { uint valuesIn[]; };
+layout(std430, binding = 2) readonly buffer Offsets { uint offsets[]; };
+layout(std430, binding = 3) writeonly buffer KeysOut { uint keysOut[]; };
+layout(std430, binding = 4) writeonly buffer ValuesOut { uint valuesOut[]; };
+uniform uint count;
+uniform uint shift;
+shared uint scan[256];
+shared uint digits[256];
+shared uint digitStart[16];
+void main() {
+	uint block = GroupId();
+	uint numBlocks = (count + 255u) / 256u;
+	uint t = gl_LocalInvocationID.x;
+	if(block >= numBlocks) {
+		return;
+	}
+	uint i = block * 256u + t;
+	bool valid = i < count;
+	uint key = valid ? keysIn[i] : 0xFFFFFFFFu;
+	uint value = valid ? valuesIn[i] : 0u;
+	uint digit = (key >> shift) & 15u;
+	uint pos = t;
+
+	for(uint bit = 0u; bit < 4u; ++bit) {
+		uint b = (digit >> bit) & 1u;
+		scan[pos] = 1u - b;
+		barrier();
+		for(uint o = 1u; o < 256u; o <<= 1) {
+			uint x = t >= o ? scan[t - o] : 0u;
+			barrier();
+			scan[t] += x;
+			barrier();
+		}
+		uint falsesBefore = scan[pos] - (1u - b);
+		uint totalFalses = scan[255];
+		barrier();
+		pos = b == 0u ? falsesBefore : totalFalses + pos - falsesBefore;
+	}
+
+	digits[pos] = digit;
+	barrier();
+	if(pos == 0u || digits[pos - 1u] != digit) {
+		digitStart[digit] = pos;
+	}
+	barrier();
+	if(valid) {
+		uint dst = offsets[digit * numBlocks + block] + pos - digitStart[digit];
+		keysOut[dst] = key;
+		valuesOut[dst] = value;
+	}
+}
+)";
+
+	void CompilePrimitive(Shader& shader, const char* code) {
+		if(shader.Compile(std::string(HEADER_GLSL) + code)) {
+			GL_PUSH_CUSTOM_ERROR(-1, "ComputePrimitives: failed to compile "
+					"shader");
+		}
+	}
+}
+
+ComputePrimitives::ComputePrimitives(BarrierTracker& barriers) :
+	barriers(barriers) {
+	CompilePrimitive(scanBlocks, SCAN_BLOCKS_GLSL);
+	CompilePrimitive(scanAddOffsets, SCAN_ADD_OFFSETS_GLSL);
+	CompilePrimitive(compactScatter, COMPACT_SCATTER_GLSL);
+	CompilePrimitive(sortHistogram, SORT_HISTOGRAM_GLSL);
+	CompilePrimitive(sortScatter, SORT_SCATTER_GLSL);
+
+	scanBlocksCountLoc = scanBlocks.GetUniformLocation("count");
+	scanBlocksPredicateLoc = scanBlocks.GetUniformLocation("predicate");
+	scanAddOffsetsCountLoc = scanAddOffsets.GetUniformLocation("count");
+	compactCountLoc = compactScatter.GetUniformLocation("count");
+	compactWordsLoc = compactScatter.GetUniformLocation("words");
+	histogramCountLoc = sortHistogram.GetUniformLocation("count");
+	histogramShiftLoc = sortHistogram.GetUniformLocation("shift");
+	sortCountLoc = sortScatter.GetUniformLocation("count");
+	sortShiftLoc = sortScatter.GetUniformLocation("shift");
+}
+
+ComputePrimitives::~ComputePrimitives() {
+}
+
+void ComputePrimitives::ExclusiveScan(VBO& input, VBO& output,
+		uint32_t count) {
+	if(count == 0) {
+		return;
+	}
+	ScanRecursive(input, output, count, 0, false);
+}
+
+void ComputePrimitives::Compact(VBO& input, VBO& flags, VBO& output,
+		VBO& countBuffer, uint32_t count) {
+	if(input.VertexSize() % 4 != 0) {
+		GL_PUSH_CUSTOM_ERROR(-1, "ComputePrimitives::Compact: element size "
+				"needs to be multiple of 4 bytes");
+		return;
+	}
+	if(count == 0) {
+		const uint32_t zero = 0;
+		barriers.Use(countBuffer, USAGE_BUFFER_UPDATE, ACCESS_WRITE);
+		barriers.Flush();
+		countBuffer.Update(&zero, 0, sizeof(zero));
+		return;
+	}
+
+	VBO& offsets = Scratch(temp, 0, count);
+	ScanRecursive(flags, offsets, count, 0, true);
+
+	compactScatter.SetUInt(compactCountLoc, count);
+	compactScatter.SetUInt(compactWordsLoc, input.VertexSize()/4);
+	input.BindBufferBase(SHADER_STORAGE_BUFFER, 0);
+	flags.BindBufferBase(SHADER_STORAGE_BUFFER, 1);
+	offsets.BindBufferBase(SHADER_STORAGE_BUFFER, 2);
+	output.BindBufferBase(SHADER_STORAGE_BUFFER, 3);
+	countBuffer.BindBufferBase(SHADER_STORAGE_BUFFER, 4);
+	barriers.Use(input, USAGE_SHADER_STORAGE, ACCESS_READ);
+	barriers.Use(flags, USAGE_SHADER_STORAGE, ACCESS_READ);
+	barriers.Use(offsets, USAGE_SHADER_STORAGE, ACCESS_READ);
+	barriers.Use(output, USAGE_SHADER_STORAGE, ACCESS_WRITE);
+	barriers.Use(countBuffer, USAGE_SHADER_STORAGE, ACCESS_WRITE);
+	Dispatch(compactScatter, (count+255)/256);
+}
+
+void ComputePrimitives::RadixSort(VBO& keys, VBO& values, uint32_t count) {
+	if(count <= 1) {
+		return;
+	}
+	const uint32_t numBlocks = (count+SORT_BLOCK_SIZE-1)/SORT_BLOCK_SIZE;
+	VBO& histograms = Scratch(temp, 0, numBlocks*16);
+	VBO* srcKeys = &keys;
+	VBO* srcValues = &values;
+	VBO* dstKeys = &Scratch(temp, 1, count);
+	VBO* dstValues = &Scratch(temp, 2, count);
+
+	sortHistogram.SetUInt(histogramCountLoc, count);
+	sortScatter.SetUInt(sortCountLoc, count);
+	for(uint32_t shift=0; shift<32; shift+=4) {
+		sortHistogram.SetUInt(histogramShiftLoc, shift);
+		srcKeys->BindBufferBase(SHADER_STORAGE_BUFFER, 0);
+		histograms.BindBufferBase(SHADER_STORAGE_BUFFER, 1);
+		barriers.Use(*srcKeys, USAGE_SHADER_STORAGE, ACCESS_READ);
+		barriers.Use(histograms, USAGE_SHADER_STORAGE, ACCESS_WRITE);
+		Dispatch(sortHistogram, numBlocks);
+
+		ScanRecursive(histograms, histograms, numBlocks*16, 0, false);
+
+		sortScatter.SetUInt(sortShiftLoc, shift);
+		srcKeys->BindBufferBase(SHADER_STORAGE_BUFFER, 0);
+		srcValues->BindBufferBase(SHADER_STORAGE_BUFFER, 1);
+		histograms.BindBufferBase(SHADER_STORAGE_BUFFER, 2);
+		dstKeys->BindBufferBase(SHADER_STORAGE_BUFFER, 3);
+		dstValues->BindBufferBase(SHADER_STORAGE_BUFFER, 4);
+		barriers.Use(*srcKeys, USAGE_SHADER_STORAGE, ACCESS_READ);
+		barriers.Use(*srcValues, USAGE_SHADER_STORAGE, ACCESS_READ);
+		barriers.Use(histograms, USAGE_SHADER_STORAGE, ACCESS_READ);
+		barriers.Use(*dstKeys, USAGE_SHADER_STORAGE, ACCESS_WRITE);
+		barriers.Use(*dstValues, USAGE_SHADER_STORAGE, ACCESS_WRITE);
+		Dispatch(sortScatter, numBlocks);
+
+		std::swap(srcKeys, dstKeys);
+		std::swap(srcValues, dstValues);
+	}
+	// even number of passes leaves result in keys and values
+}
+
+void ComputePrimitives::ScanRecursive(VBO& input, VBO& output,
+		uint32_t count, uint32_t level, bool predicate) {
+	const uint32_t numBlocks = (count+SCAN_BLOCK_SIZE-1)/SCAN_BLOCK_SIZE;
+	VBO& sums = Scratch(scanSums, level, numBlocks);
+
+	scanBlocks.SetUInt(scanBlocksCountLoc, count);
+	scanBlocks.SetUInt(scanBlocksPredicateLoc, predicate ? 1 : 0);
+	input.BindBufferBase(SHADER_STORAGE_BUFFER, 0);
+	output.BindBufferBase(SHADER_STORAGE_BUFFER, 1);
+	sums.BindBufferBase(SHADER_STORAGE_BUFFER, 2);
+	barriers.Use(input, USAGE_SHADER_STORAGE, ACCESS_READ);
+	barriers.Use(output, USAGE_SHADER_STORAGE, ACCESS_WRITE);
+	barriers.Use(sums, USAGE_SHADER_STORAGE, ACCESS_WRITE);
+	Dispatch(scanBlocks, numBlocks);
+
+	if(numBlocks > 1) {
+		// block sums are scanned in place into block offsets
+		ScanRecursive(sums, sums, numBlocks, level+1, false);
+
+		scanAddOffsets.SetUInt(scanAddOffsetsCountLoc, count);
+		output.BindBufferBase(SHADER_STORAGE_BUFFER, 1);
+		sums.BindBufferBase(SHADER_STORAGE_BUFFER, 2);
+		barriers.Use(output, USAGE_SHADER_STORAGE, ACCESS_READ_WRITE);
+		barriers.Use(sums, USAGE_SHADER_STORAGE, ACCESS_READ);
+		Dispatch(scanAddOffsets, numBlocks);
+	}
+}
+
+void ComputePrimitives::Dispatch(Shader& shader, uint32_t numGroups) {
+	const uint32_t maxGroupsX = 65535;
+	if(numGroups <= maxGroupsX) {
+		barriers.Dispatch(shader, numGroups, 1, 1);
+	} else {
+		barriers.Dispatch(shader, maxGroupsX,
+				(numGroups+maxGroupsX-1)/maxGroupsX, 1);
+	}
+}
+
+VBO& ComputePrimitives::Scratch(std::vector<std::unique_ptr<VBO>>& buffers,
+		uint32_t id, uint32_t elements) {
+	if(buffers.size() <= id) {
+		buffers.resize(id+1);
+	}
+	std::unique_ptr<VBO>& buffer = buffers[id];
+	if(buffer.get() == nullptr) {
+		buffer = std::make_unique<VBO>(sizeof(uint32_t), SHADER_STORAGE_BUFFER,
+				DYNAMIC_DRAW);
+		buffer->Init(std::max<uint32_t>(elements, 1));
+	} else if(buffer->GetVertexCount() < elements) {
+		buffer->Generate(nullptr, elements);
+	}
+	return *buffer;
+}
+
+} // namespace gl
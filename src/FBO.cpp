@@ -17,16 +17,97 @@
  */
 
 #include <cstdio>
+#include <algorithm>
 
 #include "../include/openglwrapper/FBO.hpp"
 
 namespace gl {
+	
+	namespace {
+		enum ClearType {
+			CLEAR_FLOAT,
+			CLEAR_INT,
+			CLEAR_UINT,
+		};
+		
+		ClearType GetClearType(GLenum internalFormat) {
+			switch(internalFormat) {
+				case GL_R8I: case GL_R16I: case GL_R32I:
+				case GL_RG8I: case GL_RG16I: case GL_RG32I:
+				case GL_RGB8I: case GL_RGB16I: case GL_RGB32I:
+				case GL_RGBA8I: case GL_RGBA16I: case GL_RGBA32I:
+					return CLEAR_INT;
+				case GL_R8UI: case GL_R16UI: case GL_R32UI:
+				case GL_RG8UI: case GL_RG16UI: case GL_RG32UI:
+				case GL_RGB8UI: case GL_RGB16UI: case GL_RGB32UI:
+				case GL_RGBA8UI: case GL_RGBA16UI: case GL_RGBA32UI:
+				case GL_RGB10_A2UI:
+					return CLEAR_UINT;
+				default:
+					return CLEAR_FLOAT;
+			}
+		}
+
+		uint32_t GetPixelBytes(TextureDataFormat format, DataType type) {
+			switch(type) {
+				case UNSIGNED_BYTE_3_3_2: case UNSIGNED_BYTE_2_3_3_REV:
+					return 1;
+				case UNSIGNED_SHORT_5_6_5: case UNSIGNED_SHORT_5_6_5_REV:
+				case UNSIGNED_SHORT_4_4_4_4: case UNSIGNED_SHORT_4_4_4_4_REV:
+				case UNSIGNED_SHORT_5_5_5_1: case UNSIGNED_SHORT_1_5_5_5_REV:
+					return 2;
+				case UNSIGNED_INT_8_8_8_8: case UNSIGNED_INT_8_8_8_8_REV:
+				case UNSIGNED_INT_10_10_10_2: case UNSIGNED_INT_2_10_10_10_REV:
+				case UNSIGNED_INT_24_8:
+					return 4;
+				default:
+					break;
+			}
+			uint32_t components = 1;
+			switch(format) {
+				case RG: case RG_INTEGER:
+					components = 2;
+					break;
+				case RGB: case BGR: case RGB_INTEGER: case BGR_INTEGER:
+					components = 3;
+					break;
+				case RGBA: case BGRA: case RGBA_INTEGER: case BGRA_INTEGER:
+					components = 4;
+					break;
+				default:
+					break;
+			}
+			switch(type) {
+				case BYTE: case UNSIGNED_BYTE:
+					return components;
+				case SHORT: case UNSIGNED_SHORT: case HALF_FLOAT:
+					return components * 2;
+				case DOUBLE:
+					return components * 8;
+				default:
+					return components * 4;
+			}
+		}
+	}
 
 	FBO::FBO() {
 		fbo = 0;
+		x = y = width = height = 0;
+		clearColor = glm::vec4(0, 0, 0, 0);
+		clearDepth = 1.0f;
+		clearStencil = 0;
+		readBuffer = ATTACHMENT_COLOR0;
+		readbacks.resize(3);
+		readbackHead = 0;
+		readbacksIssued = 0;
+		readbacksDelivered = 0;
 	}
 	
 	void FBO::Destroy() {
+		UpdateReadbacks(true);
+		for(auto& slot : readbacks) {
+			slot.reset();
+		}
 		if(currentlyBoundFBO == this) {
 			Unbind();
 		}
@@ -41,24 +122,71 @@ namespace gl {
 	
 	
 	void FBO::AttachTexture(Texture* texture, FboAttachmentType attachmentType,
-			uint32_t bindLocation) {
+			uint32_t bindLocation, uint32_t level) {
 		SimpleBind();
-		glFramebufferTexture2D(GL_FRAMEBUFFER, attachmentType, GL_TEXTURE_2D,
-				texture->GetTexture(), 0);
+		glNamedFramebufferTexture(fbo, attachmentType, texture->GetTexture(),
+				level);
 		GL_CHECK_PUSH_ERROR;
+		SetAttachment(attachmentType, texture, nullptr, bindLocation);
+	}
+	
+	void FBO::AttachTextureLayer(Texture* texture,
+			FboAttachmentType attachmentType, uint32_t bindLocation,
+			uint32_t layer, uint32_t level) {
+		SimpleBind();
+		glNamedFramebufferTextureLayer(fbo, attachmentType,
+				texture->GetTexture(), level, layer);
+		GL_CHECK_PUSH_ERROR;
+		SetAttachment(attachmentType, texture, nullptr, bindLocation);
+	}
+	
+	void FBO::AttachRenderbuffer(Renderbuffer* renderbuffer,
+			FboAttachmentType attachmentType, uint32_t bindLocation) {
+		SimpleBind();
+		glNamedFramebufferRenderbuffer(fbo, attachmentType, GL_RENDERBUFFER,
+				renderbuffer->GetIdGL());
+		GL_CHECK_PUSH_ERROR;
+		SetAttachment(attachmentType, nullptr, renderbuffer, bindLocation);
+	}
+	
+	void FBO::SetAttachment(FboAttachmentType attachmentType,
+			Texture* texture, Renderbuffer* renderbuffer,
+			uint32_t bindLocation) {
 		if(attachmentType >= ATTACHMENT_COLOR0
 				&& attachmentType <= ATTACHMENT_COLOR15) {
 			if(attachmentBuffers.size() <= bindLocation) {
 				attachmentBuffers.resize(bindLocation+1, ATTACHMENT_NONE);
 			}
 			attachmentBuffers[bindLocation] = attachmentType;
+			UpdateDrawBuffers();
+		}
+		if(Attachment* attachment = FindAttachment(attachmentType)) {
+			attachment->texture = texture;
+			attachment->renderbuffer = renderbuffer;
+		} else {
+			attachments.push_back({attachmentType, texture, renderbuffer,
+					LOAD_ACTION_LOAD, STORE_ACTION_STORE, clearColor});
 		}
 	}
 	
+	void FBO::UpdateDrawBuffers() {
+		// draw buffers are state of framebuffer object, kept in sync for
+		// blits into FBO that was never bound
+		glNamedFramebufferDrawBuffers(fbo, attachmentBuffers.size(),
+				(const GLenum*)attachmentBuffers.data());
+		GL_CHECK_PUSH_ERROR;
+	}
+	
 	void FBO::DetachTexture(FboAttachmentType attachmentType) {
 		SimpleBind();
-		glFramebufferTexture2D(GL_FRAMEBUFFER, attachmentType, GL_TEXTURE_2D, 0, 0);
+		glNamedFramebufferTexture(fbo, attachmentType, 0, 0);
 		GL_CHECK_PUSH_ERROR;
+		for(size_t i=0; i<attachments.size(); ++i) {
+			if(attachments[i].type == attachmentType) {
+				attachments.erase(attachments.begin()+i);
+				break;
+			}
+		}
 	}
 	
 	void FBO::AttachColor(Texture* texture, int colorId, uint32_t bindLocation) {
@@ -97,6 +225,130 @@ namespace gl {
 	void FBO::SetClearColor(glm::vec4 clearColor) {
 		this->clearColor = clearColor;
 	}
+	
+	
+	FBO::Attachment* FBO::FindAttachment(FboAttachmentType attachmentType) {
+		for(Attachment& attachment : attachments) {
+			if(attachment.type == attachmentType) {
+				return &attachment;
+			}
+		}
+		return nullptr;
+	}
+	
+	void FBO::SetLoadAction(FboAttachmentType attachmentType,
+			FboLoadAction action) {
+		if(Attachment* attachment = FindAttachment(attachmentType)) {
+			attachment->load = action;
+		} else {
+			GL_PUSH_CUSTOM_ERROR(-1, "FBO has no such attachment");
+		}
+	}
+	
+	void FBO::SetStoreAction(FboAttachmentType attachmentType,
+			FboStoreAction action) {
+		if(Attachment* attachment = FindAttachment(attachmentType)) {
+			attachment->store = action;
+		} else {
+			GL_PUSH_CUSTOM_ERROR(-1, "FBO has no such attachment");
+		}
+	}
+	
+	void FBO::SetClearValue(FboAttachmentType attachmentType,
+			glm::vec4 value) {
+		if(Attachment* attachment = FindAttachment(attachmentType)) {
+			attachment->clearValue = value;
+		} else {
+			GL_PUSH_CUSTOM_ERROR(-1, "FBO has no such attachment");
+		}
+	}
+	
+	void FBO::SetClearDepthStencil(float depth, int32_t stencil) {
+		clearDepth = depth;
+		clearStencil = stencil;
+	}
+	
+	void FBO::ClearAttachment(FboAttachmentType attachmentType) {
+		if(fbo == 0) {
+			return;
+		}
+		switch(attachmentType) {
+			case ATTACHMENT_DEPTH:
+				glClearNamedFramebufferfv(fbo, GL_DEPTH, 0, &clearDepth);
+				break;
+			case ATTACHMENT_STENCIL:
+				glClearNamedFramebufferiv(fbo, GL_STENCIL, 0, &clearStencil);
+				break;
+			case ATTACHMENT_DEPTH_STENCIL:
+				glClearNamedFramebufferfi(fbo, GL_DEPTH_STENCIL, 0, clearDepth,
+						clearStencil);
+				break;
+			default: {
+				Attachment* attachment = FindAttachment(attachmentType);
+				int32_t drawBuffer = -1;
+				for(size_t i=0; i<attachmentBuffers.size(); ++i) {
+					if(attachmentBuffers[i] == attachmentType) {
+						drawBuffer = i;
+					}
+				}
+				if(attachment == nullptr || drawBuffer < 0) {
+					GL_PUSH_CUSTOM_ERROR(-1, "Cannot clear FBO color attachment that is not a draw buffer");
+					return;
+				}
+				const glm::vec4& v = attachment->clearValue;
+				const GLenum format = attachment->texture
+					? attachment->texture->GetInternalFormat()
+					: attachment->renderbuffer->GetInternalFormat();
+				switch(GetClearType(format)) {
+					case CLEAR_INT: {
+						const GLint value[4] = {(GLint)v.x, (GLint)v.y,
+							(GLint)v.z, (GLint)v.w};
+						glClearNamedFramebufferiv(fbo, GL_COLOR, drawBuffer,
+								value);
+					} break;
+					case CLEAR_UINT: {
+						const GLuint value[4] = {(GLuint)v.x, (GLuint)v.y,
+							(GLuint)v.z, (GLuint)v.w};
+						glClearNamedFramebufferuiv(fbo, GL_COLOR, drawBuffer,
+								value);
+					} break;
+					case CLEAR_FLOAT: {
+						const GLfloat value[4] = {v.x, v.y, v.z, v.w};
+						glClearNamedFramebufferfv(fbo, GL_COLOR, drawBuffer,
+								value);
+					} break;
+				}
+			}
+		}
+		GL_CHECK_PUSH_ERROR;
+	}
+	
+	void FBO::Invalidate(const FboAttachmentType* attachmentTypes,
+			uint32_t count) {
+		if(fbo == 0 || count == 0) {
+			return;
+		}
+		if(width && height) {
+			glInvalidateNamedFramebufferSubData(fbo, count,
+					(const GLenum*)attachmentTypes, x, y, width, height);
+		} else {
+			glInvalidateNamedFramebufferData(fbo, count,
+					(const GLenum*)attachmentTypes);
+		}
+		GL_CHECK_PUSH_ERROR;
+	}
+	
+	void FBO::InvalidateWhere(bool load) {
+		FboAttachmentType types[20];
+		uint32_t count = 0;
+		for(const Attachment& attachment : attachments) {
+			if(load ? attachment.load == LOAD_ACTION_DONT_CARE
+					: attachment.store == STORE_ACTION_DISCARD) {
+				types[count++] = attachment.type;
+			}
+		}
+		Invalidate(types, count);
+	}
 
 	
 	
@@ -114,10 +366,187 @@ namespace gl {
 		}
 	}
 	
+	void FBO::Blit(FBO* target, int srcX0, int srcY0, int srcX1, int srcY1,
+			int dstX0, int dstY0, int dstX1, int dstY1, GLbitfield mask,
+			GLenum filter) {
+		glBlitNamedFramebuffer(fbo, target ? target->fbo : 0, srcX0, srcY0,
+				srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+		GL_CHECK_PUSH_ERROR;
+	}
+	
+	void FBO::ResolveTo(FBO& target, GLbitfield mask, GLenum filter) {
+		const int w = GetWidth(), h = GetHeight();
+		if(mask & GL_COLOR_BUFFER_BIT) {
+			for(const Attachment& attachment : attachments) {
+				if(attachment.type < ATTACHMENT_COLOR0
+						|| attachment.type > ATTACHMENT_COLOR15
+						|| target.FindAttachment(attachment.type) == nullptr) {
+					continue;
+				}
+				glNamedFramebufferReadBuffer(fbo, attachment.type);
+				glNamedFramebufferDrawBuffer(target.fbo, attachment.type);
+				Blit(&target, 0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT,
+						filter);
+			}
+			glNamedFramebufferReadBuffer(fbo, readBuffer);
+			target.UpdateDrawBuffers();
+		}
+		mask &= ~GL_COLOR_BUFFER_BIT;
+		if(mask) {
+			Blit(&target, 0, 0, w, h, 0, 0, w, h, mask, GL_NEAREST);
+		}
+	}
+	
+	void FBO::SetReadBuffer(FboAttachmentType attachmentType) {
+		SimpleBind();
+		glNamedFramebufferReadBuffer(fbo, attachmentType);
+		GL_CHECK_PUSH_ERROR;
+		readBuffer = attachmentType;
+	}
+	
+	
+	void PixelReadback::Release() const {
+		state->store(0);
+	}
+	
+	bool FBO::ReadPixelsAsync(FboAttachmentType attachmentType, int x, int y,
+			int width, int height, TextureDataFormat format, DataType type,
+			ReadbackCallback callback) {
+		if(fbo == 0 || readbacks.empty() || width <= 0 || height <= 0) {
+			return false;
+		}
+		ReadbackSlot* slot = readbacks[readbackHead].get();
+		if(slot && slot->state.load() != READBACK_FREE) {
+			return false;
+		}
+		const uint32_t bytes = GetPixelBytes(format, type) * width * height;
+		if(slot == nullptr || slot->buffer->GetBytes() < bytes) {
+			readbacks[readbackHead] = std::make_unique<ReadbackSlot>();
+			slot = readbacks[readbackHead].get();
+			slot->buffer = std::make_unique<VBO>(1, PIXEL_PACK_BUFFER,
+					STREAM_DRAW);
+			slot->buffer->InitMapPersistent(nullptr, bytes,
+					MAP_READ_BIT | MAP_PERSISTENT_BIT | MAP_COHERENT_BIT
+					| CLIENT_STORAGE_BIT);
+			slot->state.store(READBACK_FREE);
+		}
+		readbackHead = (readbackHead + 1) % readbacks.size();
+		
+		const bool color = attachmentType >= ATTACHMENT_COLOR0
+			&& attachmentType <= ATTACHMENT_COLOR15;
+		if(color) {
+			glNamedFramebufferReadBuffer(fbo, attachmentType);
+		}
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer->GetIdGL());
+		GLint alignment = 4;
+		glGetIntegerv(GL_PACK_ALIGNMENT, &alignment);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(x, y, width, height, format, type, nullptr);
+		GL_CHECK_PUSH_ERROR;
+		glPixelStorei(GL_PACK_ALIGNMENT, alignment);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER,
+				currentlyBoundFBO ? currentlyBoundFBO->fbo : 0);
+		if(color) {
+			glNamedFramebufferReadBuffer(fbo, readBuffer);
+		}
+		GL_CHECK_PUSH_ERROR;
+		slot->fence.StartFence();
+		
+		slot->callback = std::move(callback);
+		slot->readback.pixels = slot->buffer->GetMappedPointer();
+		slot->readback.bytes = bytes;
+		slot->readback.x = x;
+		slot->readback.y = y;
+		slot->readback.width = width;
+		slot->readback.height = height;
+		slot->readback.format = format;
+		slot->readback.type = type;
+		slot->readback.id = readbacksIssued++;
+		slot->readback.state = &slot->state;
+		slot->state.store(READBACK_IN_FLIGHT);
+		return true;
+	}
+	
+	void FBO::UpdateReadbacks(bool wait) {
+		while(readbacksDelivered < readbacksIssued) {
+			ReadbackSlot* slot = nullptr;
+			for(auto& s : readbacks) {
+				if(s && s->state.load() == READBACK_IN_FLIGHT
+						&& s->readback.id == readbacksDelivered) {
+					slot = s.get();
+				}
+			}
+			if(slot == nullptr) {
+				// slot was replaced by SetReadbackRingSize()
+				++readbacksDelivered;
+				continue;
+			}
+			if(wait) {
+				slot->fence.WaitClient(1000000000ll * 60);
+			}
+			if(!slot->fence.IsDone()) {
+				break;
+			}
+			++readbacksDelivered;
+			slot->state.store(READBACK_HELD);
+			const bool keep = slot->callback && slot->callback(slot->readback);
+			slot->callback = nullptr;
+			if(!keep) {
+				slot->readback.Release();
+			}
+		}
+	}
+	
+	void FBO::SetReadbackRingSize(uint32_t buffers) {
+		UpdateReadbacks(true);
+		std::vector<std::unique_ptr<ReadbackSlot>> kept;
+		for(auto& slot : readbacks) {
+			if(slot && slot->state.load() != READBACK_FREE) {
+				// still read by consumer, ownership goes to the new ring
+				kept.push_back(std::move(slot));
+			}
+		}
+		readbacks = std::move(kept);
+		readbacks.resize(std::max<size_t>(buffers, readbacks.size()));
+		readbackHead = 0;
+	}
+	
+	uint32_t FBO::GetReadbacksInFlight() const {
+		return readbacksIssued - readbacksDelivered;
+	}
+	
+	uint32_t FBO::GetWidth() const {
+		if(attachments.empty()) {
+			return 0;
+		}
+		return attachments[0].texture ? attachments[0].texture->GetWidth()
+			: attachments[0].renderbuffer->GetWidth();
+	}
+	
+	uint32_t FBO::GetHeight() const {
+		if(attachments.empty()) {
+			return 0;
+		}
+		return attachments[0].texture ? attachments[0].texture->GetHeight()
+			: attachments[0].renderbuffer->GetHeight();
+	}
+	
 	void FBO::Bind() {
 		SimpleBind();
 		glDrawBuffers(attachmentBuffers.size(), (GLenum*)&(attachmentBuffers[0]));
 		GL_CHECK_PUSH_ERROR;
+		InvalidateWhere(true);
+		for(const Attachment& attachment : attachments) {
+			if(attachment.load == LOAD_ACTION_CLEAR) {
+				ClearAttachment(attachment.type);
+			}
+		}
+	}
+	
+	void FBO::EndPass() {
+		InvalidateWhere(false);
 	}
 	
 	void FBO::Unbind() {
@@ -0,0 +1,129 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+
+#include "../include/openglwrapper/OpenGL.hpp"
+
+#include "../include/openglwrapper/FrameSync.hpp"
+
+namespace gl {
+
+FrameSync::FrameSync(uint32_t framesInFlight, uint64_t maxWaitNanoseconds) :
+	slots(std::max<uint32_t>(framesInFlight, 1)), nextFrame(0),
+	completeBefore(0), maxWait(maxWaitNanoseconds), frameOpen(false) {
+	ResetStats();
+}
+
+uint64_t FrameSync::BeginFrame() {
+	if(frameOpen) {
+		EndFrame();
+	}
+	const uint64_t frameId = nextFrame++;
+	Slot& slot = slots[frameId % slots.size()];
+	stats.frames++;
+	stats.lastWaitNanoseconds = 0;
+	if(slot.fence.IsStarted()) {
+		if(slot.fence.IsDone()) {
+			MarkComplete(slot.frameId);
+		} else {
+			auto start = std::chrono::steady_clock::now();
+			SyncWaitResult result = slot.fence.WaitClient(maxWait);
+			uint64_t waited = std::chrono::duration_cast<
+				std::chrono::nanoseconds>(std::chrono::steady_clock::now()
+						- start).count();
+			stats.waits++;
+			stats.lastWaitNanoseconds = waited;
+			stats.maxWaitNanoseconds = std::max(stats.maxWaitNanoseconds,
+					waited);
+			stats.totalWaitNanoseconds += waited;
+			if(result == SYNC_DONE) {
+				MarkComplete(slot.frameId);
+			} else {
+				stats.timeouts++;
+			}
+		}
+	}
+	slot.frameId = frameId;
+	frameOpen = true;
+	return frameId;
+}
+
+void FrameSync::EndFrame() {
+	if(!frameOpen) {
+		return;
+	}
+	Slot& slot = slots[(nextFrame - 1) % slots.size()];
+	slot.fence.StartFence();
+	frameOpen = false;
+}
+
+bool FrameSync::IsFrameComplete(uint64_t frameId) {
+	if(frameId < completeBefore) {
+		return true;
+	}
+	if(frameId >= nextFrame || (frameOpen && frameId == nextFrame - 1)) {
+		return false;
+	}
+	// frame still has its slot, older frames were checked in BeginFrame()
+	Slot& slot = slots[frameId % slots.size()];
+	if(slot.frameId != frameId || !slot.fence.IsStarted()) {
+		return false;
+	}
+	if(slot.fence.IsDone()) {
+		MarkComplete(frameId);
+		return true;
+	}
+	return false;
+}
+
+void FrameSync::WaitIdle() {
+	if(frameOpen) {
+		EndFrame();
+	}
+	for(uint64_t id = completeBefore; id < nextFrame; ++id) {
+		Slot& slot = slots[id % slots.size()];
+		if(slot.frameId == id && slot.fence.IsStarted()) {
+			slot.fence.WaitClient(UINT64_MAX);
+		}
+	}
+	if(nextFrame) {
+		MarkComplete(nextFrame - 1);
+	}
+}
+
+void FrameSync::SetFramesInFlight(uint32_t framesInFlight) {
+	if(nextFrame) {
+		WaitIdle();
+	}
+	slots.clear();
+	slots.resize(std::max<uint32_t>(framesInFlight, 1));
+}
+
+void FrameSync::ResetStats() {
+	stats = Stats{0, 0, 0, 0, 0, 0};
+}
+
+void FrameSync::MarkComplete(uint64_t frameId) {
+	// fences signal in submission order
+	completeBefore = std::max(completeBefore, frameId + 1);
+}
+
+} // namespace gl
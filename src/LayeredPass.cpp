@@ -0,0 +1,144 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+#include <algorithm>
+
+#include "../include/openglwrapper/OpenGL.hpp"
+
+#include "../include/openglwrapper/LayeredPass.hpp"
+
+namespace gl {
+
+namespace {
+	// Inserts code after #version line, keeping line numbers of the rest.
+	std::string InsertAfterVersion(const std::string& code,
+			const std::string& insert) {
+		size_t pos = code.find("#version");
+		if(pos == std::string::npos) {
+			return insert + "#line 1\n" + code;
+		}
+		uint32_t line = 1;
+		for(size_t i=0; i<pos; ++i) {
+			line += code[i] == '\n';
+		}
+		pos = code.find('\n', pos);
+		if(pos == std::string::npos) {
+			return code + "\n" + insert;
+		}
+		return code.substr(0, pos+1) + insert + "#line "
+			+ std::to_string(line+1) + "\n" + code.substr(pos+1);
+	}
+
+	const char* LAYERED_GEOMETRY = R"(
+#version 450 core
+layout(triangles, invocations = OGLW_LAYERS) in;
+layout(triangle_strip, max_vertices = 3) out;
+uniform mat4 oglwLayerMatrices[OGLW_LAYERS];
+void main() {
+	for(int i=0; i<3; ++i) {
+		gl_Position = oglwLayerMatrices[gl_InvocationID] * gl_in[i].gl_Position;
+		gl_Layer = gl_InvocationID;
+		EmitVertex();
+	}
+	EndPrimitive();
+}
+)";
+
+	const char* LAYERED_VERTEX_MAIN = R"(
+#undef main
+uniform mat4 oglwLayerMatrices[OGLW_LAYERS];
+void main() {
+	oglwUserMain();
+	int layer = gl_InstanceID % OGLW_LAYERS;
+	gl_Position = oglwLayerMatrices[layer] * gl_Position;
+	gl_Layer = layer;
+}
+)";
+}
+
+bool LayeredPass::HasVertexShaderLayer() {
+	return GLEW_ARB_shader_viewport_layer_array
+		|| GLEW_AMD_vertex_shader_layer;
+}
+
+int LayeredPass::Compile(const std::string& vertexCode,
+		const std::string& fragmentCode, uint32_t layers,
+		bool forceGeometryShader) {
+	if(layers == 0 || layers > MAX_LAYERS) {
+		GL_PUSH_CUSTOM_ERROR(-1, "LayeredPass layers count out of range");
+		return -1;
+	}
+	this->layers = layers;
+	geometryShader = forceGeometryShader || !HasVertexShaderLayer();
+
+	const std::string layersDefine = "#define OGLW_LAYERS "
+		+ std::to_string(layers) + "\n";
+	std::string prefix;
+	if(geometryShader) {
+		prefix = layersDefine + "#define OGLW_INSTANCE_ID gl_InstanceID\n";
+	} else {
+		prefix = std::string(GLEW_ARB_shader_viewport_layer_array
+				? "#extension GL_ARB_shader_viewport_layer_array : require\n"
+				: "#extension GL_AMD_vertex_shader_layer : require\n")
+			+ layersDefine
+			+ "#define OGLW_INSTANCE_ID (gl_InstanceID / OGLW_LAYERS)\n";
+	}
+	std::string vertex;
+	std::string geometry;
+	if(geometryShader) {
+		vertex = InsertAfterVersion(vertexCode, prefix);
+		geometry = InsertAfterVersion(LAYERED_GEOMETRY + 1, layersDefine);
+	} else {
+		vertex = InsertAfterVersion(vertexCode, prefix
+				+ "#define main oglwUserMain\n") + LAYERED_VERTEX_MAIN;
+	}
+
+	int result = shader.Compile(vertex, geometry, fragmentCode);
+	matricesLocation = shader.GetUniformLocation("oglwLayerMatrices");
+	return result;
+}
+
+void LayeredPass::SetLayerMatrices(const std::vector<glm::mat4>& matrices) {
+	if(matrices.size() != layers) {
+		GL_PUSH_CUSTOM_ERROR(-1, "LayeredPass needs one matrix per layer");
+		return;
+	}
+	shader.SetMat4(matricesLocation, matrices);
+}
+
+void LayeredPass::Use() {
+	shader.Use();
+}
+
+void LayeredPass::Draw(VAO& vao, uint32_t instances) {
+	Draw(vao, 0, vao.drawArrays ? vao.sizeA : vao.sizeI, instances);
+}
+
+void LayeredPass::Draw(VAO& vao, uint32_t start, uint32_t count,
+		uint32_t instances) {
+	const unsigned previousInstances = vao.instances;
+	const uint32_t total = std::max<uint32_t>(instances, 1)
+		* GetInstancesMultiplier();
+	vao.SetInstances(total > 1 ? total : 0);
+	Use();
+	vao.Draw(start, count);
+	vao.SetInstances(previousInstances);
+}
+
+} // namespace gl
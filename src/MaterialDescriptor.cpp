@@ -0,0 +1,91 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "../include/openglwrapper/OpenGL.hpp"
+
+#include "../include/openglwrapper/MaterialDescriptor.hpp"
+
+namespace gl {
+
+void MaterialDescriptor::Range::Set(uint32_t unit, GLuint id) {
+	if(unit >= ids.size()) {
+		ids.resize(unit+1, 0);
+	}
+	ids[unit] = id;
+	first = std::min(first, unit);
+}
+
+void MaterialDescriptor::SetTexture(uint32_t unit, Texture* texture,
+		const Sampler* sampler) {
+	textures.Set(unit, texture ? texture->GetTexture() : 0);
+	samplers.Set(unit, sampler ? sampler->GetIdGL() : 0);
+}
+
+void MaterialDescriptor::SetImage(uint32_t unit, Texture* texture) {
+	images.Set(unit, texture ? texture->GetTexture() : 0);
+}
+
+bool MaterialDescriptor::SetTexture(const Shader& shader,
+		const char* uniformName, Texture* texture, const Sampler* sampler) {
+	const int unit = shader.GetTextureUnit(uniformName);
+	if(unit < 0) {
+		return false;
+	}
+	SetTexture(unit, texture, sampler);
+	return true;
+}
+
+bool MaterialDescriptor::SetImage(const Shader& shader,
+		const char* uniformName, Texture* texture) {
+	const int unit = shader.GetImageUnit(uniformName);
+	if(unit < 0) {
+		return false;
+	}
+	SetImage(unit, texture);
+	return true;
+}
+
+void MaterialDescriptor::Bind() const {
+	if(textures.ids.size()) {
+		glBindTextures(textures.first, textures.Count(), textures.Ids());
+		glBindSamplers(samplers.first, samplers.Count(), samplers.Ids());
+	}
+	if(images.ids.size()) {
+		glBindImageTextures(images.first, images.Count(), images.Ids());
+	}
+	GL_CHECK_PUSH_ERROR;
+}
+
+void MaterialDescriptor::Unbind() const {
+	if(textures.ids.size()) {
+		glBindTextures(textures.first, textures.Count(), nullptr);
+		glBindSamplers(samplers.first, samplers.Count(), nullptr);
+	}
+	if(images.ids.size()) {
+		glBindImageTextures(images.first, images.Count(), nullptr);
+	}
+	GL_CHECK_PUSH_ERROR;
+}
+
+void MaterialDescriptor::Clear() {
+	textures = samplers = images = Range();
+}
+
+} // namespace gl
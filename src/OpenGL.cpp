@@ -22,8 +22,21 @@
 #include "../include/openglwrapper/OpenGL.hpp"
 
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
 
-#include <cstdio>
+#ifdef OGLW_HEADLESS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+#ifndef EGL_NO_CONFIG_KHR
+#define EGL_NO_CONFIG_KHR ((EGLConfig)0)
+#endif
+#endif
 
 namespace gl {
 
@@ -45,7 +58,7 @@ void OpenGL::FaceCulling(bool showFront, bool showBack) {
 }
 
 void OpenGL::SetFullscreen(bool fullscreen) {
-	if(fullscreen == IsFullscreen())
+	if(window == nullptr || fullscreen == IsFullscreen())
 		return;
 	if(fullscreen) {
 		glfwGetCursorPos(window, &openGL.mouseCurrentX, &openGL.mouseCurrentY);
@@ -83,7 +96,7 @@ void OpenGL::SetFullscreen(bool fullscreen) {
 }
 
 bool OpenGL::IsFullscreen() const {
-	return glfwGetWindowMonitor(window) != nullptr;
+	return window && glfwGetWindowMonitor(window) != nullptr;
 }
 
 void OpenGL::SwapInput() {
@@ -144,12 +157,22 @@ unsigned int OpenGL::GetHeight() const {
 int OpenGL::Init(const char* windowName, unsigned int width,
 		unsigned int height, bool resizable, bool fullscreen, bool limitFrames,
 		int majorOpenglVersion, int minorOpenglVersion) {
+#ifdef OGLW_HEADLESS
+	const char* headlessEnv = getenv("OGLW_HEADLESS");
+	if(headlessEnv && atoi(headlessEnv)) {
+		return InitHeadless(width, height, majorOpenglVersion,
+				minorOpenglVersion);
+	}
+#endif
 	firstMouse = true;
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, majorOpenglVersion);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minorOpenglVersion);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#if OGLW_ERROR_CHECK == OGLW_ERROR_CHECK_DEBUG_CALLBACK
+	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
+#endif
     glfwWindowHint(GLFW_RESIZABLE, resizable);
 	window = glfwCreateWindow(width, height, windowName,
 			fullscreen ? glfwGetPrimaryMonitor() : nullptr, nullptr);
@@ -188,21 +211,167 @@ int OpenGL::Init(const char* windowName, unsigned int width,
 	    return 2;
 	}
 	GL_CHECK_PUSH_ERROR;
+	InitErrorCheck();
 	return 0;
 }
 
+int OpenGL::InitHeadless(unsigned int width, unsigned int height,
+		int majorOpenglVersion, int minorOpenglVersion) {
+#ifdef OGLW_HEADLESS
+	firstMouse = true;
+	
+	EGLDisplay display = EGL_NO_DISPLAY;
+	const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY,
+			EGL_EXTENSIONS);
+	auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+		eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if(clientExtensions && getPlatformDisplay
+			&& strstr(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+				EGL_DEFAULT_DISPLAY, nullptr);
+	}
+	if(display == EGL_NO_DISPLAY) {
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+	if(display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr,
+				nullptr)) {
+		printf("\n Failed to initialize EGL display! ");
+		return 1;
+	}
+	eglBindAPI(EGL_OPENGL_API);
+	
+	const EGLint configAttribs[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8, EGL_DEPTH_SIZE, 24, EGL_STENCIL_SIZE, 8,
+		EGL_NONE
+	};
+	EGLConfig config = nullptr;
+	EGLint configsCount = 0;
+	if(!eglChooseConfig(display, configAttribs, &config, 1, &configsCount)) {
+		configsCount = 0;
+	}
+	
+	const EGLint contextAttribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, majorOpenglVersion,
+		EGL_CONTEXT_MINOR_VERSION, minorOpenglVersion,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_CONTEXT_OPENGL_FORWARD_COMPATIBLE, EGL_TRUE,
+#if OGLW_ERROR_CHECK == OGLW_ERROR_CHECK_DEBUG_CALLBACK
+		EGL_CONTEXT_OPENGL_DEBUG, EGL_TRUE,
+#endif
+		EGL_NONE
+	};
+	// without pbuffer config context is created with EGL_KHR_no_config_context
+	EGLContext context = eglCreateContext(display,
+			configsCount ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT,
+			contextAttribs);
+	if(context == EGL_NO_CONTEXT) {
+		printf("\n Failed to create EGL context: 0x%X ", eglGetError());
+		eglTerminate(display);
+		return 1;
+	}
+	
+	EGLSurface surface = EGL_NO_SURFACE;
+	if(configsCount) {
+		const EGLint surfaceAttribs[] = {
+			EGL_WIDTH, (EGLint)width,
+			EGL_HEIGHT, (EGLint)height,
+			EGL_NONE
+		};
+		surface = eglCreatePbufferSurface(display, config, surfaceAttribs);
+	}
+	if(!eglMakeCurrent(display, surface, surface, context)) {
+		printf("\n Failed to make EGL context current: 0x%X ", eglGetError());
+		if(surface != EGL_NO_SURFACE) {
+			eglDestroySurface(display, surface);
+		}
+		eglDestroyContext(display, context);
+		eglTerminate(display);
+		return 1;
+	}
+	
+	headless = true;
+	headlessShouldClose = false;
+	headlessFrames = 0;
+	const char* framesEnv = getenv("OGLW_HEADLESS_FRAMES");
+	headlessFrameLimit = framesEnv ? strtoull(framesEnv, nullptr, 10) : 0;
+	headlessStartTime = std::chrono::steady_clock::now();
+	eglDisplay = display;
+	eglContext = context;
+	eglSurface = surface;
+	window = nullptr;
+	this->width = width;
+	this->height = height;
+	mouseLastX = mouseCurrentX = 0;
+	mouseLastY = mouseCurrentY = 0;
+	
+	glewExperimental = GL_TRUE;
+	GLenum glewResult = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+	// GLX build of GLEW loads OpenGL functions before failing on GLX
+	if(glewResult == GLEW_ERROR_NO_GLX_DISPLAY) {
+		glewResult = GLEW_OK;
+	}
+#endif
+	if(GLEW_OK != glewResult) {
+		printf("\n Failed to initialize GLEW! ");
+		GL_CHECK_PUSH_ERROR;
+		return 2;
+	}
+	// glewInit may leave GL_INVALID_ENUM of legacy extensions query
+	glGetError();
+	InitErrorCheck();
+	return 0;
+#else
+	printf("\n OpenGLWrapper was built without OGLW_HEADLESS! ");
+	return 3;
+#endif
+}
+
+
+
+bool OpenGL::ShouldClose() {
+	if(headless) {
+		++headlessFrames;
+		return headlessShouldClose || (headlessFrameLimit
+				&& headlessFrames > headlessFrameLimit);
+	}
+	return window == nullptr || glfwWindowShouldClose(window);
+}
+
+void OpenGL::SetShouldClose(bool shouldClose) {
+	if(headless) {
+		headlessShouldClose = shouldClose;
+	} else if(window) {
+		glfwSetWindowShouldClose(window, shouldClose);
+	}
+}
+
+double OpenGL::GetTime() const {
+	if(headless) {
+		return std::chrono::duration<double>(
+				std::chrono::steady_clock::now() - headlessStartTime).count();
+	}
+	return glfwGetTime();
+}
+
 
 
 void OpenGL::SetKeyCallback(void (callback)(GLFWwindow*, int, int, int, int)) {
-    glfwSetKeyCallback(window, callback);
+	if(window)
+		glfwSetKeyCallback(window, callback);
 }
 
 void OpenGL::SetScrollCallback(void (callback)(GLFWwindow*, double, double)) {
-    glfwSetScrollCallback(window, callback);
+	if(window)
+		glfwSetScrollCallback(window, callback);
 }
 
 void OpenGL::SetMouseCallback(void (callback)(GLFWwindow*, double, double)) {
-    glfwSetCursorPosCallback(window, callback);
+	if(window)
+		glfwSetCursorPosCallback(window, callback);
 }
 
 
@@ -223,16 +392,40 @@ void OpenGL::InitFrame() {
 
 void OpenGL::SwapBuffer() {
 	gl::Flush();
-	glfwSwapBuffers(window);
+	if(window) {
+		glfwSwapBuffers(window);
+	}
 }
 
 void OpenGL::Destroy() {
-	glfwDestroyWindow(window);
+#ifdef OGLW_HEADLESS
+	if(headless) {
+		EGLDisplay display = (EGLDisplay)eglDisplay;
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+				EGL_NO_CONTEXT);
+		if((EGLSurface)eglSurface != EGL_NO_SURFACE) {
+			eglDestroySurface(display, (EGLSurface)eglSurface);
+		}
+		eglDestroyContext(display, (EGLContext)eglContext);
+		eglTerminate(display);
+		eglDisplay = eglContext = eglSurface = nullptr;
+		headless = false;
+	}
+#endif
+	if(window) {
+		glfwDestroyWindow(window);
+	}
 	window = nullptr;
 	width = height = 0;
 }
 
 OpenGL::OpenGL() {
+	window = nullptr;
+	headless = false;
+	headlessShouldClose = false;
+	headlessFrames = headlessFrameLimit = 0;
+	eglDisplay = eglContext = eglSurface = nullptr;
+	debugOutput = false;
 	mouseLastX = mouseLastY = mouseCurrentX = mouseCurrentY = scrollLast
 		= scrollCurrent = 0.0;
 	keys.resize(1024);
@@ -310,6 +503,69 @@ int OpenGL::StackError(int line, const char* file) {
 	return err.code;
 }
 
+void OpenGL::InitErrorCheck() {
+	debugOutput = false;
+#if OGLW_ERROR_CHECK == OGLW_ERROR_CHECK_DEBUG_CALLBACK
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	if(!GLEW_KHR_debug && major*10 + minor < 43) {
+		fprintf(stderr, "KHR_debug not supported, OpenGL errors are checked"
+				" with glGetError\n");
+		return;
+	}
+	glEnable(GL_DEBUG_OUTPUT);
+	// callback runs inside of the failing call, before next GL_CHECK_*
+	glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+	glDebugMessageCallback(DebugMessageCallback, this);
+	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0,
+			nullptr, GL_FALSE);
+	glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_ERROR, GL_DONT_CARE, 0,
+			nullptr, GL_TRUE);
+	debugOutput = glGetError() == GL_NO_ERROR;
+#endif
+}
+
+void APIENTRY OpenGL::DebugMessageCallback(GLenum source, GLenum type,
+		GLuint id, GLenum severity, GLsizei length, const GLchar* message,
+		const void* userParam) {
+	OpenGL* gl = (OpenGL*)userParam;
+	if(type != GL_DEBUG_TYPE_ERROR) {
+		return;
+	}
+	std::string msg = length >= 0 ? std::string(message, length)
+		: std::string(message);
+	msg += " (debug message id " + std::to_string(id) + ")";
+	ErrorStruct err;
+	// error enum is known only after glGetError in FlushDebugErrors
+	err.code = GL_INVALID_OPERATION;
+	err.msg = gl->debugMessages.insert(msg).first->c_str();
+	err.file = nullptr;
+	err.line = 0;
+	gl->pendingDebugErrors.emplace_back(err);
+}
+
+int OpenGL::FlushDebugErrors(int line, const char* file) {
+	// error flags were set by the same calls, use them as error codes and
+	// clear them for code using glGetError directly
+	std::vector<GLenum> codes;
+	for(GLenum code = glGetError(); code != GL_NO_ERROR;
+			code = glGetError()) {
+		codes.emplace_back(code);
+	}
+	for(size_t i=0; i<pendingDebugErrors.size(); ++i) {
+		ErrorStruct& err = pendingDebugErrors[i];
+		if(codes.size()) {
+			err.code = codes[std::min(i, codes.size()-1)];
+		}
+		err.line = line;
+		err.file = file;
+		errors.emplace_back(err);
+	}
+	pendingDebugErrors.clear();
+	return errors.back().code;
+}
+
 void OpenGL::PrintError(ErrorStruct err) {
 	fprintf(stderr, "%s:%i -> OpenGL error [%i]: %s\n", err.file, err.line,
 			err.code, err.msg);
@@ -346,6 +602,9 @@ std::vector<OpenGL::ErrorStruct>& OpenGL::GetErrors() {
 
 void OpenGL::ClearErrors() {
 	errors.clear();
+	if(pendingDebugErrors.empty()) {
+		debugMessages.clear();
+	}
 }
 
 
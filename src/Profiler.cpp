@@ -0,0 +1,320 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <chrono>
+#include <algorithm>
+
+#include "../include/openglwrapper/OpenGL.hpp"
+
+#include "../include/openglwrapper/Profiler.hpp"
+
+namespace gl {
+
+namespace {
+	double Percentile(std::vector<uint64_t> samples, double fraction) {
+		if(samples.empty()) {
+			return 0.0;
+		}
+		size_t n = std::min<size_t>(samples.size() * fraction,
+				samples.size() - 1);
+		std::nth_element(samples.begin(), samples.begin() + n, samples.end());
+		return samples[n];
+	}
+
+	void WriteJsonString(FILE* file, const std::string& str) {
+		fputc('"', file);
+		for(char c : str) {
+			if(c == '"' || c == '\\') {
+				fputc('\\', file);
+				fputc(c, file);
+			} else if((unsigned char)c < 0x20) {
+				fprintf(file, "\\u%04x", c);
+			} else {
+				fputc(c, file);
+			}
+		}
+		fputc('"', file);
+	}
+}
+
+Profiler::Profiler(uint32_t samplesPerScope, uint32_t historyFrames) :
+	frameCounter(0), samplesPerScope(std::max<uint32_t>(samplesPerScope, 1)),
+	historyFrames(historyFrames), frameOpen(false), enabled(true) {
+}
+
+Profiler::~Profiler() {
+	if(allQueries.size()) {
+		glDeleteQueries(allQueries.size(), allQueries.data());
+		GL_CHECK_PUSH_ERROR;
+	}
+}
+
+uint64_t Profiler::CpuNow() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+GLuint Profiler::AllocateQuery() {
+	if(freeQueries.empty()) {
+		const uint32_t BATCH = 64;
+		size_t first = allQueries.size();
+		allQueries.resize(first + BATCH);
+		glCreateQueries(GL_TIMESTAMP, BATCH, allQueries.data() + first);
+		GL_CHECK_PUSH_ERROR;
+		freeQueries.insert(freeQueries.end(), allQueries.begin() + first,
+				allQueries.end());
+	}
+	GLuint query = freeQueries.back();
+	freeQueries.pop_back();
+	return query;
+}
+
+uint32_t Profiler::GetScope(int32_t parent, const char* name) {
+	auto key = std::make_pair(parent, std::string(name));
+	auto it = scopeIds.find(key);
+	if(it != scopeIds.end()) {
+		return it->second;
+	}
+	ScopeData scope;
+	scope.name = name;
+	scope.parent = parent;
+	scope.depth = parent < 0 ? 0 : scopes[parent].depth + 1;
+	scope.count = 0;
+	scope.sampleHead = 0;
+	scope.gpuTotal = scope.cpuTotal = 0;
+	scope.gpuMin = scope.cpuMin = UINT64_MAX;
+	scope.gpuMax = scope.cpuMax = 0;
+	scopes.push_back(std::move(scope));
+	scopeIds[key] = scopes.size() - 1;
+	return scopes.size() - 1;
+}
+
+void Profiler::BeginFrame() {
+	if(frameOpen) {
+		EndFrame();
+	}
+	while(pending.size() && Resolve(pending.front(), false)) {
+		pending.pop_front();
+	}
+	if(!enabled) {
+		return;
+	}
+	current.id = frameCounter++;
+	current.events.clear();
+	current.lastQuery = 0;
+	GLint64 gpuNow = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+	GL_CHECK_PUSH_ERROR;
+	current.gpuToCpu = (int64_t)CpuNow() - gpuNow;
+	frameOpen = true;
+}
+
+void Profiler::EndFrame() {
+	if(!frameOpen) {
+		return;
+	}
+	while(stack.size()) {
+		Pop();
+	}
+	pending.push_back(std::move(current));
+	current = Frame();
+	frameOpen = false;
+}
+
+void Profiler::Push(const char* name) {
+	if(!frameOpen) {
+		return;
+	}
+	Event event;
+	event.scope = GetScope(stack.empty() ? -1
+			: current.events[stack.back()].scope, name);
+	event.beginQuery = AllocateQuery();
+	event.endQuery = 0;
+	event.gpuBegin = event.gpuEnd = 0;
+	event.cpuEnd = 0;
+	glQueryCounter(event.beginQuery, GL_TIMESTAMP);
+	GL_CHECK_PUSH_ERROR;
+	event.cpuBegin = CpuNow();
+	current.lastQuery = event.beginQuery;
+	stack.push_back(current.events.size());
+	current.events.push_back(event);
+}
+
+void Profiler::Pop() {
+	if(!frameOpen || stack.empty()) {
+		return;
+	}
+	Event& event = current.events[stack.back()];
+	stack.pop_back();
+	event.cpuEnd = CpuNow();
+	event.endQuery = AllocateQuery();
+	glQueryCounter(event.endQuery, GL_TIMESTAMP);
+	GL_CHECK_PUSH_ERROR;
+	current.lastQuery = event.endQuery;
+}
+
+bool Profiler::Resolve(Frame& frame, bool wait) {
+	if(frame.lastQuery && !wait) {
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(frame.lastQuery, GL_QUERY_RESULT_AVAILABLE,
+				&available);
+		GL_CHECK_PUSH_ERROR;
+		if(!available) {
+			return false;
+		}
+	}
+	for(Event& event : frame.events) {
+		glGetQueryObjectui64v(event.beginQuery, GL_QUERY_RESULT,
+				&event.gpuBegin);
+		glGetQueryObjectui64v(event.endQuery, GL_QUERY_RESULT,
+				&event.gpuEnd);
+		GL_CHECK_PUSH_ERROR;
+		freeQueries.push_back(event.beginQuery);
+		freeQueries.push_back(event.endQuery);
+		event.beginQuery = event.endQuery = 0;
+		
+		ScopeData& scope = scopes[event.scope];
+		const uint64_t gpu = event.gpuEnd > event.gpuBegin
+			? event.gpuEnd - event.gpuBegin : 0;
+		const uint64_t cpu = event.cpuEnd - event.cpuBegin;
+		if(scope.gpuSamples.size() < samplesPerScope) {
+			scope.gpuSamples.push_back(gpu);
+			scope.cpuSamples.push_back(cpu);
+		} else {
+			scope.gpuSamples[scope.sampleHead] = gpu;
+			scope.cpuSamples[scope.sampleHead] = cpu;
+			scope.sampleHead = (scope.sampleHead + 1) % samplesPerScope;
+		}
+		scope.count++;
+		scope.gpuTotal += gpu;
+		scope.cpuTotal += cpu;
+		scope.gpuMin = std::min(scope.gpuMin, gpu);
+		scope.gpuMax = std::max(scope.gpuMax, gpu);
+		scope.cpuMin = std::min(scope.cpuMin, cpu);
+		scope.cpuMax = std::max(scope.cpuMax, cpu);
+	}
+	if(historyFrames) {
+		history.push_back(std::move(frame));
+		if(history.size() > historyFrames) {
+			history.pop_front();
+		}
+	}
+	return true;
+}
+
+void Profiler::Flush() {
+	if(frameOpen) {
+		EndFrame();
+	}
+	while(pending.size()) {
+		Resolve(pending.front(), true);
+		pending.pop_front();
+	}
+}
+
+std::string Profiler::GetPath(uint32_t scope) const {
+	std::string path = scopes[scope].name;
+	for(int32_t p = scopes[scope].parent; p >= 0; p = scopes[p].parent) {
+		path = scopes[p].name + "/" + path;
+	}
+	return path;
+}
+
+std::vector<Profiler::ScopeStats> Profiler::GetStats() const {
+	std::vector<ScopeStats> stats;
+	stats.reserve(scopes.size());
+	for(uint32_t i=0; i<scopes.size(); ++i) {
+		const ScopeData& scope = scopes[i];
+		if(scope.count == 0) {
+			continue;
+		}
+		ScopeStats s;
+		s.path = GetPath(i);
+		s.depth = scope.depth;
+		s.count = scope.count;
+		s.gpuMin = scope.gpuMin * 1e-6;
+		s.gpuAvg = scope.gpuTotal * 1e-6 / scope.count;
+		s.gpuP99 = Percentile(scope.gpuSamples, 0.99) * 1e-6;
+		s.gpuMax = scope.gpuMax * 1e-6;
+		s.cpuMin = scope.cpuMin * 1e-6;
+		s.cpuAvg = scope.cpuTotal * 1e-6 / scope.count;
+		s.cpuP99 = Percentile(scope.cpuSamples, 0.99) * 1e-6;
+		s.cpuMax = scope.cpuMax * 1e-6;
+		stats.push_back(s);
+	}
+	return stats;
+}
+
+void Profiler::PrintStats() const {
+	printf(" %-32s %8s %9s %9s %9s %9s %9s\n", "scope [ms]", "count",
+			"gpu min", "gpu avg", "gpu p99", "cpu avg", "cpu p99");
+	for(const ScopeStats& s : GetStats()) {
+		printf(" %-32s %8llu %9.3f %9.3f %9.3f %9.3f %9.3f\n", s.path.c_str(),
+				(unsigned long long)s.count, s.gpuMin, s.gpuAvg, s.gpuP99,
+				s.cpuAvg, s.cpuP99);
+	}
+}
+
+bool Profiler::ExportChromeTrace(const std::string& fileName) const {
+	FILE* file = fopen(fileName.c_str(), "wb");
+	if(file == nullptr) {
+		printf("\n ERROR::PROFILER::EXPORT: cannot open `%s`\n",
+				fileName.c_str());
+		return false;
+	}
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+			"\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n");
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+			"\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+	for(const Frame& frame : history) {
+		for(const Event& event : frame.events) {
+			const std::string& name = scopes[event.scope].name;
+			const double gpuBegin = ((int64_t)event.gpuBegin + frame.gpuToCpu)
+				* 1e-3;
+			const double gpuDuration = event.gpuEnd > event.gpuBegin
+				? (event.gpuEnd - event.gpuBegin) * 1e-3 : 0.0;
+			fprintf(file, ",\n{\"name\":");
+			WriteJsonString(file, name);
+			fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,"
+					"\"dur\":%.3f,\"args\":{\"frame\":%llu}}",
+					event.cpuBegin * 1e-3,
+					(event.cpuEnd - event.cpuBegin) * 1e-3,
+					(unsigned long long)frame.id);
+			fprintf(file, ",\n{\"name\":");
+			WriteJsonString(file, name);
+			fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":%.3f,"
+					"\"dur\":%.3f,\"args\":{\"frame\":%llu}}",
+					gpuBegin, gpuDuration, (unsigned long long)frame.id);
+		}
+	}
+	fprintf(file, "\n]}\n");
+	const bool ok = ferror(file) == 0;
+	fclose(file);
+	return ok;
+}
+
+void Profiler::Clear() {
+	Flush();
+	scopes.clear();
+	scopeIds.clear();
+	history.clear();
+}
+
+} // namespace gl
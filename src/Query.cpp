@@ -0,0 +1,308 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "../include/openglwrapper/OpenGL.hpp"
+
+#include "../include/openglwrapper/Query.hpp"
+
+namespace gl {
+
+Query::Query() : Query(QUERY_SAMPLES_PASSED) {
+}
+
+Query::Query(QueryTarget target) : id(0), target(target), index(0),
+	active(false), issued(false) {
+}
+
+Query::Query(Query&& other) : id(other.id), target(other.target),
+	index(other.index), active(other.active), issued(other.issued) {
+	other.id = 0;
+	other.active = false;
+	other.issued = false;
+}
+
+Query& Query::operator=(Query&& other) {
+	Destroy();
+	id = other.id;
+	target = other.target;
+	index = other.index;
+	active = other.active;
+	issued = other.issued;
+	other.id = 0;
+	other.active = false;
+	other.issued = false;
+	return *this;
+}
+
+Query::~Query() {
+	Destroy();
+}
+
+void Query::SetTarget(QueryTarget target) {
+	if(this->target != target) {
+		Destroy();
+		this->target = target;
+	}
+}
+
+void Query::Create() {
+	if(id == 0) {
+		// glGenQueries instead of glCreateQueries, as some drivers do not
+		// accept ARB_pipeline_statistics_query targets in the latter. Query
+		// object is created by first Begin() or Timestamp().
+		glGenQueries(1, &id);
+		GL_CHECK_PUSH_PRINT_ERROR;
+	}
+}
+
+void Query::Destroy() {
+	if(id) {
+		if(active) {
+			End();
+		}
+		glDeleteQueries(1, &id);
+		GL_CHECK_PUSH_PRINT_ERROR;
+		id = 0;
+	}
+	issued = false;
+}
+
+void Query::Begin(uint32_t index) {
+	Create();
+	if(active) {
+		GL_PUSH_CUSTOM_ERROR(-1, "Query::Begin called on active query");
+		return;
+	}
+	this->index = index;
+	glBeginQueryIndexed(target, index, id);
+	GL_CHECK_PUSH_PRINT_ERROR;
+	active = true;
+	issued = true;
+}
+
+void Query::End() {
+	if(!active) {
+		return;
+	}
+	glEndQueryIndexed(target, index);
+	GL_CHECK_PUSH_PRINT_ERROR;
+	active = false;
+}
+
+void Query::Timestamp() {
+	if(target != QUERY_TIMESTAMP) {
+		GL_PUSH_CUSTOM_ERROR(-1, "Query::Timestamp needs QUERY_TIMESTAMP");
+		return;
+	}
+	Create();
+	glQueryCounter(id, GL_TIMESTAMP);
+	GL_CHECK_PUSH_PRINT_ERROR;
+	issued = true;
+}
+
+bool Query::IsAvailable() const {
+	if(!issued || active) {
+		return false;
+	}
+	GLuint available = GL_FALSE;
+	glGetQueryObjectuiv(id, GL_QUERY_RESULT_AVAILABLE, &available);
+	GL_CHECK_PUSH_ERROR;
+	return available;
+}
+
+bool Query::GetResult(uint64_t& result, bool wait) const {
+	if(!issued || active) {
+		return false;
+	}
+	if(!wait && !IsAvailable()) {
+		return false;
+	}
+	GLuint64 value = 0;
+	glGetQueryObjectui64v(id, GL_QUERY_RESULT, &value);
+	GL_CHECK_PUSH_ERROR;
+	result = value;
+	return true;
+}
+
+void Query::WriteResult(VBO& buffer, uint32_t offset, QueryBufferResult mode,
+		bool bits64) const {
+	if(!issued) {
+		GL_PUSH_CUSTOM_ERROR(-1, "Query::WriteResult called on not issued query");
+		return;
+	}
+	if(bits64) {
+		glGetQueryBufferObjectui64v(id, buffer.GetIdGL(), mode, offset);
+	} else {
+		glGetQueryBufferObjectuiv(id, buffer.GetIdGL(), mode, offset);
+	}
+	GL_CHECK_PUSH_PRINT_ERROR;
+}
+
+void Query::BeginConditionalRender(ConditionalRenderMode mode) const {
+	glBeginConditionalRender(id, mode);
+	GL_CHECK_PUSH_PRINT_ERROR;
+}
+
+void Query::EndConditionalRender() {
+	glEndConditionalRender();
+	GL_CHECK_PUSH_PRINT_ERROR;
+}
+
+QueryPool::QueryPool(uint32_t batchSize) :
+	batchSize(std::max<uint32_t>(batchSize, 1)) {
+}
+
+QueryPool::~QueryPool() {
+	Clear();
+}
+
+Query* QueryPool::Acquire(QueryTarget target) {
+	std::vector<Query*>& free = freeQueries[target];
+	if(free.empty()) {
+		std::vector<GLuint> ids(batchSize);
+		glGenQueries(batchSize, ids.data());
+		GL_CHECK_PUSH_PRINT_ERROR;
+		for(GLuint id : ids) {
+			std::unique_ptr<Query> query = std::make_unique<Query>(target);
+			query->id = id;
+			free.push_back(query.get());
+			queries.push_back(std::move(query));
+		}
+	}
+	Query* query = free.back();
+	free.pop_back();
+	return query;
+}
+
+void QueryPool::Release(Query* query) {
+	if(query == nullptr) {
+		return;
+	}
+	if(query->active) {
+		query->End();
+	}
+	query->issued = false;
+	freeQueries[query->target].push_back(query);
+}
+
+void QueryPool::Clear() {
+	freeQueries.clear();
+	queries.clear();
+}
+
+uint32_t QueryPool::GetFreeCount() const {
+	uint32_t count = 0;
+	for(const auto& it : freeQueries) {
+		count += it.second.size();
+	}
+	return count;
+}
+
+namespace {
+	// in order of PipelineStatisticsQuery::Statistics fields
+	const QueryTarget STATISTICS_TARGETS[] = {
+		QUERY_VERTICES_SUBMITTED,
+		QUERY_PRIMITIVES_SUBMITTED,
+		QUERY_VERTEX_SHADER_INVOCATIONS,
+		QUERY_TESS_CONTROL_SHADER_PATCHES,
+		QUERY_TESS_EVALUATION_SHADER_INVOCATIONS,
+		QUERY_GEOMETRY_SHADER_INVOCATIONS,
+		QUERY_GEOMETRY_SHADER_PRIMITIVES_EMITTED,
+		QUERY_FRAGMENT_SHADER_INVOCATIONS,
+		QUERY_COMPUTE_SHADER_INVOCATIONS,
+		QUERY_CLIPPING_INPUT_PRIMITIVES,
+		QUERY_CLIPPING_OUTPUT_PRIMITIVES,
+		QUERY_PRIMITIVES_GENERATED,
+		QUERY_SAMPLES_PASSED,
+	};
+	
+	// counters of Statistics before this index need the extension
+	const uint32_t FIRST_CORE_COUNTER = 11;
+	
+	static_assert(sizeof(STATISTICS_TARGETS) / sizeof(QueryTarget)
+			== PipelineStatisticsQuery::COUNTERS,
+			"Statistics fields do not match query targets");
+}
+
+PipelineStatisticsQuery::PipelineStatisticsQuery() {
+	for(uint32_t i=0; i<COUNTERS; ++i) {
+		queries[i].SetTarget(STATISTICS_TARGETS[i]);
+	}
+}
+
+bool PipelineStatisticsQuery::IsSupported() {
+	return GLEW_ARB_pipeline_statistics_query;
+}
+
+void PipelineStatisticsQuery::Begin() {
+	const uint32_t first = IsSupported() ? 0 : FIRST_CORE_COUNTER;
+	for(uint32_t i=first; i<COUNTERS; ++i) {
+		queries[i].Begin();
+	}
+}
+
+void PipelineStatisticsQuery::End() {
+	for(Query& query : queries) {
+		query.End();
+	}
+}
+
+bool PipelineStatisticsQuery::IsAvailable() const {
+	for(const Query& query : queries) {
+		if(query.IsIssued() && !query.IsAvailable()) {
+			return false;
+		}
+	}
+	return queries[COUNTERS-1].IsIssued();
+}
+
+bool PipelineStatisticsQuery::GetResult(Statistics& statistics,
+		bool wait) const {
+	if(!wait && !IsAvailable()) {
+		return false;
+	}
+	uint64_t* counters = reinterpret_cast<uint64_t*>(&statistics);
+	for(uint32_t i=0; i<COUNTERS; ++i) {
+		counters[i] = 0;
+		if(queries[i].IsIssued()) {
+			if(!queries[i].GetResult(counters[i], true)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void PipelineStatisticsQuery::WriteResults(VBO& buffer, uint32_t offset,
+		QueryBufferResult mode) const {
+	for(uint32_t i=0; i<COUNTERS; ++i) {
+		if(queries[i].IsIssued()) {
+			queries[i].WriteResult(buffer, offset + i*sizeof(uint64_t), mode);
+		} else {
+			const uint64_t zero = 0;
+			glClearNamedBufferSubData(buffer.GetIdGL(), GL_RG32UI,
+					offset + i*sizeof(uint64_t), sizeof(uint64_t), GL_RG_INTEGER,
+					GL_UNSIGNED_INT, &zero);
+			GL_CHECK_PUSH_PRINT_ERROR;
+		}
+	}
+}
+
+} // namespace gl
@@ -0,0 +1,167 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <algorithm>
+
+#include "../include/openglwrapper/OpenGL.hpp"
+
+#include "../include/openglwrapper/RenderTargetPool.hpp"
+
+namespace gl {
+
+bool RenderTargetPool::Desc::operator==(const Desc& other) const {
+	return width == other.width && height == other.height
+		&& format == other.format
+		&& std::max(samples, 1u) == std::max(other.samples, 1u);
+}
+
+RenderTargetPool::RenderTargetPool(uint32_t releaseAfterFrames) :
+	frame(0), releaseAfterFrames(releaseAfterFrames) {
+}
+
+RenderTargetPool::~RenderTargetPool() {
+	Clear();
+}
+
+Texture* RenderTargetPool::Acquire(const Desc& desc) {
+	for(Target& target : targets) {
+		if(!target.acquired && target.desc == desc) {
+			target.acquired = true;
+			target.lastUsed = frame;
+			return target.texture.get();
+		}
+	}
+	std::unique_ptr<Texture> texture = std::make_unique<Texture>();
+	if(desc.samples > 1) {
+		texture->Storage2Multisample(TEXTURE_2D_MULTISAMPLE, desc.width,
+				desc.height, 1, desc.samples, desc.format);
+	} else {
+		texture->Storage2(TEXTURE_2D, desc.width, desc.height, 1, desc.format);
+		texture->MinFilter(LINEAR);
+		texture->MagFilter(MAG_LINEAR);
+		texture->WrapX(CLAMP_TOtEDGE);
+		texture->WrapY(CLAMP_TOtEDGE);
+	}
+	if(texture->Loaded() == false) {
+		GL_PUSH_CUSTOM_ERROR(-1, "RenderTargetPool failed to create texture");
+		return nullptr;
+	}
+	texture->SetMemoryTag("RenderTargetPool");
+	targets.push_back({std::move(texture), desc, frame, true});
+	return targets.back().texture.get();
+}
+
+Texture* RenderTargetPool::Acquire(uint32_t width, uint32_t height,
+		TextureSizedInternalFormat format, uint32_t samples) {
+	return Acquire(Desc{width, height, format, samples});
+}
+
+void RenderTargetPool::Release(Texture* texture) {
+	for(Target& target : targets) {
+		if(target.texture.get() == texture) {
+			target.acquired = false;
+			return;
+		}
+	}
+}
+
+FBO* RenderTargetPool::GetFBO(std::initializer_list<Attachment> attachments) {
+	FBOKey key;
+	key.reserve(attachments.size());
+	for(const Attachment& attachment : attachments) {
+		key.emplace_back(attachment.type, attachment.texture->GetGeneration());
+	}
+	CachedFBO& cached = fbos[key];
+	cached.lastUsed = frame;
+	if(cached.fbo == nullptr) {
+		cached.fbo = std::make_unique<FBO>();
+		uint32_t bindLocation = 0;
+		for(const Attachment& attachment : attachments) {
+			const bool color = attachment.type >= ATTACHMENT_COLOR0
+				&& attachment.type <= ATTACHMENT_COLOR15;
+			cached.fbo->AttachTexture(attachment.texture, attachment.type,
+					color ? bindLocation++ : 0);
+		}
+		const GLenum status = cached.fbo->CheckStatus();
+		if(status != GL_FRAMEBUFFER_COMPLETE) {
+			printf("\n ERROR::RENDER_TARGET_POOL::FBO_INCOMPLETE: 0x%X\n",
+					status);
+		}
+	}
+	return cached.fbo.get();
+}
+
+void RenderTargetPool::NextFrame() {
+	++frame;
+	for(size_t i=0; i<targets.size();) {
+		Target& target = targets[i];
+		target.acquired = false;
+		if(target.lastUsed + releaseAfterFrames < frame) {
+			DestroyFBOsUsing(target.texture->GetGeneration());
+			targets[i] = std::move(targets.back());
+			targets.pop_back();
+		} else {
+			++i;
+		}
+	}
+	for(auto it = fbos.begin(); it != fbos.end();) {
+		if(it->second.lastUsed + releaseAfterFrames < frame) {
+			it = fbos.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+void RenderTargetPool::Clear() {
+	fbos.clear();
+	targets.clear();
+}
+
+uint32_t RenderTargetPool::GetAcquiredCount() const {
+	uint32_t count = 0;
+	for(const Target& target : targets) {
+		count += target.acquired ? 1 : 0;
+	}
+	return count;
+}
+
+uint64_t RenderTargetPool::GetVramUsage() const {
+	uint64_t bytes = 0;
+	for(const Target& target : targets) {
+		bytes += target.texture->GetVramUsage();
+	}
+	return bytes;
+}
+
+void RenderTargetPool::DestroyFBOsUsing(uint64_t textureGeneration) {
+	for(auto it = fbos.begin(); it != fbos.end();) {
+		bool uses = false;
+		for(const auto& attachment : it->first) {
+			uses = uses || attachment.second == textureGeneration;
+		}
+		if(uses) {
+			it = fbos.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+} // namespace gl
@@ -0,0 +1,77 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../include/openglwrapper/OpenGL.hpp"
+
+#include "../include/openglwrapper/Renderbuffer.hpp"
+
+namespace gl {
+
+Renderbuffer::Renderbuffer() {
+	renderbufferID = 0;
+	width = height = 0;
+	samples = 1;
+	internalFormat = RGBA8;
+}
+
+Renderbuffer::~Renderbuffer() {
+	Destroy();
+}
+
+void Renderbuffer::Storage(uint32_t width, uint32_t height,
+		TextureSizedInternalFormat internalFormat, uint32_t samples) {
+	Destroy();
+	glCreateRenderbuffers(1, &renderbufferID);
+	GL_CHECK_PUSH_PRINT_ERROR;
+	if(samples > 1) {
+		glNamedRenderbufferStorageMultisample(renderbufferID, samples,
+				internalFormat, width, height);
+	} else {
+		glNamedRenderbufferStorage(renderbufferID, internalFormat, width,
+				height);
+	}
+	GL_CHECK_PUSH_PRINT_ERROR;
+	GLint actualSamples = 0;
+	glGetNamedRenderbufferParameteriv(renderbufferID,
+			GL_RENDERBUFFER_SAMPLES, &actualSamples);
+	GL_CHECK_PUSH_ERROR;
+	this->width = width;
+	this->height = height;
+	this->samples = actualSamples > 1 ? actualSamples : 1;
+	this->internalFormat = internalFormat;
+}
+
+void Renderbuffer::Destroy() {
+	if(renderbufferID) {
+		glDeleteRenderbuffers(1, &renderbufferID);
+		GL_CHECK_PUSH_ERROR;
+		renderbufferID = 0;
+	}
+	width = height = 0;
+	samples = 1;
+}
+
+uint64_t Renderbuffer::GetVramUsage() const {
+	if(renderbufferID == 0) {
+		return 0;
+	}
+	return Texture::GetStorageBytes(samples > 1 ? TEXTURE_2D_MULTISAMPLE
+			: TEXTURE_2D, internalFormat, width, height, 1, 1, samples);
+}
+
+} // namespace gl
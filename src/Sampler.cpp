@@ -0,0 +1,129 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <tuple>
+#include <vector>
+#include <algorithm>
+
+#include "../include/openglwrapper/OpenGL.hpp"
+
+#include "../include/openglwrapper/Sampler.hpp"
+
+#ifndef GL_TEXTURE_MAX_ANISOTROPY
+#define GL_TEXTURE_MAX_ANISOTROPY 0x84FE
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY 0x84FF
+#endif
+
+namespace gl {
+
+namespace {
+	inline auto Tie(const SamplerState& s) {
+		return std::tie(s.minFilter, s.magFilter, s.wrapX, s.wrapY, s.wrapZ,
+				s.maxAnisotropy, s.lodBias, s.minLod, s.maxLod, s.compare,
+				s.compareFunc, s.borderColor[0], s.borderColor[1],
+				s.borderColor[2], s.borderColor[3]);
+	}
+}
+
+bool SamplerState::operator<(const SamplerState& other) const {
+	return Tie(*this) < Tie(other);
+}
+
+bool SamplerState::operator==(const SamplerState& other) const {
+	return Tie(*this) == Tie(other);
+}
+
+Sampler::Sampler() {
+	glCreateSamplers(1, &samplerID);
+	GL_CHECK_PUSH_PRINT_ERROR;
+}
+
+Sampler::Sampler(const SamplerState& state) : Sampler() {
+	Set(state);
+}
+
+Sampler::~Sampler() {
+	if(samplerID) {
+		glDeleteSamplers(1, &samplerID);
+		samplerID = 0;
+	}
+}
+
+void Sampler::Set(const SamplerState& state) {
+	this->state = state;
+	glSamplerParameteri(samplerID, GL_TEXTURE_MIN_FILTER, state.minFilter);
+	glSamplerParameteri(samplerID, GL_TEXTURE_MAG_FILTER, state.magFilter);
+	glSamplerParameteri(samplerID, GL_TEXTURE_WRAP_S, state.wrapX);
+	glSamplerParameteri(samplerID, GL_TEXTURE_WRAP_T, state.wrapY);
+	glSamplerParameteri(samplerID, GL_TEXTURE_WRAP_R, state.wrapZ);
+	glSamplerParameterf(samplerID, GL_TEXTURE_LOD_BIAS, state.lodBias);
+	glSamplerParameterf(samplerID, GL_TEXTURE_MIN_LOD, state.minLod);
+	glSamplerParameterf(samplerID, GL_TEXTURE_MAX_LOD, state.maxLod);
+	glSamplerParameteri(samplerID, GL_TEXTURE_COMPARE_MODE,
+			state.compare ? GL_COMPARE_REF_TO_TEXTURE : GL_NONE);
+	glSamplerParameteri(samplerID, GL_TEXTURE_COMPARE_FUNC,
+			state.compareFunc);
+	glSamplerParameterfv(samplerID, GL_TEXTURE_BORDER_COLOR,
+			state.borderColor);
+	if(GLEW_ARB_texture_filter_anisotropic
+			|| GLEW_EXT_texture_filter_anisotropic) {
+		float maxAnisotropy = 1.0f;
+		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &maxAnisotropy);
+		glSamplerParameterf(samplerID, GL_TEXTURE_MAX_ANISOTROPY,
+				std::clamp(state.maxAnisotropy, 1.0f, maxAnisotropy));
+	}
+	GL_CHECK_PUSH_PRINT_ERROR;
+}
+
+void Sampler::Bind(uint32_t unit) const {
+	glBindSampler(unit, samplerID);
+}
+
+void Sampler::Unbind(uint32_t unit) {
+	glBindSampler(unit, 0);
+}
+
+void Sampler::BindSamplers(uint32_t firstUnit, uint32_t count,
+		const Sampler* const* samplers) {
+	GLuint ids[32];
+	std::vector<GLuint> manyIds;
+	GLuint* dst = ids;
+	if(count > 32) {
+		manyIds.resize(count);
+		dst = manyIds.data();
+	}
+	for(uint32_t i=0; i<count; ++i) {
+		dst[i] = samplers[i] ? samplers[i]->samplerID : 0;
+	}
+	glBindSamplers(firstUnit, count, dst);
+	GL_CHECK_PUSH_ERROR;
+}
+
+Sampler* SamplerCache::Get(const SamplerState& state) {
+	std::unique_ptr<Sampler>& sampler = samplers[state];
+	if(sampler == nullptr) {
+		sampler = std::make_unique<Sampler>(state);
+	}
+	return sampler.get();
+}
+
+void SamplerCache::Clear() {
+	samplers.clear();
+}
+
+} // namespace gl
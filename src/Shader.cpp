@@ -19,11 +19,15 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <unordered_map>
 #include <fstream>
 #include <cstdio>
+#include <cstring>
 
 #include "../include/openglwrapper/Texture.hpp"
 #include "../include/openglwrapper/VBO.hpp"
+#include "../include/openglwrapper/ShaderWatcher.hpp"
 
 #include "../include/openglwrapper/Shader.hpp"
 
@@ -67,7 +71,11 @@ int Shader::Compile(const std::string& vertexCode, const std::string& geometryCo
 	
 	GL_CHECK_PUSH_ERROR;
 	
-	return CheckBuildStatus();
+	int ret = CheckBuildStatus();
+	if(ret == 0) {
+		AssignTextureUnits();
+	}
+	return ret;
 }
 
 int Shader::Compile(const std::string& computeCode) {
@@ -85,18 +93,55 @@ int Shader::Compile(const std::string& computeCode) {
 	int ret = CheckBuildStatus();
 	if(ret == 0) {
 		glGetProgramiv(program, GL_COMPUTE_WORK_GROUP_SIZE, workgroupSize);
+		AssignTextureUnits();
 	}
 	GL_CHECK_PUSH_ERROR;
-	return CheckBuildStatus();
+	return ret;
 }
 
 int Shader::Load(const std::string& vertexPath, const std::string& geometryPath,
 		const std::string& fragmentPath) {
-	return Compile(LoadFileUseIncludes(vertexPath), LoadFileUseIncludes(geometryPath), LoadFileUseIncludes(fragmentPath));
+	ShaderPreprocessor::Result stages[3] = {
+		ShaderPreprocessor::Process(vertexPath),
+		ShaderPreprocessor::Process(geometryPath),
+		ShaderPreprocessor::Process(fragmentPath)
+	};
+	int ret = Compile(stages[0].code, stages[1].code, stages[2].code);
+	stagePaths = {vertexPath, geometryPath, fragmentPath};
+	SetSourceFiles(stages, 3, ret);
+	return ret;
 }
 
 int Shader::Load(const std::string& computePath) {
-	return Compile(LoadFileUseIncludes(computePath));
+	ShaderPreprocessor::Result stage = ShaderPreprocessor::Process(computePath);
+	int ret = Compile(stage.code);
+	stagePaths = {computePath};
+	SetSourceFiles(&stage, 1, ret);
+	return ret;
+}
+
+void Shader::SetSourceFiles(const ShaderPreprocessor::Result* stages,
+		int count, int compileStatus) {
+	sourceFiles.clear();
+	for(int i=0; i<count; ++i) {
+		for(const std::string& file : stages[i].files) {
+			if(std::find(sourceFiles.begin(), sourceFiles.end(), file)
+					== sourceFiles.end()) {
+				sourceFiles.emplace_back(file);
+			}
+		}
+		if(compileStatus && stages[i].files.size() > 1) {
+			printf("\n GLSL source string numbers:");
+			for(size_t j=0; j<stages[i].files.size(); ++j) {
+				printf("\n %5zu: %s", j, stages[i].files[j].c_str());
+			}
+			printf("\n");
+		}
+	}
+}
+
+const std::vector<std::string>& Shader::GetSourceFiles() const {
+	return sourceFiles;
 }
 
 void Shader::Dispatch(uint32_t numGroupsX, uint32_t numGroupsY,
@@ -128,6 +173,10 @@ void Shader::DispatchBuffer(VBO& dispatchBuffer, uint32_t dispatchOffset) {
 }
 
 unsigned Shader::CheckBuildStatus() {
+	return CheckProgramStatus(program);
+}
+
+unsigned Shader::CheckProgramStatus(unsigned program) {
 	int success;
 	glGetProgramiv(program, GL_LINK_STATUS, &success);
 		GL_CHECK_PUSH_ERROR;
@@ -142,7 +191,8 @@ unsigned Shader::CheckBuildStatus() {
 	return 0;
 }
 
-unsigned Shader::CompileGLSL(const std::string& code, gl::ShaderType type) {
+unsigned Shader::CompileGLSL(const std::string& code, gl::ShaderType type,
+		bool checkStatus) {
 	char const* shaderStrType = 0;
 	switch(type) {
 		case VERTEX_SHADER:
@@ -174,6 +224,9 @@ unsigned Shader::CompileGLSL(const std::string& code, gl::ShaderType type) {
 		GL_CHECK_PUSH_ERROR;
 		glCompileShader(program);
 		GL_CHECK_PUSH_ERROR;
+		if(!checkStatus) {
+			return program;
+		}
 		glGetShaderiv(program, GL_COMPILE_STATUS, &success);
 		GL_CHECK_PUSH_ERROR;
 		if(!success) {
@@ -257,7 +310,18 @@ unsigned int Shader::GetProgram() {
 }
 
 int Shader::GetUniformLocation(const char * name) const {
-	return glGetUniformLocation(program, name);
+	int location = glGetUniformLocation(program, name);
+	if(location < 0 || locationRemap.empty()) {
+		return location;
+	}
+	// after hot-reload return location from the space known to the user
+	auto it = locationInverse.find(location);
+	if(it != locationInverse.end()) {
+		return it->second;
+	}
+	locationRemap.emplace_back(location);
+	locationInverse[location] = locationRemap.size()-1;
+	return locationRemap.size()-1;
 }
 
 int Shader::GetAttributeLocation(const char * name) const {
@@ -273,6 +337,142 @@ int Shader::GetAttributeLocation(const std::string& name) const {
 	return GetAttributeLocation(name.c_str());
 }
 
+static bool IsSamplerType(GLenum type) {
+	switch(type) {
+		case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D:
+		case GL_SAMPLER_CUBE: case GL_SAMPLER_1D_SHADOW:
+		case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_1D_ARRAY:
+		case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_1D_ARRAY_SHADOW:
+		case GL_SAMPLER_2D_ARRAY_SHADOW: case GL_SAMPLER_2D_MULTISAMPLE:
+		case GL_SAMPLER_2D_MULTISAMPLE_ARRAY: case GL_SAMPLER_CUBE_SHADOW:
+		case GL_SAMPLER_BUFFER: case GL_SAMPLER_2D_RECT:
+		case GL_SAMPLER_2D_RECT_SHADOW: case GL_SAMPLER_CUBE_MAP_ARRAY:
+		case GL_SAMPLER_CUBE_MAP_ARRAY_SHADOW:
+		case GL_INT_SAMPLER_1D: case GL_INT_SAMPLER_2D: case GL_INT_SAMPLER_3D:
+		case GL_INT_SAMPLER_CUBE: case GL_INT_SAMPLER_1D_ARRAY:
+		case GL_INT_SAMPLER_2D_ARRAY: case GL_INT_SAMPLER_2D_MULTISAMPLE:
+		case GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY: case GL_INT_SAMPLER_BUFFER:
+		case GL_INT_SAMPLER_2D_RECT: case GL_INT_SAMPLER_CUBE_MAP_ARRAY:
+		case GL_UNSIGNED_INT_SAMPLER_1D: case GL_UNSIGNED_INT_SAMPLER_2D:
+		case GL_UNSIGNED_INT_SAMPLER_3D: case GL_UNSIGNED_INT_SAMPLER_CUBE:
+		case GL_UNSIGNED_INT_SAMPLER_1D_ARRAY:
+		case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+		case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE:
+		case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+		case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+		case GL_UNSIGNED_INT_SAMPLER_2D_RECT:
+		case GL_UNSIGNED_INT_SAMPLER_CUBE_MAP_ARRAY:
+			return true;
+	}
+	return false;
+}
+
+static bool IsImageType(GLenum type) {
+	switch(type) {
+		case GL_IMAGE_1D: case GL_IMAGE_2D: case GL_IMAGE_3D:
+		case GL_IMAGE_2D_RECT: case GL_IMAGE_CUBE: case GL_IMAGE_BUFFER:
+		case GL_IMAGE_1D_ARRAY: case GL_IMAGE_2D_ARRAY:
+		case GL_IMAGE_CUBE_MAP_ARRAY: case GL_IMAGE_2D_MULTISAMPLE:
+		case GL_IMAGE_2D_MULTISAMPLE_ARRAY:
+		case GL_INT_IMAGE_1D: case GL_INT_IMAGE_2D: case GL_INT_IMAGE_3D:
+		case GL_INT_IMAGE_2D_RECT: case GL_INT_IMAGE_CUBE:
+		case GL_INT_IMAGE_BUFFER: case GL_INT_IMAGE_1D_ARRAY:
+		case GL_INT_IMAGE_2D_ARRAY: case GL_INT_IMAGE_CUBE_MAP_ARRAY:
+		case GL_INT_IMAGE_2D_MULTISAMPLE:
+		case GL_INT_IMAGE_2D_MULTISAMPLE_ARRAY:
+		case GL_UNSIGNED_INT_IMAGE_1D: case GL_UNSIGNED_INT_IMAGE_2D:
+		case GL_UNSIGNED_INT_IMAGE_3D: case GL_UNSIGNED_INT_IMAGE_2D_RECT:
+		case GL_UNSIGNED_INT_IMAGE_CUBE: case GL_UNSIGNED_INT_IMAGE_BUFFER:
+		case GL_UNSIGNED_INT_IMAGE_1D_ARRAY:
+		case GL_UNSIGNED_INT_IMAGE_2D_ARRAY:
+		case GL_UNSIGNED_INT_IMAGE_CUBE_MAP_ARRAY:
+		case GL_UNSIGNED_INT_IMAGE_2D_MULTISAMPLE:
+		case GL_UNSIGNED_INT_IMAGE_2D_MULTISAMPLE_ARRAY:
+			return true;
+	}
+	return false;
+}
+
+void Shader::AssignTextureUnits() {
+	unitAssignments.clear();
+	std::vector<bool> used[2];
+	std::vector<int> pending;
+	char name[256];
+	
+	GLint count = 0;
+	glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+	const GLenum props[] = {GL_LOCATION, GL_TYPE, GL_ARRAY_SIZE, GL_BLOCK_INDEX};
+	for(GLint i=0; i<count; ++i) {
+		GLint v[4];
+		glGetProgramResourceiv(program, GL_UNIFORM, i, 4, props, 4, nullptr, v);
+		const bool image = IsImageType(v[1]);
+		if(v[0] < 0 || v[3] != -1 || !(image || IsSamplerType(v[1]))) {
+			continue;
+		}
+		glGetProgramResourceName(program, GL_UNIFORM, i, sizeof(name),
+				nullptr, name);
+		// array uniforms are reported as `name[0]`
+		std::string base = name;
+		if(v[2] > 1 && base.size() > 3
+				&& base.compare(base.size()-3, 3, "[0]") == 0) {
+			base.resize(base.size()-3);
+		}
+		for(GLint e=0; e<v[2]; ++e) {
+			GLint unit = 0;
+			glGetUniformiv(program, v[0]+e, &unit);
+			unitAssignments.push_back({v[2] > 1 ? base + "["
+					+ std::to_string(e) + "]" : base, unit, image});
+			// unit 0 is indistinguishable from no binding, so the first
+			// sampler (and image) reading 0 keeps it as if it was
+			// declared with binding=0, later ones get free units
+			if(unit || used[image].empty() || !used[image][0]) {
+				if((int)used[image].size() <= unit) {
+					used[image].resize(unit+1, false);
+				}
+				used[image][unit] = true;
+			} else {
+				pending.emplace_back(v[0]+e);
+				unitAssignments.back().unit = -1 - (int)pending.size();
+			}
+		}
+	}
+	
+	// remaining uniforms left at 0 get lowest free units
+	for(UnitAssignment& a : unitAssignments) {
+		if(a.unit >= 0) {
+			continue;
+		}
+		const int location = pending[-a.unit - 2];
+		std::vector<bool>& u = used[a.image];
+		a.unit = std::find(u.begin(), u.end(), false) - u.begin();
+		if(a.unit == (int)u.size()) {
+			u.emplace_back(true);
+		} else {
+			u[a.unit] = true;
+		}
+		glProgramUniform1i(program, location, a.unit);
+	}
+	GL_CHECK_PUSH_ERROR;
+}
+
+int Shader::GetTextureUnit(const char* name) const {
+	for(const UnitAssignment& a : unitAssignments) {
+		if(!a.image && a.name == name) {
+			return a.unit;
+		}
+	}
+	return -1;
+}
+
+int Shader::GetImageUnit(const char* name) const {
+	for(const UnitAssignment& a : unitAssignments) {
+		if(a.image && a.name == name) {
+			return a.unit;
+		}
+	}
+	return -1;
+}
+
 void Shader::SetTexture(int location, class Texture* texture,
 		unsigned textureId) {
 	glActiveTexture(GL_TEXTURE0+textureId);
@@ -292,10 +492,6 @@ void Shader::SetTextureImage(int location, class Texture* texture,
 		uint32_t unit, int32_t level, bool array,
 		int arrayLayerId, bool read, bool write, GLenum format) {
 	if(texture) {
-		glActiveTexture(GL_TEXTURE0+unit);
-		
-		GL_CHECK_PUSH_ERROR;
-		
 		texture->BindImage(unit, level, array, arrayLayerId, read, write, format);
 		
 		SetInt(location, unit);
@@ -306,111 +502,206 @@ void Shader::SetTextureImage(int location, class Texture* texture,
 	}
 }
 
+Shader::UniformWriteStats Shader::globalUniformWriteStats{0, 0};
+
+bool Shader::UpdateShadow(int location, const void* data, uint32_t bytes,
+		uint32_t count) {
+	if(location < 0 || program == 0) {
+		return false;
+	}
+	++uniformWriteStats.writes;
+	++globalUniformWriteStats.writes;
+	// array elements have consecutive locations, each is shadowed separately
+	// so that writes of single elements and whole arrays stay consistent
+	if(location+count > shadowEntries.size()) {
+		shadowEntries.resize(location+count, ShadowEntry{0, 0, 0});
+	}
+	const uint8_t* bytesData = (const uint8_t*)data;
+	bool changed = false;
+	for(uint32_t i=0; i<count; ++i, bytesData+=bytes) {
+		ShadowEntry& entry = shadowEntries[location+i];
+		if(entry.bytes == bytes) {
+			if(memcmp(shadowData.data()+entry.offset, bytesData, bytes) == 0) {
+				continue;
+			}
+		} else if(entry.capacity >= bytes) {
+			entry.bytes = bytes;
+		} else {
+			entry.offset = shadowData.size();
+			entry.bytes = entry.capacity = bytes;
+			shadowData.resize(shadowData.size() + bytes);
+		}
+		memcpy(shadowData.data()+entry.offset, bytesData, bytes);
+		changed = true;
+	}
+	if(!changed) {
+		++uniformWriteStats.filtered;
+		++globalUniformWriteStats.filtered;
+	}
+	return changed;
+}
+
+void Shader::InvalidateUniformShadow() {
+	shadowEntries.clear();
+	shadowData.clear();
+}
+
+Shader::UniformWriteStats Shader::GetUniformWriteStats() const {
+	return uniformWriteStats;
+}
+
+Shader::UniformWriteStats Shader::GetGlobalUniformWriteStats() {
+	return globalUniformWriteStats;
+}
+
+void Shader::ResetUniformWriteStats() {
+	uniformWriteStats = {0, 0};
+}
+
 void Shader::SetBool(int location, bool value) {
-	Use();
-	glUniform1i(location, (int)value); 
-	GL_CHECK_PUSH_ERROR;
+	SetInt(location, (int)value);
 }
 
 void Shader::SetUInt(int location, uint32_t value) {
-	GL_CHECK_PUSH_ERROR;
-	Use();
-	GL_CHECK_PUSH_ERROR;
-	glProgramUniform1ui(program, location, value);
-	GL_CHECK_PUSH_ERROR;
+	location = RemapLocation(location);
+	if(UpdateShadow(location, &value, sizeof(value))) {
+		glProgramUniform1ui(program, location, value);
+		GL_CHECK_PUSH_ERROR;
+	}
 }
 
 void Shader::SetInt(int location, int value) {
-	GL_CHECK_PUSH_ERROR;
-	Use();
-	GL_CHECK_PUSH_ERROR;
-	glProgramUniform1i(program, location, value);
-	GL_CHECK_PUSH_ERROR;
+	location = RemapLocation(location);
+	if(UpdateShadow(location, &value, sizeof(value))) {
+		glProgramUniform1i(program, location, value);
+		GL_CHECK_PUSH_ERROR;
+	}
 }
 
 void Shader::SetInt(int location, const std::vector<int>& array) {
-	Use();
-	glUniform1uiv(location, array.size(), (unsigned int*)&array.front());
-	GL_CHECK_PUSH_ERROR;
+	location = RemapLocation(location);
+	if(array.size() && UpdateShadow(location, array.data(),
+				sizeof(int), array.size())) {
+		glProgramUniform1iv(program, location, array.size(), array.data());
+		GL_CHECK_PUSH_ERROR;
+	}
 }
 
 void Shader::SetUInt(int location, const std::vector<unsigned int>& array) {
-	Use();
-	glUniform1uiv(location, array.size(), &array.front());
-	GL_CHECK_PUSH_ERROR;
+	location = RemapLocation(location);
+	if(array.size() && UpdateShadow(location, array.data(),
+				sizeof(unsigned int), array.size())) {
+		glProgramUniform1uiv(program, location, array.size(), array.data());
+		GL_CHECK_PUSH_ERROR;
+	}
 }
 
 void Shader::SetFloat(int location, float value) { 
-	Use();
-	glUniform1f(location, value); 
-	GL_CHECK_PUSH_ERROR;
+	location = RemapLocation(location);
+	if(UpdateShadow(location, &value, sizeof(value))) {
+		glProgramUniform1f(program, location, value);
+		GL_CHECK_PUSH_ERROR;
+	}
 }
 
 void Shader::SetFloat(int location, const std::vector<float>& array) {
-	Use();
-	glUniform1fv(location, array.size(), &array.front());
-	GL_CHECK_PUSH_ERROR;
+	location = RemapLocation(location);
+	if(array.size() && UpdateShadow(location, array.data(),
+				sizeof(float), array.size())) {
+		glProgramUniform1fv(program, location, array.size(), array.data());
+		GL_CHECK_PUSH_ERROR;
+	}
 }
 
 void Shader::SetVec2(int location, const glm::vec2 &value) {
-	Use();
-	glUniform2fv(location, 1, glm::value_ptr(value));
-	GL_CHECK_PUSH_ERROR;
+	location = RemapLocation(location);
+	if(UpdateShadow(location, &value, sizeof(value))) {
+		glProgramUniform2fv(program, location, 1, glm::value_ptr(value));
+		GL_CHECK_PUSH_ERROR;
+	}
 }
 
 void Shader::SetVec3(int location, const glm::vec3 &value) {
-	Use();
-	glUniform3fv(location, 1, glm::value_ptr(value));
-	GL_CHECK_PUSH_ERROR;
+	location = RemapLocation(location);
+	if(UpdateShadow(location, &value, sizeof(value))) {
+		glProgramUniform3fv(program, location, 1, glm::value_ptr(value));
+		GL_CHECK_PUSH_ERROR;
+	}
+}
+
+void Shader::SetVec4(int location, const glm::vec4 &value) {
+	location = RemapLocation(location);
+	if(UpdateShadow(location, &value, sizeof(value))) {
+		glProgramUniform4fv(program, location, 1, glm::value_ptr(value));
+		GL_CHECK_PUSH_ERROR;
+	}
 }
 
 void Shader::SetVec2(int location, const std::vector<glm::vec2>& array) {
-	Use();
-	glUniform2fv(location, array.size(), (float*)&array.front());
-	GL_CHECK_PUSH_ERROR;
+	location = RemapLocation(location);
+	if(array.size() && UpdateShadow(location, array.data(),
+				sizeof(glm::vec2), array.size())) {
+		glProgramUniform2fv(program, location, array.size(),
+				(const float*)array.data());
+		GL_CHECK_PUSH_ERROR;
+	}
 }
 
 void Shader::SetVec3(int location, const std::vector<glm::vec3>& array) {
-	Use();
-	glUniform3fv(location, array.size(), (float*)&array.front());
-	GL_CHECK_PUSH_ERROR;
+	location = RemapLocation(location);
+	if(array.size() && UpdateShadow(location, array.data(),
+				sizeof(glm::vec3), array.size())) {
+		glProgramUniform3fv(program, location, array.size(),
+				(const float*)array.data());
+		GL_CHECK_PUSH_ERROR;
+	}
 }
 
 void Shader::SetVec4(int location, const std::vector<glm::vec4>& array) {
-	Use();
-	glUniform4fv(location, array.size(), (float*)&array.front());
-	GL_CHECK_PUSH_ERROR;
-}
-
-void Shader::SetVec4(int location, const glm::vec4 &value) {
-	Use();
-	glUniform4fv(location, 1, glm::value_ptr(value));
-	GL_CHECK_PUSH_ERROR;
+	location = RemapLocation(location);
+	if(array.size() && UpdateShadow(location, array.data(),
+				sizeof(glm::vec4), array.size())) {
+		glProgramUniform4fv(program, location, array.size(),
+				(const float*)array.data());
+		GL_CHECK_PUSH_ERROR;
+	}
 }
 
 void Shader::SetMat2(int location, const glm::mat2 &mat) {
-	Use();
-	glUniformMatrix2fv(location, 1, GL_FALSE, glm::value_ptr(mat));
-	GL_CHECK_PUSH_ERROR;
+	location = RemapLocation(location);
+	if(UpdateShadow(location, &mat, sizeof(mat))) {
+		glProgramUniformMatrix2fv(program, location, 1, GL_FALSE,
+				glm::value_ptr(mat));
+		GL_CHECK_PUSH_ERROR;
+	}
 }
 
 void Shader::SetMat3(int location, const glm::mat3 &mat) {
-	Use();
-	glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(mat));
-	GL_CHECK_PUSH_ERROR;
+	location = RemapLocation(location);
+	if(UpdateShadow(location, &mat, sizeof(mat))) {
+		glProgramUniformMatrix3fv(program, location, 1, GL_FALSE,
+				glm::value_ptr(mat));
+		GL_CHECK_PUSH_ERROR;
+	}
 }
 
 void Shader::SetMat4(int location, const glm::mat4 &mat) {
-	Use();
-	glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat));
-	GL_CHECK_PUSH_ERROR;
+	location = RemapLocation(location);
+	if(UpdateShadow(location, &mat, sizeof(mat))) {
+		glProgramUniformMatrix4fv(program, location, 1, GL_FALSE,
+				glm::value_ptr(mat));
+		GL_CHECK_PUSH_ERROR;
+	}
 }
 
 void Shader::SetMat4(int location, const std::vector<glm::mat4>& array) {
-	Use();
-	glUniformMatrix4fv(location, array.size()*16*4, GL_FALSE,
-			(float*)&array.front());
-	GL_CHECK_PUSH_ERROR;
+	location = RemapLocation(location);
+	if(array.size() && UpdateShadow(location, array.data(),
+				sizeof(glm::mat4), array.size())) {
+		glProgramUniformMatrix4fv(program, location, array.size(), GL_FALSE,
+				(const float*)array.data());
+		GL_CHECK_PUSH_ERROR;
+	}
 }
 
 void Shader::Destroy() {
@@ -422,60 +713,203 @@ void Shader::Destroy() {
 		program = 0;
 		GL_CHECK_PUSH_ERROR;
 	}
+	locationRemap.clear();
+	locationInverse.clear();
+	InvalidateUniformShadow();
+}
+
+static void CopyUniformValue(unsigned src, int srcLocation, unsigned dst,
+		int dstLocation, GLenum type) {
+	union {
+		float f[16];
+		int i[16];
+		uint32_t u[16];
+	} v;
+	switch(type) {
+		case GL_FLOAT:
+		case GL_FLOAT_VEC2:
+		case GL_FLOAT_VEC3:
+		case GL_FLOAT_VEC4:
+			glGetUniformfv(src, srcLocation, v.f);
+			switch(type) {
+				case GL_FLOAT: glProgramUniform1fv(dst, dstLocation, 1, v.f); break;
+				case GL_FLOAT_VEC2: glProgramUniform2fv(dst, dstLocation, 1, v.f); break;
+				case GL_FLOAT_VEC3: glProgramUniform3fv(dst, dstLocation, 1, v.f); break;
+				case GL_FLOAT_VEC4: glProgramUniform4fv(dst, dstLocation, 1, v.f); break;
+			}
+			break;
+		case GL_FLOAT_MAT2:
+			glGetUniformfv(src, srcLocation, v.f);
+			glProgramUniformMatrix2fv(dst, dstLocation, 1, GL_FALSE, v.f);
+			break;
+		case GL_FLOAT_MAT3:
+			glGetUniformfv(src, srcLocation, v.f);
+			glProgramUniformMatrix3fv(dst, dstLocation, 1, GL_FALSE, v.f);
+			break;
+		case GL_FLOAT_MAT4:
+			glGetUniformfv(src, srcLocation, v.f);
+			glProgramUniformMatrix4fv(dst, dstLocation, 1, GL_FALSE, v.f);
+			break;
+		case GL_UNSIGNED_INT:
+		case GL_UNSIGNED_INT_VEC2:
+		case GL_UNSIGNED_INT_VEC3:
+		case GL_UNSIGNED_INT_VEC4:
+			glGetUniformuiv(src, srcLocation, v.u);
+			switch(type) {
+				case GL_UNSIGNED_INT: glProgramUniform1uiv(dst, dstLocation, 1, v.u); break;
+				case GL_UNSIGNED_INT_VEC2: glProgramUniform2uiv(dst, dstLocation, 1, v.u); break;
+				case GL_UNSIGNED_INT_VEC3: glProgramUniform3uiv(dst, dstLocation, 1, v.u); break;
+				case GL_UNSIGNED_INT_VEC4: glProgramUniform4uiv(dst, dstLocation, 1, v.u); break;
+			}
+			break;
+		case GL_INT_VEC2:
+		case GL_BOOL_VEC2:
+			glGetUniformiv(src, srcLocation, v.i);
+			glProgramUniform2iv(dst, dstLocation, 1, v.i);
+			break;
+		case GL_INT_VEC3:
+		case GL_BOOL_VEC3:
+			glGetUniformiv(src, srcLocation, v.i);
+			glProgramUniform3iv(dst, dstLocation, 1, v.i);
+			break;
+		case GL_INT_VEC4:
+		case GL_BOOL_VEC4:
+			glGetUniformiv(src, srcLocation, v.i);
+			glProgramUniform4iv(dst, dstLocation, 1, v.i);
+			break;
+		case GL_DOUBLE:
+		case GL_DOUBLE_VEC2:
+		case GL_DOUBLE_VEC3:
+		case GL_DOUBLE_VEC4:
+		case GL_FLOAT_MAT2x3:
+		case GL_FLOAT_MAT2x4:
+		case GL_FLOAT_MAT3x2:
+		case GL_FLOAT_MAT3x4:
+		case GL_FLOAT_MAT4x2:
+		case GL_FLOAT_MAT4x3:
+			// not settable through gl::Shader, not copied
+			break;
+		default:
+			// int, bool, samplers and images
+			glGetUniformiv(src, srcLocation, v.i);
+			glProgramUniform1iv(dst, dstLocation, 1, v.i);
+	}
+}
+
+void Shader::ReplaceProgram(unsigned newProgram) {
+	const unsigned oldProgram = program;
+	char name[256];
+	
+	// copy uniform values and remember where each location has moved
+	std::unordered_map<int, int> oldToNew;
+	GLint count = 0;
+	glGetProgramInterfaceiv(oldProgram, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+	const GLenum props[] = {GL_LOCATION, GL_TYPE, GL_ARRAY_SIZE, GL_BLOCK_INDEX};
+	for(GLint i=0; i<count; ++i) {
+		GLint v[4];
+		glGetProgramResourceiv(oldProgram, GL_UNIFORM, i, 4, props, 4, nullptr, v);
+		if(v[0] < 0 || v[3] != -1) {
+			continue;
+		}
+		glGetProgramResourceName(oldProgram, GL_UNIFORM, i, sizeof(name),
+				nullptr, name);
+		GLuint newIndex = glGetProgramResourceIndex(newProgram, GL_UNIFORM, name);
+		if(newIndex == GL_INVALID_INDEX) {
+			continue;
+		}
+		GLint n[3];
+		glGetProgramResourceiv(newProgram, GL_UNIFORM, newIndex, 3, props, 3,
+				nullptr, n);
+		if(n[0] < 0 || n[1] != v[1]) {
+			continue;
+		}
+		for(GLint e=0; e<std::min(v[2], n[2]); ++e) {
+			oldToNew[v[0]+e] = n[0]+e;
+			CopyUniformValue(oldProgram, v[0]+e, newProgram, n[0]+e, v[1]);
+		}
+	}
+	GL_CHECK_PUSH_ERROR;
+	
+	// keep uniform block and shader storage block bindings
+	for(GLenum iface : {GL_UNIFORM_BLOCK, GL_SHADER_STORAGE_BLOCK}) {
+		glGetProgramInterfaceiv(oldProgram, iface, GL_ACTIVE_RESOURCES, &count);
+		for(GLint i=0; i<count; ++i) {
+			glGetProgramResourceName(oldProgram, iface, i, sizeof(name),
+					nullptr, name);
+			GLuint newIndex = glGetProgramResourceIndex(newProgram, iface, name);
+			if(newIndex == GL_INVALID_INDEX) {
+				continue;
+			}
+			const GLenum prop = GL_BUFFER_BINDING;
+			GLint binding = 0;
+			glGetProgramResourceiv(oldProgram, iface, i, 1, &prop, 1, nullptr,
+					&binding);
+			if(iface == GL_UNIFORM_BLOCK) {
+				glUniformBlockBinding(newProgram, newIndex, binding);
+			} else {
+				glShaderStorageBlockBinding(newProgram, newIndex, binding);
+			}
+		}
+	}
+	GL_CHECK_PUSH_ERROR;
+	
+	// compose with previous remapping so that locations obtained before any
+	// reload are still valid
+	if(locationRemap.empty()) {
+		int maxLocation = -1;
+		for(auto it : oldToNew) {
+			maxLocation = std::max(maxLocation, it.first);
+		}
+		locationRemap.resize(maxLocation+1);
+		for(int i=0; i<=maxLocation; ++i) {
+			locationRemap[i] = i;
+		}
+	}
+	bool identity = true;
+	locationInverse.clear();
+	for(size_t i=0; i<locationRemap.size(); ++i) {
+		auto it = oldToNew.find(locationRemap[i]);
+		locationRemap[i] = it != oldToNew.end() ? it->second : -1;
+		identity &= locationRemap[i] == (int)i;
+		if(locationRemap[i] >= 0) {
+			locationInverse[locationRemap[i]] = i;
+		}
+	}
+	if(identity) {
+		locationRemap.clear();
+		locationInverse.clear();
+	}
+	
+	if(currentProgram == oldProgram) {
+		glUseProgram(newProgram);
+		currentProgram = newProgram;
+	}
+	glDeleteProgram(oldProgram);
+	program = newProgram;
+	InvalidateUniformShadow();
+	// copied units are kept, new samplers get free units
+	AssignTextureUnits();
+	if(stagePaths.size() == 1) {
+		glGetProgramiv(program, GL_COMPUTE_WORK_GROUP_SIZE, workgroupSize);
+	}
+	GL_CHECK_PUSH_ERROR;
 }
 
 Shader::Shader() {
 	program = 0;
+	watcher = nullptr;
+	uniformWriteStats = {0, 0};
 }
 
 Shader::~Shader() {
+	if(watcher) {
+		watcher->Unwatch(this);
+	}
 	Destroy();
 }
 
-std::string Shader::LoadFileUseIncludes(const std::string& filePath)
-{
-	auto pathEnd = filePath.find_last_of("/\\");
-	std::string path = "./";
-	if (pathEnd != std::string::npos) {
-		path = filePath.substr(0, pathEnd+1);
-	}
-	std::string code = LoadFile(filePath);
-	if (code == "") {
-		return "";
-	}
-	code.reserve(1024*1024);
-	
-	auto start = code.find("#include");
-	for (;;) {
-		start = code.find("#include", start);
-		if (start == std::string::npos) {
-			break;
-		}
-		const auto end = code.find_first_of("\n", start);
-		if (end == std::string::npos) {
-			code.replace(start, end-start, "#error include directive cannot be at the end of file, it needs new line");
-			break;
-		}
-		const auto startFileName = code.find("\"", start);
-		const auto endFileName = code.find("\"", startFileName+1);
-		bool includeError = false;
-		includeError |= startFileName == std::string::npos;
-		includeError |= endFileName == std::string::npos;
-		includeError |= end <= endFileName;
-		includeError |= endFileName <= startFileName;
-		const std::string includePath = path + code.substr(startFileName+1, endFileName-startFileName-1);
-		const std::string includedCode = LoadFileUseIncludes(includePath);
-		includeError |= includedCode == "";
-		if (includeError) {
-			code.replace(end, 0, std::string("\n#error Failed to include: `") + includePath + "`");
-			break;
-		} else {
-			code.insert(end, std::string("\n") + includedCode.c_str());
-			code.replace(start, 1, "//%:");
-			start += 3 + strlen(includedCode.c_str());
-		}
-	}
-	return code;
+std::string Shader::LoadFileUseIncludes(const std::string& filePath) {
+	return ShaderPreprocessor::Process(filePath).code;
 }
 
 }
@@ -0,0 +1,331 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "../include/openglwrapper/ShaderPreprocessor.hpp"
+
+namespace gl {
+
+namespace {
+	enum PieceType {
+		PIECE_TEXT,
+		PIECE_INCLUDE,
+		PIECE_PRAGMA_ONCE,
+	};
+
+	struct Piece {
+		PieceType type;
+		// text range in CachedFile::content, for directives it is the whole
+		// directive line without the new line character
+		size_t begin, end;
+		// line number of directive
+		uint32_t line;
+		std::string includePath;
+	};
+
+	struct CachedFile {
+		std::filesystem::file_time_type mtime;
+		uintmax_t size;
+		std::string content;
+		std::vector<Piece> pieces;
+		std::vector<std::string> includes;
+		bool pragmaOnce;
+		bool exists;
+	};
+
+	std::unordered_map<std::string, CachedFile> cache;
+	std::mutex mutex;
+
+	inline bool IsBlank(char c) {
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	bool StartsWithWord(const std::string& s, size_t pos, size_t end,
+			const char* word) {
+		size_t i = 0;
+		for(; word[i]; ++i) {
+			if(pos+i >= end || s[pos+i] != word[i]) {
+				return false;
+			}
+		}
+		return pos+i == end || IsBlank(s[pos+i]) || s[pos+i] == '"'
+			|| s[pos+i] == '<';
+	}
+
+	// Splits file content into text and directive pieces in a single pass.
+	void Parse(const std::string& path, CachedFile& file) {
+		file.pieces.clear();
+		file.includes.clear();
+		file.pragmaOnce = false;
+
+		const std::string& s = file.content;
+		const std::filesystem::path dir
+			= std::filesystem::path(path).parent_path();
+		size_t textBegin = 0;
+		bool inBlockComment = false;
+		uint32_t line = 1;
+		for(size_t lineBegin = 0; lineBegin < s.size(); ++line) {
+			size_t lineEnd = s.find('\n', lineBegin);
+			if(lineEnd == std::string::npos) {
+				lineEnd = s.size();
+			}
+
+			size_t p = lineBegin;
+			while(p < lineEnd && IsBlank(s[p])) {
+				++p;
+			}
+			if(!inBlockComment && p < lineEnd && s[p] == '#') {
+				size_t d = p+1;
+				while(d < lineEnd && IsBlank(s[d])) {
+					++d;
+				}
+				Piece piece{PIECE_TEXT, lineBegin, lineEnd, line, ""};
+				if(StartsWithWord(s, d, lineEnd, "include")) {
+					piece.type = PIECE_INCLUDE;
+					size_t a = s.find_first_of("\"<", d+7);
+					size_t b = std::string::npos;
+					if(a < lineEnd) {
+						b = s.find(s[a] == '"' ? '"' : '>', a+1);
+					}
+					if(b < lineEnd) {
+						piece.includePath = (dir / s.substr(a+1, b-a-1))
+							.lexically_normal().generic_string();
+						file.includes.emplace_back(piece.includePath);
+					}
+				} else if(StartsWithWord(s, d, lineEnd, "pragma")) {
+					size_t o = d+6;
+					while(o < lineEnd && IsBlank(s[o])) {
+						++o;
+					}
+					if(StartsWithWord(s, o, lineEnd, "once")) {
+						piece.type = PIECE_PRAGMA_ONCE;
+						file.pragmaOnce = true;
+					}
+				}
+				if(piece.type != PIECE_TEXT) {
+					file.pieces.push_back(
+							Piece{PIECE_TEXT, textBegin, lineBegin, 0, ""});
+					file.pieces.emplace_back(std::move(piece));
+					textBegin = lineEnd < s.size() ? lineEnd+1 : lineEnd;
+				}
+			}
+
+			// track block comments so that commented out directives are kept
+			for(size_t i = p; i+1 < lineEnd; ++i) {
+				if(inBlockComment) {
+					if(s[i] == '*' && s[i+1] == '/') {
+						inBlockComment = false;
+						++i;
+					}
+				} else if(s[i] == '/') {
+					if(s[i+1] == '/') {
+						break;
+					} else if(s[i+1] == '*') {
+						inBlockComment = true;
+						++i;
+					}
+				}
+			}
+
+			lineBegin = lineEnd+1;
+		}
+		file.pieces.push_back(Piece{PIECE_TEXT, textBegin, s.size(), 0, ""});
+	}
+
+	// Returns cached file, rereading it when modification time or size has
+	// changed. Each file is validated at most once per processing run.
+	CachedFile& Fetch(const std::string& path,
+			std::unordered_set<std::string>& validated) {
+		CachedFile& file = cache[path];
+		if(validated.insert(path).second == false) {
+			return file;
+		}
+
+		std::error_code ec;
+		auto mtime = std::filesystem::last_write_time(path, ec);
+		uintmax_t size = ec ? 0 : std::filesystem::file_size(path, ec);
+		if(ec) {
+			file = CachedFile{};
+			file.exists = false;
+			return file;
+		}
+		if(file.exists && file.mtime == mtime && file.size == size) {
+			return file;
+		}
+
+		std::ifstream stream(path, std::ios::binary|std::ios::in);
+		if(!stream.good()) {
+			file = CachedFile{};
+			file.exists = false;
+			return file;
+		}
+		file.content.resize(size);
+		stream.read(file.content.data(), size);
+		file.content.resize(stream.gcount());
+		file.mtime = mtime;
+		file.size = size;
+		file.exists = true;
+		Parse(path, file);
+		return file;
+	}
+
+	struct Context {
+		ShaderPreprocessor::Result& result;
+		std::unordered_set<std::string> validated;
+		std::unordered_set<std::string> onceIncluded;
+		std::unordered_map<std::string, uint32_t> fileIds;
+		std::vector<std::string> stack;
+	};
+
+	void Emit(Context& ctx, const std::string& path, uint32_t fileId) {
+		CachedFile& file = Fetch(path, ctx.validated);
+		std::string& out = ctx.result.code;
+		ctx.stack.emplace_back(path);
+		for(const Piece& piece : file.pieces) {
+			if(piece.type == PIECE_TEXT) {
+				out.append(file.content, piece.begin, piece.end-piece.begin);
+				continue;
+			}
+
+			// keep directive as comment to preserve line numbering
+			out.append("//");
+			out.append(file.content, piece.begin, piece.end-piece.begin);
+			out.push_back('\n');
+			if(piece.type != PIECE_INCLUDE) {
+				continue;
+			}
+
+			const std::string& include = piece.includePath;
+			if(include == "") {
+				out.append("#error Invalid include directive\n");
+				ctx.result.success = false;
+				continue;
+			}
+			bool cycle = false;
+			for(const std::string& p : ctx.stack) {
+				cycle |= p == include;
+			}
+			if(cycle) {
+				out.append("#error Include cycle detected: `" + include
+						+ "`\n");
+				ctx.result.success = false;
+				continue;
+			}
+			if(ctx.onceIncluded.count(include)) {
+				continue;
+			}
+			CachedFile& included = Fetch(include, ctx.validated);
+			if(included.exists == false) {
+				out.append("#error Failed to include: `" + include + "`\n");
+				ctx.result.success = false;
+				continue;
+			}
+			if(included.pragmaOnce) {
+				ctx.onceIncluded.insert(include);
+			}
+
+			auto id = ctx.fileIds.emplace(include, ctx.result.files.size());
+			if(id.second) {
+				ctx.result.files.emplace_back(include);
+			}
+			const uint32_t includedId = id.first->second;
+			out.append("#line 1 " + std::to_string(includedId) + "\n");
+			Emit(ctx, include, includedId);
+			if(out.size() && out.back() != '\n') {
+				out.push_back('\n');
+			}
+			out.append("#line " + std::to_string(piece.line+1) + " "
+					+ std::to_string(fileId) + "\n");
+		}
+		ctx.stack.pop_back();
+	}
+}
+
+ShaderPreprocessor::Result ShaderPreprocessor::Process(
+		const std::string& filePath) {
+	Result result;
+	result.success = false;
+	if(filePath == "") {
+		return result;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	const std::string path = NormalizePath(filePath);
+	Context ctx{result};
+	CachedFile& root = Fetch(path, ctx.validated);
+	if(root.exists == false) {
+		return result;
+	}
+	result.success = true;
+	result.files.emplace_back(path);
+	ctx.fileIds.emplace(path, 0);
+	result.code.reserve(root.content.size() * 2);
+	if(root.pragmaOnce) {
+		ctx.onceIncluded.insert(path);
+	}
+	Emit(ctx, path, 0);
+	return result;
+}
+
+std::vector<std::string> ShaderPreprocessor::GetDependents(
+		const std::string& filePath) {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::unordered_map<std::string, std::vector<const std::string*>> reverse;
+	for(const auto& it : cache) {
+		for(const std::string& include : it.second.includes) {
+			reverse[include].emplace_back(&it.first);
+		}
+	}
+
+	std::vector<std::string> dependents{NormalizePath(filePath)};
+	std::unordered_set<std::string> visited{dependents[0]};
+	for(size_t i = 0; i < dependents.size(); ++i) {
+		auto it = reverse.find(dependents[i]);
+		if(it == reverse.end()) {
+			continue;
+		}
+		for(const std::string* p : it->second) {
+			if(visited.insert(*p).second) {
+				dependents.emplace_back(*p);
+			}
+		}
+	}
+	return dependents;
+}
+
+std::string ShaderPreprocessor::NormalizePath(const std::string& filePath) {
+	return std::filesystem::path(filePath).lexically_normal()
+		.generic_string();
+}
+
+void ShaderPreprocessor::Invalidate(const std::string& filePath) {
+	std::lock_guard<std::mutex> lock(mutex);
+	cache.erase(NormalizePath(filePath));
+}
+
+void ShaderPreprocessor::ClearCache() {
+	std::lock_guard<std::mutex> lock(mutex);
+	cache.clear();
+}
+
+} // namespace gl
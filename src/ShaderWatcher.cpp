@@ -0,0 +1,390 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <filesystem>
+#include <chrono>
+#include <cstdio>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include "../include/openglwrapper/OpenGL.hpp"
+#include "../include/openglwrapper/Shader.hpp"
+
+#include "../include/openglwrapper/ShaderWatcher.hpp"
+
+namespace gl {
+
+ShaderWatcher::ShaderWatcher() {
+	inotifyFd = -1;
+#ifdef __linux__
+	inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(inotifyFd < 0) {
+		printf("\n ShaderWatcher: inotify_init1 failed, falling back to polling\n");
+	}
+#endif
+	parallelCompile = GLEW_KHR_parallel_shader_compile
+		|| GLEW_ARB_parallel_shader_compile;
+	if(parallelCompile) {
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+		GL_CHECK_PUSH_ERROR;
+	}
+	running = true;
+	thread = std::thread([this](){ Run(); });
+}
+
+ShaderWatcher::~ShaderWatcher() {
+	running = false;
+	if(thread.joinable()) {
+		thread.join();
+	}
+#ifdef __linux__
+	if(inotifyFd >= 0) {
+		close(inotifyFd);
+	}
+#endif
+	for(auto& it : shaders) {
+		it.first->watcher = nullptr;
+	}
+	for(Compilation& c : compiling) {
+		DeleteCompilation(c);
+	}
+}
+
+void ShaderWatcher::Watch(Shader* shader) {
+	if(shader->watcher == this) {
+		return;
+	} else if(shader->watcher) {
+		shader->watcher->Unwatch(shader);
+	}
+	if(shader->stagePaths.empty()) {
+		GL_PUSH_CUSTOM_ERROR(-1, "ShaderWatcher can only watch shaders created "
+				"with Shader::Load.");
+		return;
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	shader->watcher = this;
+	Entry& entry = shaders[shader];
+	entry.stagePaths = shader->stagePaths;
+	entry.files = shader->sourceFiles;
+	AddDirectories(entry.files);
+}
+
+void ShaderWatcher::Unwatch(Shader* shader) {
+	std::lock_guard<std::mutex> lock(mutex);
+	shader->watcher = nullptr;
+	shaders.erase(shader);
+	for(size_t i=0; i<ready.size();) {
+		if(ready[i].shader == shader) {
+			ready.erase(ready.begin()+i);
+		} else {
+			++i;
+		}
+	}
+	for(size_t i=0; i<compiling.size();) {
+		if(compiling[i].shader == shader) {
+			DeleteCompilation(compiling[i]);
+			compiling.erase(compiling.begin()+i);
+		} else {
+			++i;
+		}
+	}
+}
+
+void ShaderWatcher::NotifyChanged(const std::string& filePath) {
+	ProcessChanges({ShaderPreprocessor::NormalizePath(filePath)});
+}
+
+void ShaderWatcher::Update() {
+	std::vector<Compilation> toStart;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		toStart.swap(ready);
+	}
+	for(Compilation& c : toStart) {
+		// newer sources replace compilation still in progress
+		for(size_t i=0; i<compiling.size(); ++i) {
+			if(compiling[i].shader == c.shader) {
+				DeleteCompilation(compiling[i]);
+				compiling.erase(compiling.begin()+i);
+				break;
+			}
+		}
+		if(parallelCompile) {
+			StartCompilation(c);
+		}
+		compiling.emplace_back(std::move(c));
+	}
+
+	for(size_t i=0; i<compiling.size();) {
+		Compilation& c = compiling[i];
+		if(parallelCompile) {
+			GLint done = GL_FALSE;
+			glGetProgramiv(c.program, GL_COMPLETION_STATUS_KHR, &done);
+			if(done == GL_FALSE) {
+				++i;
+				continue;
+			}
+		} else if(c.step <= c.stages.size()) {
+			// driver compiles synchronously, single step per frame
+			AdvanceCompilation(c);
+			break;
+		}
+		if(FinishCompilation(c)) {
+			printf("\n ShaderWatcher: reloaded `%s`\n",
+					c.stages[0].files.size() ? c.stages[0].files[0].c_str() : "");
+		}
+		compiling.erase(compiling.begin()+i);
+		if(!parallelCompile) {
+			break;
+		}
+	}
+}
+
+void ShaderWatcher::StartCompilation(Compilation& c) {
+	while(c.step <= c.stages.size()) {
+		AdvanceCompilation(c);
+	}
+}
+
+void ShaderWatcher::AdvanceCompilation(Compilation& c) {
+	static const ShaderType graphicsTypes[] = {
+		VERTEX_SHADER, GEOMETRY_SHADER, FRAGMENT_SHADER
+	};
+	if(c.program == 0) {
+		c.program = glCreateProgram();
+	}
+	if(c.step < c.stages.size()) {
+		ShaderType type = c.stages.size() == 1 ? COMPUTE_SHADER
+			: graphicsTypes[c.step];
+		unsigned s = Shader::CompileGLSL(c.stages[c.step].code, type, false);
+		if(s) {
+			glAttachShader(c.program, s);
+			c.shaders.emplace_back(s);
+		}
+		++c.step;
+		return;
+	}
+	
+	// keep vertex attribute locations used by already configured VAOs
+	const unsigned oldProgram = c.shader->program;
+	GLint count = 0;
+	glGetProgramInterfaceiv(oldProgram, GL_PROGRAM_INPUT, GL_ACTIVE_RESOURCES,
+			&count);
+	for(GLint i=0; i<count && c.stages.size() > 1; ++i) {
+		char name[256];
+		const GLenum prop = GL_LOCATION;
+		GLint location = -1;
+		glGetProgramResourceiv(oldProgram, GL_PROGRAM_INPUT, i, 1, &prop, 1,
+				nullptr, &location);
+		glGetProgramResourceName(oldProgram, GL_PROGRAM_INPUT, i, sizeof(name),
+				nullptr, name);
+		if(location >= 0) {
+			glBindAttribLocation(c.program, location, name);
+		}
+	}
+	
+	glLinkProgram(c.program);
+	GL_CHECK_PUSH_ERROR;
+	++c.step;
+}
+
+bool ShaderWatcher::FinishCompilation(Compilation& c) {
+	GLint linked = GL_FALSE;
+	glGetProgramiv(c.program, GL_LINK_STATUS, &linked);
+	if(linked == GL_FALSE) {
+		char infoLog[5120];
+		for(unsigned s : c.shaders) {
+			GLint compiled = GL_FALSE;
+			glGetShaderiv(s, GL_COMPILE_STATUS, &compiled);
+			if(compiled == GL_FALSE) {
+				glGetShaderInfoLog(s, sizeof(infoLog), nullptr, infoLog);
+				printf("\n ERROR::SHADER::HOT_RELOAD::COMPILATION_FAILED\n %s",
+						infoLog);
+			}
+		}
+		Shader::CheckProgramStatus(c.program);
+		for(auto& stage : c.stages) {
+			for(size_t j=0; j<stage.files.size(); ++j) {
+				printf("\n %5zu: %s", j, stage.files[j].c_str());
+			}
+		}
+		printf("\n ShaderWatcher: keeping previous program\n");
+		DeleteCompilation(c);
+		return false;
+	}
+
+	for(unsigned s : c.shaders) {
+		glDetachShader(c.program, s);
+		glDeleteShader(s);
+	}
+	c.shaders.clear();
+	c.shader->ReplaceProgram(c.program);
+	c.shader->SetSourceFiles(c.stages.data(), c.stages.size(), 0);
+	c.program = 0;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = shaders.find(c.shader);
+	if(it != shaders.end()) {
+		it->second.files = c.shader->sourceFiles;
+		AddDirectories(it->second.files);
+	}
+	return true;
+}
+
+void ShaderWatcher::DeleteCompilation(Compilation& c) {
+	for(unsigned s : c.shaders) {
+		glDeleteShader(s);
+	}
+	c.shaders.clear();
+	if(c.program) {
+		glDeleteProgram(c.program);
+		c.program = 0;
+	}
+}
+
+void ShaderWatcher::AddDirectories(const std::vector<std::string>& files) {
+	for(const std::string& file : files) {
+		std::string dir = std::filesystem::path(file).parent_path()
+			.generic_string();
+		if(dir == "") {
+			dir = ".";
+		}
+		if(directories.count(dir)) {
+			continue;
+		}
+		int wd = -1;
+#ifdef __linux__
+		if(inotifyFd >= 0) {
+			wd = inotify_add_watch(inotifyFd, dir.c_str(),
+					IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+			if(wd >= 0) {
+				watchDescriptors[wd] = dir;
+			}
+		}
+#endif
+		directories[dir] = wd;
+	}
+}
+
+void ShaderWatcher::ProcessChanges(const std::set<std::string>& files) {
+	std::set<std::string> affected;
+	for(const std::string& file : files) {
+		ShaderPreprocessor::Invalidate(file);
+		for(std::string& f : ShaderPreprocessor::GetDependents(file)) {
+			affected.insert(std::move(f));
+		}
+	}
+
+	std::vector<std::pair<Shader*, std::vector<std::string>>> toReload;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for(auto& it : shaders) {
+			for(const std::string& f : it.second.files) {
+				if(affected.count(f)) {
+					toReload.emplace_back(it.first, it.second.stagePaths);
+					break;
+				}
+			}
+		}
+	}
+
+	for(auto& it : toReload) {
+		Compilation c{it.first, {}, 0, {}};
+		for(const std::string& path : it.second) {
+			c.stages.emplace_back(ShaderPreprocessor::Process(path));
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		if(shaders.count(c.shader) == 0) {
+			continue;
+		}
+		for(size_t i=0; i<ready.size(); ++i) {
+			if(ready[i].shader == c.shader) {
+				ready.erase(ready.begin()+i);
+				break;
+			}
+		}
+		ready.emplace_back(std::move(c));
+	}
+}
+
+void ShaderWatcher::Run() {
+	std::map<std::string, std::filesystem::file_time_type> mtimes;
+	while(running) {
+		std::set<std::string> changed;
+#ifdef __linux__
+		if(inotifyFd >= 0) {
+			pollfd pfd{inotifyFd, POLLIN, 0};
+			if(poll(&pfd, 1, 100) <= 0) {
+				continue;
+			}
+			// let editors finish writing before reading events
+			std::this_thread::sleep_for(std::chrono::milliseconds(30));
+			alignas(inotify_event) char buffer[16384];
+			for(;;) {
+				ssize_t len = read(inotifyFd, buffer, sizeof(buffer));
+				if(len <= 0) {
+					break;
+				}
+				std::lock_guard<std::mutex> lock(mutex);
+				for(char* p = buffer; p < buffer+len;) {
+					inotify_event* event = (inotify_event*)p;
+					auto it = watchDescriptors.find(event->wd);
+					if(event->len && it != watchDescriptors.end()) {
+						changed.insert(ShaderPreprocessor::NormalizePath(
+									it->second + "/" + event->name));
+					}
+					p += sizeof(inotify_event) + event->len;
+				}
+			}
+			ProcessChanges(changed);
+			continue;
+		}
+#endif
+		std::this_thread::sleep_for(std::chrono::milliseconds(250));
+		std::set<std::string> files;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for(auto& it : shaders) {
+				files.insert(it.second.files.begin(), it.second.files.end());
+			}
+		}
+		for(const std::string& file : files) {
+			std::error_code ec;
+			auto mtime = std::filesystem::last_write_time(file, ec);
+			if(ec) {
+				continue;
+			}
+			auto it = mtimes.find(file);
+			if(it == mtimes.end()) {
+				mtimes[file] = mtime;
+			} else if(it->second != mtime) {
+				it->second = mtime;
+				changed.insert(file);
+			}
+		}
+		if(changed.size()) {
+			ProcessChanges(changed);
+		}
+	}
+}
+
+} // namespace gl
@@ -23,21 +23,25 @@
 #include "../include/openglwrapper/Sync.hpp"
 
 namespace gl {
-	Sync::Sync() : sync(nullptr) {
+	Sync::Sync() : sync(nullptr), signaled(false) {
 	}
 	
-	Sync::Sync(void* glsync) : sync(glsync) {
+	Sync::Sync(void* glsync) : sync(glsync), signaled(false) {
 	}
 	
 	Sync::Sync(Sync&& s) {
 		this->sync = s.sync;
+		this->signaled = s.signaled;
 		s.sync = nullptr;
+		s.signaled = false;
 	}
 	
 	Sync& Sync::operator=(Sync&& s) {
 		Destroy();
 		this->sync = s.sync;
+		this->signaled = s.signaled;
 		s.sync = nullptr;
+		s.signaled = false;
 		return *this;
 	}
 	
@@ -46,6 +50,7 @@ namespace gl {
 	}
 	
 	void Sync::StartFence() {
+		Destroy();
 		sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 		GL_CHECK_PUSH_PRINT_ERROR;
 	}
@@ -56,35 +61,39 @@ namespace gl {
 			GL_CHECK_PUSH_PRINT_ERROR;
 			sync = nullptr;
 		}
+		signaled = false;
 	}
 	
 	bool Sync::IsDone() {
-		if(sync) {
+		if(sync && !signaled) {
 			GLint result = -1;
 			GLsizei length = -1;
 			glGetSynciv(static_cast<GLsync>(sync), GL_SYNC_STATUS,
-					sizeof(uint32_t), &length, &result);
+					1, &length, &result);
 			GL_CHECK_PUSH_PRINT_ERROR;
-			if(result != GL_SIGNALED) {
-				return false;
-			}
-			Destroy();
+			signaled = result == GL_SIGNALED;
+			return signaled;
 		}
 		return true;	
 	}
 		
 	SyncWaitResult Sync::WaitClient(uint64_t timeoutNanoseconds) {
+		if(sync && signaled) {
+			return SYNC_DONE;
+		}
 		if(sync) {
 			GLenum ret = glClientWaitSync(static_cast<GLsync>(sync),
 					GL_SYNC_FLUSH_COMMANDS_BIT, timeoutNanoseconds);
 			GL_CHECK_PUSH_ERROR;
 			switch(ret) {
 			case GL_ALREADY_SIGNALED:
+			case GL_CONDITION_SATISFIED:
+				signaled = true;
 				return SYNC_DONE;
 			case GL_TIMEOUT_EXPIRED:
 				return SYNC_TIMEOUT;
-			case GL_CONDITION_SATISFIED:
-				return SYNC_DONE;
+			case GL_WAIT_FAILED:
+				return SYNC_FAILED;
 			}
 		}
 		return SYNC_NOT_EXISTS;
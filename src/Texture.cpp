@@ -19,110 +19,196 @@
 #include <cstdio>
 #include <string>
 #include <mutex>
+#include <atomic>
 #include <set>
-#include <map>
+#include <algorithm>
 
 #include "../thirdparty/SOIL2/src/SOIL2/SOIL2.h"
 
+#include "../include/openglwrapper/TextureContainer.hpp"
+
 #include "../include/openglwrapper/Texture.hpp"
 
 namespace gl {
 	
-static uint32_t GetBytesPerFormat(TextureSizedInternalFormat format) {
-	static std::map<TextureSizedInternalFormat, int> m{
-		{R8, 1},
-		{R8_SNORM, 1},
-		{R16, 2},
-		{R16_SNORM, 2},
-		{RG8, 2},
-		{RG8_SNORM, 2},
-		{RG16, 4},
-		{RG16_SNORM, 4},
-		{R3_G3_B2, 1},
-		{RGB4, 2},
-		{RGB5, 2},
-		{RGB8, 3},
-		{RGB8_SNORM, 3},
-		{RGB10, 4},
-		{RGB12, 5},
-		{RGB16_SNORM,6 },
-		{RGBA2, 1},
-		{RGBA4, 2},
-		{RGB5_A1, 2},
-		{RGBA8, 4},
-		{RGBA8_SNORM, 4},
-		{RGB10_A2, 4},
-		{RGB10_A2UI, 4},
-		{RGBA12, 6},
-		{RGBA16, 8},
-		{SRGB8, 4},
-		{SRGB8_ALPHA8, 4},
-		{R16F, 2},
-		{RG16F, 4},
-		{RGB16F, 6},
-		{RGBA16F, 8},
-		{R32F, 4},
-		{RG32F, 8},
-		{RGB32F, 12},
-		{RGBA32F, 16},
-		{R11F_G11F_B10F, 4},
-		{RGB9_E5, 4},
-		{R8I, 1},
-		{R8UI, 1},
-		{R16I, 2},
-		{R16UI, 2},
-		{R32I, 4},
-		{R32UI, 4},
-		{RG8I, 2},
-		{RG8UI, 2},
-		{RG16I, 4},
-		{RG16UI, 4},
-		{RG32I, 8},
-		{RG32UI, 8},
-		{RGB8I, 3},
-		{RGB8UI, 3},
-		{RGB16I, 6},
-		{RGB16UI, 6},
-		{RGB32I, 12},
-		{RGB32UI, 12},
-		{RGBA8I, 4},
-		{RGBA8UI, 4},
-		{RGBA16I, 8},
-		{RGBA16UI, 8},
-		{RGBA32I, 16},
-		{RGBA32UI, 16},
-		{(TextureSizedInternalFormat)RGBA, 4},
-		{(TextureSizedInternalFormat)GL_DEPTH_COMPONENT32F, 4},
-		{(TextureSizedInternalFormat)GL_DEPTH_COMPONENT32, 4},
-		{(TextureSizedInternalFormat)GL_DEPTH_COMPONENT16, 2},
-		
-		{DEPTH24_STENCIL8, 4},
-	};
-	
-	if(m.find(format) == m.end()) {
-		throw "Trying to find size in bytes of unknown gl::TextureSizedInternalFormat.";
-	}
-	return m[format];
+uint64_t Texture::GetImageBytes(TextureSizedInternalFormat format,
+		uint32_t w, uint32_t h, uint32_t d) {
+	const TextureFormatInfo info = GetTextureFormatInfo(format);
+	return (uint64_t)((w+info.blockWidth-1)/info.blockWidth)
+		* ((h+info.blockHeight-1)/info.blockHeight) * d * info.bytes;
 }
-	
+
+bool Texture::IsCompressedFormat(TextureSizedInternalFormat format) {
+	return GetTextureFormatInfo(format).blockWidth > 1;
+}
+
+uint64_t Texture::GetStorageBytes(gl::TextureTarget target,
+		gl::TextureSizedInternalFormat format, uint32_t w, uint32_t h,
+		uint32_t d, uint32_t levels, uint32_t samples) {
+	uint64_t bytes = 0;
+	for(uint32_t i=0; i<std::max(levels, 1u); ++i) {
+		const uint32_t lw = std::max(w>>i, 1u);
+		uint32_t lh = std::max(h>>i, 1u);
+		uint32_t ld = 1;
+		switch(target) {
+			case TEXTURE_1D:
+				lh = 1;
+				break;
+			case TEXTURE_1D_ARRAY:
+				lh = h;
+				break;
+			case TEXTURE_2D_ARRAY:
+			case TEXTURE_CUBE_MAP_ARRAY:
+			case TEXTURE_2D_MULTISAMPLE_ARRAY:
+				// layers, or layer-faces of cube map arrays
+				ld = d;
+				break;
+			case TEXTURE_CUBE_MAP:
+				ld = 6;
+				break;
+			case TEXTURE_3D:
+				ld = std::max(d>>i, 1u);
+				break;
+			default:
+				break;
+		}
+		bytes += GetImageBytes(format, lw, lh, ld);
+	}
+	return bytes * std::max(samples, 1u);
+}
+
 static std::set<Texture*> allTextures;
 static std::mutex mutex;
 
+struct MemoryTag {
+	std::string name;
+	uint64_t bytes;
+};
+// tag 0 groups untagged textures
+static std::vector<MemoryTag> memoryTags{{"", 0}};
+static uint64_t totalVramUsage = 0;
+static std::atomic<uint64_t> generationCounter{0};
+
+static TextureSizedInternalFormat ToSizedFormat(
+		TextureSizedInternalFormat format) {
+	switch((GLenum)format) {
+		case GL_RED: return R8;
+		case GL_RG: return RG8;
+		case GL_RGB: return RGB8;
+		case GL_RGBA: return RGBA8;
+		default: return format;
+	}
+}
+
 void Texture::UpdateVramUsage() {
-	vramUsage = width*height*depth * GetBytesPerFormat(internalFormat);
-	if(hasMipmaps)
-		vramUsage = (11 * vramUsage) / 8;
+	// sparse textures count pages in CommitPages
+	if(sparse) {
+		return;
+	}
+	const uint64_t bytes = GetStorageBytes(target, internalFormat, width,
+			height, depth, levels, samples);
+	SetVramUsage(bytes);
+	const uint64_t queried = QueryCompressedImageBytes();
+	if(queried && queried != bytes) {
+		printf("\n WARNING::TEXTURE::VRAM_USAGE_MISMATCH: computed %llu, "
+				"driver reports %llu bytes\n", (unsigned long long)bytes,
+				(unsigned long long)queried);
+	}
+}
+
+void Texture::SetVramUsage(uint64_t bytes) {
+	std::lock_guard<std::mutex> lock(mutex);
+	totalVramUsage += bytes - vramUsage;
+	memoryTags[memoryTag].bytes += bytes - vramUsage;
+	vramUsage = bytes;
+}
+
+uint64_t Texture::QueryCompressedImageBytes() const {
+	if(textureID == 0 || !IsCompressedFormat(internalFormat)
+			|| target == TEXTURE_CUBE_MAP) {
+		return 0;
+	}
+	uint64_t bytes = 0;
+	for(uint32_t i=0; i<std::max(levels, 1u); ++i) {
+		GLint size = 0;
+		glGetTextureLevelParameteriv(textureID, i,
+				GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+		bytes += size;
+	}
+	GL_CHECK_PUSH_ERROR;
+	return bytes;
+}
+
+void Texture::SetMemoryTag(const std::string& tag) {
+	std::lock_guard<std::mutex> lock(mutex);
+	uint32_t index = 0;
+	if(tag.size()) {
+		while(index < memoryTags.size() && memoryTags[index].name != tag) {
+			++index;
+		}
+		if(index == memoryTags.size()) {
+			memoryTags.push_back({tag, 0});
+		}
+	}
+	memoryTags[memoryTag].bytes -= vramUsage;
+	memoryTags[index].bytes += vramUsage;
+	memoryTag = index;
+}
+
+std::string Texture::GetMemoryTag() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return memoryTags[memoryTag].name;
+}
+
+uint64_t Texture::CountTagMemoryUsage(const std::string& tag) {
+	std::lock_guard<std::mutex> lock(mutex);
+	for(const MemoryTag& t : memoryTags) {
+		if(t.name == tag) {
+			return t.bytes;
+		}
+	}
+	return 0;
+}
+
+std::vector<std::pair<std::string, uint64_t>> Texture::CountMemoryUsageByTag() {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<std::pair<std::string, uint64_t>> usage;
+	for(const MemoryTag& t : memoryTags) {
+		usage.emplace_back(t.name, t.bytes);
+	}
+	return usage;
+}
+
+uint32_t Texture::GetFullMipLevelsCount(uint32_t w, uint32_t h, uint32_t d) {
+	uint32_t m = std::max(std::max(w, h), d);
+	uint32_t levels = 1;
+	while(m > 1) {
+		m >>= 1;
+		++levels;
+	}
+	return levels;
 }
 
 Texture::Texture() {
 	textureID = 0;
+	generation = 0;
+	bindlessHandle = 0;
+	minFilter = gl::NEAREST_MIPMAP_LINEAR;
 	width = 0;
 	height = 0;
 	depth = 0;
 	vramUsage = 0;
+	memoryTag = 0;
 	std::lock_guard<std::mutex> lock(mutex);
 	allTextures.insert(this);
 	hasMipmaps = false;
+	immutable = false;
+	sparse = false;
+	samples = 1;
+	levels = 0;
+	pageSizeX = pageSizeY = pageSizeZ = 1;
+	sparseLevels = 0;
+	mipTailCommitted = false;
 }
 
 Texture::~Texture() {
@@ -140,13 +226,23 @@ bool Texture::Load(const char* fileName,
 bool Texture::Load(const char* fileName, bool generateMipMap,
 		gl::TextureSizedInternalFormat forceSizedInternalFormat,
 		int forceChannelsCount) {
+	// GPU ready containers are uploaded without decoding
+	if(TextureContainer::IsContainerFile(fileName)) {
+		TextureContainer container;
+		if(container.Load(fileName) && container.Upload(*this,
+					generateMipMap)) {
+			return true;
+		}
+		Destroy();
+		return false;
+	}
+	
 	int channels = 0;
 	int32_t w, h;
 	uint8_t * image = LoadImageData(fileName, &w, &h, &channels,
 			forceChannelsCount);
-	if(image==nullptr && textureID) {
-		glDeleteTextures(1, &textureID);
-		textureID = width = height = depth = 0;
+	if(image == nullptr) {
+		Destroy();
 		return false;
 	}
 	
@@ -157,35 +253,293 @@ bool Texture::Load(const char* fileName, bool generateMipMap,
 		case 3: format = RGB; break;
 		case 4: format = RGBA; break;
 		default:
-			glDeleteTextures(1, &textureID);
-			textureID = width = height = 0;
+			FreeImageData(image);
+			Destroy();
 			return false;
 	}
 	
-	Generate2(TEXTURE_2D, w, h, forceSizedInternalFormat);
+	Storage2(TEXTURE_2D, w, h, generateMipMap ? 0 : 1,
+			forceSizedInternalFormat);
+	GLint alignment = 4;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 	Update2(image, 0, 0, w, h, 0, format, gl::UNSIGNED_BYTE);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
 	if(generateMipMap)
 		GenerateMipmaps();
 	
 	FreeImageData(image);
-	depth = 1;
 	return true;
 }
 
 
 
+void Texture::CreateForStorage(gl::TextureTarget target) {
+	GL_CHECK_PUSH_PRINT_ERROR;
+	// storage of immutable texture can not be respecified
+	if(textureID) {
+		glDeleteTextures(1, &textureID);
+		bindlessHandle = 0;
+		textureID = 0;
+	}
+	this->target = target;
+	this->sparse = false;
+	this->samples = 1;
+	sparseLevels = 0;
+	committedPages.clear();
+	mipTailCommitted = false;
+	glCreateTextures(target, 1, &textureID);
+	generation = ++generationCounter;
+	GL_CHECK_PUSH_PRINT_ERROR;
+}
+
+void Texture::Storage1(gl::TextureTarget target,
+		uint32_t w, uint32_t levels,
+		gl::TextureSizedInternalFormat internalformat) {
+	CreateForStorage(target);
+	internalformat = ToSizedFormat(internalformat);
+	if(levels == 0)
+		levels = GetFullMipLevelsCount(w);
+	
+	this->width = w;
+	this->height = 1;
+	this->depth = 1;
+	this->internalFormat = internalformat;
+	this->immutable = true;
+	this->levels = levels;
+	this->hasMipmaps = levels > 1;
+	
+	glTextureStorage1D(textureID, levels, internalformat, w);
+	GL_CHECK_PUSH_PRINT_ERROR;
+	
+	MinFilter(gl::NEAREST);
+	MagFilter(gl::MAG_NEAREST);
+	UpdateVramUsage();
+}
+
+void Texture::Storage2(gl::TextureTarget target,
+		uint32_t w, uint32_t h, uint32_t levels,
+		gl::TextureSizedInternalFormat internalformat) {
+	CreateForStorage(target);
+	internalformat = ToSizedFormat(internalformat);
+	if(levels == 0)
+		levels = target == TEXTURE_1D_ARRAY ? GetFullMipLevelsCount(w)
+			: GetFullMipLevelsCount(w, h);
+	
+	this->width = w;
+	this->height = h;
+	this->depth = 1;
+	this->internalFormat = internalformat;
+	this->immutable = true;
+	this->levels = levels;
+	this->hasMipmaps = levels > 1;
+	
+	glTextureStorage2D(textureID, levels, internalformat, w, h);
+	GL_CHECK_PUSH_PRINT_ERROR;
+	
+	MinFilter(gl::NEAREST);
+	MagFilter(gl::MAG_NEAREST);
+	UpdateVramUsage();
+}
+
+void Texture::Storage3(gl::TextureTarget target,
+		uint32_t w, uint32_t h, uint32_t d, uint32_t levels,
+		gl::TextureSizedInternalFormat internalformat) {
+	CreateForStorage(target);
+	internalformat = ToSizedFormat(internalformat);
+	if(levels == 0)
+		levels = target == TEXTURE_3D ? GetFullMipLevelsCount(w, h, d)
+			: GetFullMipLevelsCount(w, h);
+	
+	this->width = w;
+	this->height = h;
+	this->depth = d;
+	this->internalFormat = internalformat;
+	this->immutable = true;
+	this->levels = levels;
+	this->hasMipmaps = levels > 1;
+	
+	glTextureStorage3D(textureID, levels, internalformat, w, h, d);
+	GL_CHECK_PUSH_PRINT_ERROR;
+	
+	MinFilter(gl::NEAREST);
+	MagFilter(gl::MAG_NEAREST);
+	UpdateVramUsage();
+}
+
+void Texture::Storage2Multisample(gl::TextureTarget target,
+		uint32_t w, uint32_t h, uint32_t d, uint32_t samples,
+		gl::TextureSizedInternalFormat internalformat,
+		bool fixedSampleLocations) {
+	CreateForStorage(target);
+	internalformat = ToSizedFormat(internalformat);
+	
+	this->width = w;
+	this->height = h;
+	this->depth = target == TEXTURE_2D_MULTISAMPLE_ARRAY ? d : 1;
+	this->internalFormat = internalformat;
+	this->immutable = true;
+	this->levels = 1;
+	this->hasMipmaps = false;
+	this->samples = samples;
+	
+	// multisample textures have no sampler state
+	if(target == TEXTURE_2D_MULTISAMPLE_ARRAY) {
+		glTextureStorage3DMultisample(textureID, samples, internalformat, w, h,
+				d, fixedSampleLocations);
+	} else {
+		glTextureStorage2DMultisample(textureID, samples, internalformat, w, h,
+				fixedSampleLocations);
+	}
+	GL_CHECK_PUSH_PRINT_ERROR;
+	// driver may round sample count up
+	GLint actualSamples = 0;
+	glGetTextureLevelParameteriv(textureID, 0, GL_TEXTURE_SAMPLES,
+			&actualSamples);
+	GL_CHECK_PUSH_ERROR;
+	if(actualSamples > (GLint)samples) {
+		this->samples = actualSamples;
+	}
+	UpdateVramUsage();
+}
+
+bool Texture::SparseStorage2(gl::TextureTarget target,
+		uint32_t w, uint32_t h, uint32_t levels,
+		gl::TextureSizedInternalFormat internalformat, int pageSizeIndex) {
+	if(!GLEW_ARB_sparse_texture) {
+		return false;
+	}
+	internalformat = ToSizedFormat(internalformat);
+	GLint count = 0;
+	glGetInternalformativ(target, internalformat,
+			GL_NUM_VIRTUAL_PAGE_SIZES_ARB, 1, &count);
+	GL_CHECK_PUSH_PRINT_ERROR;
+	if(pageSizeIndex < 0 || pageSizeIndex >= count) {
+		return false;
+	}
+	std::vector<GLint> sizesX(count), sizesY(count), sizesZ(count);
+	glGetInternalformativ(target, internalformat,
+			GL_VIRTUAL_PAGE_SIZE_X_ARB, count, sizesX.data());
+	glGetInternalformativ(target, internalformat,
+			GL_VIRTUAL_PAGE_SIZE_Y_ARB, count, sizesY.data());
+	glGetInternalformativ(target, internalformat,
+			GL_VIRTUAL_PAGE_SIZE_Z_ARB, count, sizesZ.data());
+	GL_CHECK_PUSH_PRINT_ERROR;
+	
+	CreateForStorage(target);
+	if(levels == 0)
+		levels = GetFullMipLevelsCount(w, h);
+	
+	glTextureParameteri(textureID, GL_TEXTURE_SPARSE_ARB, GL_TRUE);
+	glTextureParameteri(textureID, GL_VIRTUAL_PAGE_SIZE_INDEX_ARB,
+			pageSizeIndex);
+	GL_CHECK_PUSH_PRINT_ERROR;
+	
+	this->width = w;
+	this->height = h;
+	this->depth = 1;
+	this->internalFormat = internalformat;
+	this->immutable = true;
+	this->sparse = true;
+	this->levels = levels;
+	this->hasMipmaps = levels > 1;
+	
+	glTextureStorage2D(textureID, levels, internalformat, w, h);
+	GL_CHECK_PUSH_PRINT_ERROR;
+	
+	pageSizeX = std::max(sizesX[pageSizeIndex], 1);
+	pageSizeY = std::max(sizesY[pageSizeIndex], 1);
+	pageSizeZ = std::max(sizesZ[pageSizeIndex], 1);
+	GLint numSparseLevels = 0;
+	glGetTextureParameteriv(textureID, GL_NUM_SPARSE_LEVELS_ARB,
+			&numSparseLevels);
+	GL_CHECK_PUSH_PRINT_ERROR;
+	sparseLevels = std::min<uint32_t>(std::max(numSparseLevels, 0), levels);
+	committedPages.resize(sparseLevels);
+	for(uint32_t l=0; l<sparseLevels; ++l) {
+		committedPages[l].resize(GetSparsePagesCount(l, 0)
+				* GetSparsePagesCount(l, 1) * GetSparsePagesCount(l, 2));
+	}
+	
+	MinFilter(gl::NEAREST);
+	MagFilter(gl::MAG_NEAREST);
+	// only committed pages are counted
+	SetVramUsage(0);
+	return true;
+}
+
+uint32_t Texture::GetSparsePagesCount(uint32_t level, int axis) const {
+	switch(axis) {
+		case 0:
+			return (std::max(width>>level, 1) + pageSizeX - 1) / pageSizeX;
+		case 1:
+			return (std::max(height>>level, 1) + pageSizeY - 1) / pageSizeY;
+		default:
+			return (GetSparseLayers() + pageSizeZ - 1) / pageSizeZ;
+	}
+}
+
+void Texture::CommitPages(uint32_t level, uint32_t x, uint32_t y, uint32_t z,
+		uint32_t w, uint32_t h, uint32_t d, bool commit) {
+	if(!sparse) {
+		return;
+	}
+	glBindTexture(target, textureID);
+	glTexPageCommitmentARB(target, level, x, y, z, w, h, d,
+			commit ? GL_TRUE : GL_FALSE);
+	GL_CHECK_PUSH_PRINT_ERROR;
+	// memory is committed in whole pages, count only pages that changed
+	const uint64_t pageBytes = GetImageBytes(internalFormat, pageSizeX,
+			pageSizeY, pageSizeZ);
+	uint64_t bytes = 0;
+	if(level >= sparseLevels) {
+		if(mipTailCommitted != commit && level < levels) {
+			mipTailCommitted = commit;
+			for(uint32_t l=sparseLevels; l<levels; ++l) {
+				bytes += GetImageBytes(internalFormat, std::max(width>>l, 1),
+						std::max(height>>l, 1), GetSparseLayers());
+			}
+			bytes = (bytes + pageBytes - 1) / pageBytes * pageBytes;
+		}
+	} else {
+		const uint32_t pagesX = GetSparsePagesCount(level, 0);
+		const uint32_t pagesY = GetSparsePagesCount(level, 1);
+		const uint32_t pagesZ = GetSparsePagesCount(level, 2);
+		std::vector<bool>& pages = committedPages[level];
+		for(uint32_t pz=z/pageSizeZ; pz<pagesZ && pz*pageSizeZ<z+d; ++pz) {
+			for(uint32_t py=y/pageSizeY; py<pagesY && py*pageSizeY<y+h;
+					++py) {
+				for(uint32_t px=x/pageSizeX; px<pagesX && px*pageSizeX<x+w;
+						++px) {
+					const size_t page = (pz*pagesY + py)*pagesX + px;
+					if(pages[page] != commit) {
+						pages[page] = commit;
+						bytes += pageBytes;
+					}
+				}
+			}
+		}
+	}
+	SetVramUsage(commit ? vramUsage + bytes
+			: vramUsage - std::min(vramUsage, bytes));
+}
+
 void Texture::Generate1(gl::TextureTarget target,
 		uint32_t w,
 		gl::TextureSizedInternalFormat internalformat,
 		gl::TextureDataFormat dataformat, gl::DataType datatype) {
-	if(textureID && target != this->target) {
+	if(textureID && (target != this->target || immutable)) {
 		glDeleteTextures(1, &textureID);
+		bindlessHandle = 0;
 		textureID = 0;
 	}
 	GL_CHECK_PUSH_PRINT_ERROR;
 	
-	if(!textureID)
+	const bool created = !textureID;
+	if(created) {
 		glCreateTextures(target, 1, &textureID);
+		generation = ++generationCounter;
+	}
 	GL_CHECK_PUSH_PRINT_ERROR;
 	this->target = target;
 	glBindTexture(target, textureID);
@@ -195,12 +549,18 @@ void Texture::Generate1(gl::TextureTarget target,
 	this->height = 1;
 	this->depth = 1;
 	this->internalFormat = internalformat;
+	this->immutable = false;
+	this->sparse = false;
+	this->samples = 1;
+	this->levels = 1;
 	
 	glTexImage1D(target, 0, internalformat, w, 0,
 			dataformat, datatype, nullptr);
 	GL_CHECK_PUSH_PRINT_ERROR;
 	
-	MinFilter(gl::NEAREST);
+	// reallocation keeps sampling parameters set by user
+	if(created)
+		MinFilter(gl::NEAREST);
 	GL_CHECK_PUSH_PRINT_ERROR;
 	UpdateVramUsage();
 }
@@ -232,15 +592,19 @@ void Texture::Generate2(gl::TextureTarget target,
 		gl::TextureSizedInternalFormat internalformat,
 		gl::TextureDataFormat dataformat, gl::DataType datatype) {
 	GL_CHECK_PUSH_PRINT_ERROR;
-	if(textureID && target != this->target) {
+	if(textureID && (target != this->target || immutable)) {
 		glDeleteTextures(1, &textureID);
+		bindlessHandle = 0;
 		textureID = 0;
 	}
 	GL_CHECK_PUSH_PRINT_ERROR;
 	
 	this->target = target;
-	if(!textureID)
+	const bool created = !textureID;
+	if(created) {
 		glCreateTextures(target, 1, &textureID);
+		generation = ++generationCounter;
+	}
 	GL_CHECK_PUSH_PRINT_ERROR;
 	glBindTexture(target, textureID);
 	GL_CHECK_PUSH_PRINT_ERROR;
@@ -249,13 +613,20 @@ void Texture::Generate2(gl::TextureTarget target,
 	this->height = h;
 	this->depth = 1;
 	this->internalFormat = internalformat;
+	this->immutable = false;
+	this->sparse = false;
+	this->samples = 1;
+	this->levels = 1;
 	
 	glTexImage2D(target, 0, internalformat, w, h, 0,
 			dataformat, datatype, nullptr);
 	GL_CHECK_PUSH_PRINT_ERROR;
 	
-	MinFilter(gl::NEAREST);
-	MagFilter(gl::MAG_NEAREST);
+	// reallocation keeps sampling parameters set by user
+	if(created) {
+		MinFilter(gl::NEAREST);
+		MagFilter(gl::MAG_NEAREST);
+	}
 	GL_CHECK_PUSH_PRINT_ERROR;
 	UpdateVramUsage();
 }
@@ -270,6 +641,15 @@ void Texture::Update2(const void* pixels,
 	GL_CHECK_PUSH_PRINT_ERROR;
 }
 
+void Texture::UpdateCompressed2(const void* data,
+		uint32_t x, uint32_t y,
+		uint32_t w, uint32_t h,
+		uint32_t level, uint32_t bytes) {
+	glCompressedTextureSubImage2D(textureID, level, x, y, w, h,
+			internalFormat, bytes, data);
+	GL_CHECK_PUSH_PRINT_ERROR;
+}
+
 void Texture::Fetch2(void* pixels,
 		uint32_t x, uint32_t y,
 		uint32_t w, uint32_t h,
@@ -286,14 +666,18 @@ void Texture::Generate3(gl::TextureTarget target,
 		uint32_t w, uint32_t h, uint32_t d,
 		gl::TextureSizedInternalFormat internalformat,
 		gl::TextureDataFormat dataformat, gl::DataType datatype) {
-	if(textureID && target != this->target) {
+	if(textureID && (target != this->target || immutable)) {
 		glDeleteTextures(1, &textureID);
+		bindlessHandle = 0;
 		textureID = 0;
 	}
 	GL_CHECK_PUSH_PRINT_ERROR;
 	
-	if(!textureID)
+	const bool created = !textureID;
+	if(created) {
 		glCreateTextures(target, 1, &textureID);
+		generation = ++generationCounter;
+	}
 	GL_CHECK_PUSH_PRINT_ERROR;
 	this->target = target;
 	glBindTexture(target, textureID);
@@ -303,13 +687,20 @@ void Texture::Generate3(gl::TextureTarget target,
 	this->height = h;
 	this->depth = d;
 	this->internalFormat = internalformat;
+	this->immutable = false;
+	this->sparse = false;
+	this->samples = 1;
+	this->levels = 1;
 	
 	glTexImage3D(target, 0, internalformat, w, h, d, 0,
 			dataformat, datatype, nullptr);
 	GL_CHECK_PUSH_PRINT_ERROR;
 	
-	MinFilter(gl::NEAREST);
-	MagFilter(gl::MAG_NEAREST);
+	// reallocation keeps sampling parameters set by user
+	if(created) {
+		MinFilter(gl::NEAREST);
+		MagFilter(gl::MAG_NEAREST);
+	}
 	GL_CHECK_PUSH_PRINT_ERROR;
 	UpdateVramUsage();
 }
@@ -324,6 +715,15 @@ void Texture::Update3(const void* pixels,
 	GL_CHECK_PUSH_PRINT_ERROR;
 }
 
+void Texture::UpdateCompressed3(const void* data,
+		uint32_t x, uint32_t y, uint32_t z,
+		uint32_t w, uint32_t h, uint32_t d,
+		uint32_t level, uint32_t bytes) {
+	glCompressedTextureSubImage3D(textureID, level, x, y, z, w, h, d,
+			internalFormat, bytes, data);
+	GL_CHECK_PUSH_PRINT_ERROR;
+}
+
 void Texture::Fetch3(void* pixels,
 		uint32_t x, uint32_t y, uint32_t z,
 		uint32_t w, uint32_t h, uint32_t d,
@@ -350,9 +750,11 @@ void Texture::UpdateTextureData(const void* pixels, uint32_t w, uint32_t h,
 	
 	if(generateMipMap) {
 		GenerateMipmaps();
-	} else {
-		MinFilter(gl::NEAREST);
-		MagFilter(gl::MAG_NEAREST);
+	} else if(minFilter != gl::NEAREST && minFilter != gl::LINEAR) {
+		// texture without mip levels would be incomplete
+		MinFilter(minFilter == gl::LINEAR_MIPMAP_LINEAR
+				|| minFilter == gl::LINEAR_MIPMAP_NEAREST ? gl::LINEAR
+				: gl::NEAREST);
 	}
 }
 
@@ -366,27 +768,34 @@ void Texture::InitTextureEmpty(uint32_t w, uint32_t h,
 void Texture::GenerateMipmaps() {
 	glGenerateTextureMipmap(textureID);
 	hasMipmaps = true;
+	if(!immutable) {
+		// layers of arrays are not reduced
+		levels = GetFullMipLevelsCount(width,
+				target == TEXTURE_1D_ARRAY ? 1 : height,
+				target == TEXTURE_3D ? depth : 1);
+	}
 	UpdateVramUsage();
 }
 
 void Texture::MinFilter(TextureMinFilter filter) {
-	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, filter);
+	minFilter = filter;
+	glTextureParameteri(textureID, GL_TEXTURE_MIN_FILTER, filter);
 }
 
 void Texture::MagFilter(TextureMagFilter filter) {
-	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, filter);
+	glTextureParameteri(textureID, GL_TEXTURE_MAG_FILTER, filter);
 }
 
 void Texture::WrapX(TextureWrapParam param) {
-	glTexParameteri(target, GL_TEXTURE_WRAP_S, param);
+	glTextureParameteri(textureID, GL_TEXTURE_WRAP_S, param);
 }
 
 void Texture::WrapY(TextureWrapParam param) {
-	glTexParameteri(target, GL_TEXTURE_WRAP_T, param);
+	glTextureParameteri(textureID, GL_TEXTURE_WRAP_T, param);
 }
 
 void Texture::WrapZ(TextureWrapParam param) {
-	glTexParameteri(target, GL_TEXTURE_WRAP_R, param);
+	glTextureParameteri(textureID, GL_TEXTURE_WRAP_R, param);
 }
 
 void Texture::SetDefaultParamPixelartClampBorderNoMipmap() {
@@ -416,15 +825,36 @@ void Texture::BindImage(uint32_t unit, int32_t level, bool array,
 	GL_CHECK_PUSH_ERROR;
 }
 
+uint64_t Texture::GetHandle() {
+	if(bindlessHandle == 0 && textureID) {
+		bindlessHandle = glGetTextureHandleARB(textureID);
+		GL_CHECK_PUSH_PRINT_ERROR;
+	}
+	return bindlessHandle;
+}
+
+bool Texture::IsBindlessSupported() {
+	return GLEW_ARB_bindless_texture;
+}
+
 void Texture::Destroy() {
 	if(textureID) {
 		glDeleteTextures(1, &textureID);
+		bindlessHandle = 0;
 		width = 0;
 		height = 0;
+		depth = 0;
 		textureID = 0;
 	}
-	vramUsage = 0;
+	SetVramUsage(0);
 	hasMipmaps = false;
+	immutable = false;
+	sparse = false;
+	sparseLevels = 0;
+	committedPages.clear();
+	mipTailCommitted = false;
+	samples = 1;
+	levels = 0;
 }
 
 uint8_t* Texture::LoadImageData(const char* fileName, int* width, int* height,
@@ -439,13 +869,7 @@ void Texture::FreeImageData(uint8_t* imageData) {
 
 uint64_t Texture::CountAllTextureMemoryUsage() {
 	std::lock_guard<std::mutex> lock(mutex);
-	uint64_t bytes = 0;
-	for(auto v : allTextures) {
-		if(v->GetTexture()) {
-			bytes += v->vramUsage;
-		}
-	}
-	return bytes;
+	return totalVramUsage;
 }
 
 }
@@ -0,0 +1,153 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <algorithm>
+
+#include "../include/openglwrapper/OpenGL.hpp"
+
+#include "../include/openglwrapper/TextureArrayPool.hpp"
+
+namespace gl {
+
+void TextureRegion::Update(const void* pixels,
+		gl::TextureDataFormat dataformat, gl::DataType datatype,
+		uint32_t level) const {
+	array->Update3(pixels, x>>level, y>>level, layer,
+			std::max<uint32_t>(width>>level, 1),
+			std::max<uint32_t>(height>>level, 1), 1, level, dataformat,
+			datatype);
+}
+
+void TextureRegion::UpdateCompressed(const void* data, uint32_t bytes,
+		uint32_t level) const {
+	array->UpdateCompressed3(data, x>>level, y>>level, layer,
+			std::max<uint32_t>(width>>level, 1),
+			std::max<uint32_t>(height>>level, 1), 1, level, bytes);
+}
+
+TextureArrayPool::TextureArrayPool(uint32_t layersPerArray) {
+	GLint maxLayers = 256;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+	this->layersPerArray = std::clamp<uint32_t>(layersPerArray, 1, maxLayers);
+}
+
+TextureArrayPool::~TextureArrayPool() {
+}
+
+TextureRegion TextureArrayPool::Allocate(uint32_t width, uint32_t height,
+		gl::TextureSizedInternalFormat format, uint32_t levels) {
+	if(levels == 0) {
+		levels = Texture::GetFullMipLevelsCount(width, height);
+	}
+	const Key key{width, height, levels, format};
+	std::vector<Array*>& candidates = byKey[key];
+	Array* array = nullptr;
+	for(Array* a : candidates) {
+		if(a->freeLayers.size()) {
+			array = a;
+			break;
+		}
+	}
+	if(array == nullptr) {
+		std::unique_ptr<Array> created = std::make_unique<Array>();
+		created->key = key;
+		created->texture.Storage3(TEXTURE_2D_ARRAY, width, height,
+				layersPerArray, levels, format);
+		if(created->texture.Loaded() == false) {
+			return {};
+		}
+		created->texture.MinFilter(levels > 1 ? LINEAR_MIPMAP_LINEAR
+				: LINEAR);
+		created->texture.MagFilter(MAG_LINEAR);
+		// lowest layers are taken first
+		for(uint32_t i=layersPerArray; i>0; --i) {
+			created->freeLayers.emplace_back(i-1);
+		}
+		array = created.get();
+		candidates.emplace_back(array);
+		arrays[&array->texture] = std::move(created);
+	}
+
+	TextureRegion region;
+	region.array = &array->texture;
+	region.layer = array->freeLayers.back();
+	region.width = width;
+	region.height = height;
+	array->freeLayers.pop_back();
+	return region;
+}
+
+void TextureArrayPool::Free(const TextureRegion& region) {
+	auto it = arrays.find(region.array);
+	if(it == arrays.end()) {
+		GL_PUSH_CUSTOM_ERROR(-1, "TextureArrayPool::Free called with region "
+				"not allocated from this pool");
+		return;
+	}
+	Array* array = it->second.get();
+	array->freeLayers.emplace_back(region.layer);
+	if(array->freeLayers.size() == layersPerArray) {
+		std::vector<Array*>& candidates = byKey[array->key];
+		candidates.erase(std::find(candidates.begin(), candidates.end(),
+					array));
+		if(candidates.empty()) {
+			byKey.erase(array->key);
+		}
+		arrays.erase(it);
+	}
+}
+
+TextureRegion TextureArrayPool::Load(const char* fileName,
+		bool generateMipMap, gl::TextureSizedInternalFormat format) {
+	int w = 0, h = 0, channels = 0;
+	uint8_t* pixels = Texture::LoadImageData(fileName, &w, &h, &channels, 4);
+	if(pixels == nullptr) {
+		printf("\n ERROR::TEXTURE_ARRAY_POOL::FILE_NOT_READ: `%s`\n",
+				fileName);
+		return {};
+	}
+	TextureRegion region = Allocate(w, h, format, generateMipMap ? 0 : 1);
+	if(region.Valid()) {
+		region.Update(pixels, RGBA, UNSIGNED_BYTE);
+		if(generateMipMap) {
+			arrays[region.array]->mipmapsDirty = true;
+		}
+	}
+	Texture::FreeImageData(pixels);
+	return region;
+}
+
+void TextureArrayPool::Flush() {
+	for(auto& it : arrays) {
+		if(it.second->mipmapsDirty) {
+			it.second->texture.GenerateMipmaps();
+			it.second->mipmapsDirty = false;
+		}
+	}
+}
+
+uint32_t TextureArrayPool::GetUsedLayersCount() const {
+	uint32_t used = 0;
+	for(const auto& it : arrays) {
+		used += layersPerArray - it.second->freeLayers.size();
+	}
+	return used;
+}
+
+} // namespace gl
@@ -0,0 +1,198 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include "../include/openglwrapper/OpenGL.hpp"
+
+#include "../include/openglwrapper/TextureAtlas.hpp"
+
+namespace gl {
+
+SkylinePacker::SkylinePacker(uint32_t width, uint32_t height) {
+	Reset(width, height);
+}
+
+void SkylinePacker::Reset(uint32_t width, uint32_t height) {
+	this->width = width;
+	this->height = height;
+	usedArea = 0;
+	skyline.clear();
+	skyline.push_back({0, 0, width});
+}
+
+bool SkylinePacker::Fit(size_t index, uint32_t w, uint32_t h,
+		uint32_t& y) const {
+	if(skyline[index].x + w > width) {
+		return false;
+	}
+	y = 0;
+	int64_t remaining = w;
+	for(size_t i=index; remaining > 0; ++i) {
+		if(i >= skyline.size()) {
+			return false;
+		}
+		y = std::max(y, skyline[i].y);
+		if(y + h > height) {
+			return false;
+		}
+		remaining -= skyline[i].width;
+	}
+	return true;
+}
+
+bool SkylinePacker::Insert(uint32_t w, uint32_t h, uint32_t& x,
+		uint32_t& y) {
+	size_t bestIndex = skyline.size();
+	uint32_t bestTop = 0xFFFFFFFF, bestWidth = 0xFFFFFFFF;
+	for(size_t i=0; i<skyline.size(); ++i) {
+		uint32_t top;
+		if(Fit(i, w, h, top)) {
+			top += h;
+			if(top < bestTop || (top == bestTop
+						&& skyline[i].width < bestWidth)) {
+				bestIndex = i;
+				bestTop = top;
+				bestWidth = skyline[i].width;
+			}
+		}
+	}
+	if(bestIndex == skyline.size()) {
+		return false;
+	}
+	x = skyline[bestIndex].x;
+	y = bestTop - h;
+	skyline.insert(skyline.begin()+bestIndex, Node{x, bestTop, w});
+
+	// cut nodes shadowed by the new one
+	for(size_t i=bestIndex+1; i<skyline.size();) {
+		const Node& prev = skyline[i-1];
+		const uint32_t prevEnd = prev.x + prev.width;
+		if(skyline[i].x >= prevEnd) {
+			break;
+		}
+		const uint32_t shrink = prevEnd - skyline[i].x;
+		if(skyline[i].width <= shrink) {
+			skyline.erase(skyline.begin()+i);
+		} else {
+			skyline[i].x += shrink;
+			skyline[i].width -= shrink;
+			break;
+		}
+	}
+	for(size_t i=0; i+1<skyline.size();) {
+		if(skyline[i].y == skyline[i+1].y) {
+			skyline[i].width += skyline[i+1].width;
+			skyline.erase(skyline.begin()+i+1);
+		} else {
+			++i;
+		}
+	}
+	usedArea += (uint64_t)w * h;
+	return true;
+}
+
+float SkylinePacker::GetOccupancy() const {
+	return width && height ? (double)usedArea / ((uint64_t)width*height) : 0;
+}
+
+TextureAtlas::TextureAtlas(uint32_t size, uint32_t layers,
+		gl::TextureSizedInternalFormat format, uint32_t padding,
+		uint32_t levels) : packers(layers, SkylinePacker(size, size)),
+	size(size), padding(padding) {
+	texture.Storage3(TEXTURE_2D_ARRAY, size, size, layers, levels, format);
+	texture.MinFilter(levels > 1 ? LINEAR_MIPMAP_LINEAR : LINEAR);
+	texture.MagFilter(MAG_LINEAR);
+}
+
+TextureAtlas::~TextureAtlas() {
+}
+
+TextureRegion TextureAtlas::Allocate(uint32_t w, uint32_t h) {
+	const uint32_t pw = w + 2*padding, ph = h + 2*padding;
+	for(uint32_t layer=0; layer<packers.size(); ++layer) {
+		uint32_t x, y;
+		if(packers[layer].Insert(pw, ph, x, y)) {
+			TextureRegion region;
+			region.array = &texture;
+			region.layer = layer;
+			region.x = x + padding;
+			region.y = y + padding;
+			region.width = w;
+			region.height = h;
+			const float scale = 1.0f / size;
+			region.uvRect = glm::vec4(region.x * scale, region.y * scale,
+					(region.x + w) * scale, (region.y + h) * scale);
+			return region;
+		}
+	}
+	return {};
+}
+
+TextureRegion TextureAtlas::Insert(const uint8_t* pixels, uint32_t w,
+		uint32_t h) {
+	TextureRegion region = Allocate(w, h);
+	if(region.Valid() == false) {
+		GL_PUSH_CUSTOM_ERROR(-1, "TextureAtlas is full");
+		return region;
+	}
+	if(padding == 0) {
+		region.Update(pixels, RGBA, UNSIGNED_BYTE);
+		return region;
+	}
+	// replicate edge texels into padding
+	const uint32_t pw = w + 2*padding, ph = h + 2*padding;
+	std::vector<uint8_t> padded((size_t)pw * ph * 4);
+	for(uint32_t y=0; y<ph; ++y) {
+		const uint32_t sy = std::clamp<int>((int)y - padding, 0, h-1);
+		for(uint32_t x=0; x<pw; ++x) {
+			const uint32_t sx = std::clamp<int>((int)x - padding, 0, w-1);
+			memcpy(&padded[((size_t)y*pw + x)*4],
+					pixels + ((size_t)sy*w + sx)*4, 4);
+		}
+	}
+	texture.Update3(padded.data(), region.x-padding, region.y-padding,
+			region.layer, pw, ph, 1, 0, RGBA, UNSIGNED_BYTE);
+	return region;
+}
+
+TextureRegion TextureAtlas::Load(const char* fileName) {
+	int w = 0, h = 0, channels = 0;
+	uint8_t* pixels = Texture::LoadImageData(fileName, &w, &h, &channels, 4);
+	if(pixels == nullptr) {
+		printf("\n ERROR::TEXTURE_ATLAS::FILE_NOT_READ: `%s`\n", fileName);
+		return {};
+	}
+	TextureRegion region = Insert(pixels, w, h);
+	Texture::FreeImageData(pixels);
+	return region;
+}
+
+void TextureAtlas::Clear() {
+	for(SkylinePacker& packer : packers) {
+		packer.Reset(size, size);
+	}
+}
+
+float TextureAtlas::GetOccupancy(uint32_t layer) const {
+	return packers[layer].GetOccupancy();
+}
+
+} // namespace gl
@@ -0,0 +1,476 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define OGLW_TEXTURE_CONTAINER_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "../include/openglwrapper/OpenGL.hpp"
+
+#include "../include/openglwrapper/TextureCooker.hpp"
+
+#include "../include/openglwrapper/TextureContainer.hpp"
+
+namespace gl {
+
+namespace {
+	inline uint32_t Read32(const uint8_t* p) {
+		uint32_t v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	inline uint64_t Read64(const uint8_t* p) {
+		uint64_t v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	constexpr uint32_t FourCC(char a, char b, char c, char d) {
+		return (uint32_t)(uint8_t)a | ((uint32_t)(uint8_t)b << 8)
+			| ((uint32_t)(uint8_t)c << 16) | ((uint32_t)(uint8_t)d << 24);
+	}
+
+	const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+	const uint32_t DDSD_DEPTH = 0x800000;
+	const uint32_t DDPF_ALPHAPIXELS = 0x1;
+	const uint32_t DDPF_FOURCC = 0x4;
+	const uint32_t DDPF_RGB = 0x40;
+	const uint32_t DDSCAPS2_CUBEMAP = 0x200;
+	const uint32_t DDS_RESOURCE_MISC_TEXTURECUBE = 0x4;
+	const uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+	// limits of header values accepted from files
+	const uint32_t MAX_CONTAINER_SIZE = 65536;
+	const uint32_t MAX_CONTAINER_LAYERS = 2048;
+
+	// Clamps levels to full mip chain and checks that layers and faces are
+	// sane and that base levels fit in the file, before anything is
+	// allocated from header values.
+	bool ValidateLayout(TextureSizedInternalFormat format, uint32_t width,
+			uint32_t height, uint32_t& levels, uint32_t layers, uint32_t faces,
+			size_t size) {
+		if(width == 0 || height == 0 || width > MAX_CONTAINER_SIZE
+				|| height > MAX_CONTAINER_SIZE || layers == 0
+				|| layers > MAX_CONTAINER_LAYERS || (faces != 1 && faces != 6)) {
+			return false;
+		}
+		uint32_t maxLevels = 1;
+		while((std::max(width, height) >> maxLevels) > 0) {
+			++maxLevels;
+		}
+		levels = std::min(std::max(levels, 1u), maxLevels);
+		return Texture::GetImageBytes(format, width, height) * layers * faces
+			<= size;
+	}
+
+	const uint8_t KTX2_IDENTIFIER[12] = {
+		0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+	};
+
+	bool FromDXGI(uint32_t dxgi, TextureSizedInternalFormat& format) {
+		switch(dxgi) {
+			case 28: format = RGBA8; return true;
+			case 29: format = SRGB8_ALPHA8; return true;
+			case 71: format = COMPRESSED_RGBA_BC1; return true;
+			case 72: format = COMPRESSED_SRGB_ALPHA_BC1; return true;
+			case 77: format = COMPRESSED_RGBA_BC3; return true;
+			case 78: format = COMPRESSED_SRGB_ALPHA_BC3; return true;
+			case 80: format = COMPRESSED_RED_BC4; return true;
+			case 81: format = COMPRESSED_SIGNED_RED_BC4; return true;
+			case 83: format = COMPRESSED_RG_BC5; return true;
+			case 84: format = COMPRESSED_SIGNED_RG_BC5; return true;
+			case 98: format = COMPRESSED_RGBA_BC7; return true;
+			case 99: format = COMPRESSED_SRGB_ALPHA_BC7; return true;
+		}
+		return false;
+	}
+
+	bool FromVkFormat(uint32_t vkFormat, TextureSizedInternalFormat& format) {
+		switch(vkFormat) {
+			case 37: format = RGBA8; return true;
+			case 43: format = SRGB8_ALPHA8; return true;
+			case 131: format = COMPRESSED_RGB_BC1; return true;
+			case 132: format = COMPRESSED_SRGB_BC1; return true;
+			case 133: format = COMPRESSED_RGBA_BC1; return true;
+			case 134: format = COMPRESSED_SRGB_ALPHA_BC1; return true;
+			case 137: format = COMPRESSED_RGBA_BC3; return true;
+			case 138: format = COMPRESSED_SRGB_ALPHA_BC3; return true;
+			case 139: format = COMPRESSED_RED_BC4; return true;
+			case 140: format = COMPRESSED_SIGNED_RED_BC4; return true;
+			case 141: format = COMPRESSED_RG_BC5; return true;
+			case 142: format = COMPRESSED_SIGNED_RG_BC5; return true;
+			case 145: format = COMPRESSED_RGBA_BC7; return true;
+			case 146: format = COMPRESSED_SRGB_ALPHA_BC7; return true;
+		}
+		return false;
+	}
+}
+
+TextureContainer::TextureContainer() {
+	mapped = nullptr;
+	mappedSize = 0;
+	format = RGBA8;
+	width = height = 0;
+	levels = layers = faces = 0;
+}
+
+TextureContainer::~TextureContainer() {
+	Unmap();
+}
+
+void TextureContainer::Unmap() {
+#ifdef OGLW_TEXTURE_CONTAINER_MMAP
+	if(mapped) {
+		munmap(mapped, mappedSize);
+	}
+#endif
+	mapped = nullptr;
+	mappedSize = 0;
+}
+
+bool TextureContainer::IsContainerFile(const std::string& fileName) {
+	std::string ext = fileName.substr(std::min(fileName.rfind('.'),
+				fileName.size()));
+	std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+	return ext == ".dds" || ext == ".ktx2" || ext == ".oglwtex";
+}
+
+bool TextureContainer::Load(const std::string& fileName) {
+	Unmap();
+	fileData.clear();
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+#ifdef OGLW_TEXTURE_CONTAINER_MMAP
+	int fd = open(fileName.c_str(), O_RDONLY);
+	struct stat st;
+	if(fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0) {
+		void* ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(ptr != MAP_FAILED) {
+			madvise(ptr, st.st_size, MADV_SEQUENTIAL);
+			mapped = ptr;
+			mappedSize = st.st_size;
+			data = (const uint8_t*)ptr;
+			size = mappedSize;
+		}
+	}
+	if(fd >= 0) {
+		close(fd);
+	}
+#endif
+	if(data == nullptr) {
+		std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+		if(!file.good()) {
+			printf("\n ERROR::TEXTURE_CONTAINER::FILE_NOT_READ: `%s`\n",
+					fileName.c_str());
+			return false;
+		}
+		fileData.resize(file.tellg());
+		file.seekg(0);
+		file.read((char*)fileData.data(), fileData.size());
+		data = fileData.data();
+		size = file.gcount();
+	}
+	if(Parse(data, size) == false) {
+		printf("\n ERROR::TEXTURE_CONTAINER::INVALID_FILE: `%s`\n",
+				fileName.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool TextureContainer::Parse(const uint8_t* data, size_t size) {
+	images.clear();
+	if(size >= 128 && Read32(data) == FourCC('D', 'D', 'S', ' ')) {
+		return ParseDDS(data, size);
+	} else if(size >= 80 && memcmp(data, KTX2_IDENTIFIER, 12) == 0) {
+		return ParseKTX2(data, size);
+	} else if(size >= sizeof(CookedTextureHeader)
+			&& memcmp(data, COOKED_TEXTURE_MAGIC, 8) == 0) {
+		return ParseCooked(data, size);
+	}
+	return false;
+}
+
+bool TextureContainer::ParseDDS(const uint8_t* data, size_t size) {
+	const uint32_t flags = Read32(data+8);
+	height = Read32(data+12);
+	width = Read32(data+16);
+	const uint32_t depth = Read32(data+24);
+	const uint32_t mipCount = Read32(data+28);
+	const uint32_t pfFlags = Read32(data+80);
+	const uint32_t fourCC = Read32(data+84);
+	const uint32_t rgbBits = Read32(data+88);
+	const uint32_t caps2 = Read32(data+112);
+	size_t offset = 128;
+
+	if((flags & DDSD_DEPTH) && depth > 1) {
+		GL_PUSH_CUSTOM_ERROR(-1, "DDS volume textures are not supported");
+		return false;
+	}
+	levels = (flags & DDSD_MIPMAPCOUNT) && mipCount ? mipCount : 1;
+	faces = (caps2 & DDSCAPS2_CUBEMAP) ? 6 : 1;
+	layers = 1;
+
+	if(pfFlags & DDPF_FOURCC) {
+		switch(fourCC) {
+			case FourCC('D', 'X', 'T', '1'):
+				format = (pfFlags & DDPF_ALPHAPIXELS) ? COMPRESSED_RGBA_BC1
+					: COMPRESSED_RGB_BC1;
+				break;
+			case FourCC('D', 'X', 'T', '5'):
+				format = COMPRESSED_RGBA_BC3;
+				break;
+			case FourCC('A', 'T', 'I', '1'):
+			case FourCC('B', 'C', '4', 'U'):
+				format = COMPRESSED_RED_BC4;
+				break;
+			case FourCC('B', 'C', '4', 'S'):
+				format = COMPRESSED_SIGNED_RED_BC4;
+				break;
+			case FourCC('A', 'T', 'I', '2'):
+			case FourCC('B', 'C', '5', 'U'):
+				format = COMPRESSED_RG_BC5;
+				break;
+			case FourCC('B', 'C', '5', 'S'):
+				format = COMPRESSED_SIGNED_RG_BC5;
+				break;
+			case FourCC('D', 'X', '1', '0'): {
+				if(size < 148) {
+					return false;
+				}
+				const uint32_t dxgi = Read32(data+128);
+				const uint32_t dimension = Read32(data+132);
+				const uint32_t misc = Read32(data+136);
+				const uint32_t arraySize = Read32(data+140);
+				offset = 148;
+				if(dimension != DDS_DIMENSION_TEXTURE2D
+						|| FromDXGI(dxgi, format) == false) {
+					GL_PUSH_CUSTOM_ERROR(-1, "Unsupported DDS DX10 format");
+					return false;
+				}
+				faces = (misc & DDS_RESOURCE_MISC_TEXTURECUBE) ? 6 : 1;
+				layers = std::max<uint32_t>(arraySize, 1);
+			} break;
+			default:
+				GL_PUSH_CUSTOM_ERROR(-1, "Unsupported DDS four character "
+						"code");
+				return false;
+		}
+	} else if((pfFlags & DDPF_RGB) && rgbBits == 32
+			&& Read32(data+92) == 0x000000FF && Read32(data+96) == 0x0000FF00
+			&& Read32(data+100) == 0x00FF0000) {
+		format = RGBA8;
+	} else {
+		GL_PUSH_CUSTOM_ERROR(-1, "Unsupported DDS pixel format");
+		return false;
+	}
+
+	if(ValidateLayout(format, width, height, levels, layers, faces, size)
+			== false) {
+		return false;
+	}
+	// DDS stores all levels of each layer and face together
+	images.resize(levels * layers * faces);
+	for(uint32_t layer=0; layer<layers; ++layer) {
+		for(uint32_t face=0; face<faces; ++face) {
+			for(uint32_t level=0; level<levels; ++level) {
+				Image& image = images[(level*layers + layer)*faces + face];
+				image.width = std::max<uint32_t>(width >> level, 1);
+				image.height = std::max<uint32_t>(height >> level, 1);
+				image.bytes = Texture::GetImageBytes(format, image.width,
+						image.height);
+				if(offset + image.bytes > size) {
+					return false;
+				}
+				image.data = data + offset;
+				offset += image.bytes;
+			}
+		}
+	}
+	return true;
+}
+
+bool TextureContainer::ParseKTX2(const uint8_t* data, size_t size) {
+	const uint32_t vkFormat = Read32(data+12);
+	width = Read32(data+20);
+	height = Read32(data+24);
+	const uint32_t depth = Read32(data+28);
+	layers = std::max<uint32_t>(Read32(data+32), 1);
+	faces = Read32(data+36);
+	levels = std::max<uint32_t>(Read32(data+40), 1);
+	const uint32_t supercompression = Read32(data+44);
+
+	if(supercompression != 0) {
+		GL_PUSH_CUSTOM_ERROR(-1, "KTX2 supercompression is not supported");
+		return false;
+	}
+	if(depth > 1 || height == 0 || width == 0 || (faces != 1 && faces != 6)) {
+		GL_PUSH_CUSTOM_ERROR(-1, "Only 2D, 2D array and cube map KTX2 "
+				"textures are supported");
+		return false;
+	}
+	if(FromVkFormat(vkFormat, format) == false) {
+		GL_PUSH_CUSTOM_ERROR(-1, "Unsupported KTX2 vkFormat");
+		return false;
+	}
+	if(ValidateLayout(format, width, height, levels, layers, faces, size)
+			== false || 80 + (size_t)levels*24 > size) {
+		return false;
+	}
+
+	// KTX2 stores all layers and faces of each level together
+	images.resize(levels * layers * faces);
+	for(uint32_t level=0; level<levels; ++level) {
+		const uint8_t* index = data + 80 + level*24;
+		uint64_t offset = Read64(index);
+		const uint64_t length = Read64(index+8);
+		const uint32_t w = std::max<uint32_t>(width >> level, 1);
+		const uint32_t h = std::max<uint32_t>(height >> level, 1);
+		const uint64_t bytes = Texture::GetImageBytes(format, w, h);
+		if(offset + length > size || bytes * layers * faces > length) {
+			return false;
+		}
+		for(uint32_t i=0; i<layers*faces; ++i) {
+			Image& image = images[level*layers*faces + i];
+			image.width = w;
+			image.height = h;
+			image.bytes = bytes;
+			image.data = data + offset;
+			offset += bytes;
+		}
+	}
+	return true;
+}
+
+bool TextureContainer::ParseCooked(const uint8_t* data, size_t size) {
+	CookedTextureHeader header;
+	memcpy(&header, data, sizeof(header));
+	format = (TextureSizedInternalFormat)header.format;
+	width = header.width;
+	height = header.height;
+	levels = header.levels;
+	layers = header.layers;
+	faces = header.faces;
+	if(TextureCooker::IsSupportedFormat(format) == false) {
+		GL_PUSH_CUSTOM_ERROR(-1, "Unsupported cooked texture format");
+		return false;
+	}
+	if(levels == 0 || ValidateLayout(format, width, height, levels, layers,
+				faces, size) == false) {
+		return false;
+	}
+	const size_t index = sizeof(header);
+	if(index + (size_t)levels*16 > size) {
+		return false;
+	}
+
+	images.resize(levels * layers * faces);
+	for(uint32_t level=0; level<levels; ++level) {
+		uint64_t offset = Read64(data + index + level*16);
+		const uint64_t length = Read64(data + index + level*16 + 8);
+		const uint32_t w = std::max<uint32_t>(width >> level, 1);
+		const uint32_t h = std::max<uint32_t>(height >> level, 1);
+		const uint64_t bytes = Texture::GetImageBytes(format, w, h);
+		if(offset + length > size || bytes * layers * faces != length) {
+			return false;
+		}
+		for(uint32_t i=0; i<layers*faces; ++i) {
+			Image& image = images[level*layers*faces + i];
+			image.width = w;
+			image.height = h;
+			image.bytes = bytes;
+			image.data = data + offset;
+			offset += bytes;
+		}
+	}
+	return true;
+}
+
+const TextureContainer::Image& TextureContainer::GetImage(uint32_t level,
+		uint32_t layer, uint32_t face) const {
+	return images[(level*layers + layer)*faces + face];
+}
+
+bool TextureContainer::Upload(Texture& texture, bool generateMipMap) const {
+	if(images.empty()) {
+		return false;
+	}
+	const bool compressed = Texture::IsCompressedFormat(format);
+	const bool generate = generateMipMap && levels == 1 && !compressed;
+	const uint32_t storageLevels = generate ? 0 : levels;
+	TextureTarget target = TEXTURE_2D;
+	if(faces == 6) {
+		target = layers > 1 ? TEXTURE_CUBE_MAP_ARRAY : TEXTURE_CUBE_MAP;
+	} else if(layers > 1) {
+		target = TEXTURE_2D_ARRAY;
+	}
+
+	if(target == TEXTURE_2D || target == TEXTURE_CUBE_MAP) {
+		texture.Storage2(target, width, height, storageLevels, format);
+	} else {
+		texture.Storage3(target, width, height, layers*faces, storageLevels,
+				format);
+	}
+	if(texture.Loaded() == false) {
+		return false;
+	}
+
+	for(uint32_t level=0; level<levels; ++level) {
+		for(uint32_t layer=0; layer<layers; ++layer) {
+			for(uint32_t face=0; face<faces; ++face) {
+				const Image& image = GetImage(level, layer, face);
+				if(target == TEXTURE_2D) {
+					if(compressed) {
+						texture.UpdateCompressed2(image.data, 0, 0, image.width,
+								image.height, level, image.bytes);
+					} else {
+						texture.Update2(image.data, 0, 0, image.width,
+								image.height, level, RGBA, UNSIGNED_BYTE);
+					}
+				} else {
+					// cube faces are addressed as layers with DSA
+					const uint32_t z = layer*faces + face;
+					if(compressed) {
+						texture.UpdateCompressed3(image.data, 0, 0, z,
+								image.width, image.height, 1, level,
+								image.bytes);
+					} else {
+						texture.Update3(image.data, 0, 0, z, image.width,
+								image.height, 1, level, RGBA, UNSIGNED_BYTE);
+					}
+				}
+			}
+		}
+	}
+	if(generate) {
+		texture.GenerateMipmaps();
+	}
+	return true;
+}
+
+} // namespace gl
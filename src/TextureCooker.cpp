@@ -0,0 +1,519 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <fstream>
+#include <algorithm>
+
+#include "../include/openglwrapper/TextureContainer.hpp"
+
+#include "../include/openglwrapper/TextureCooker.hpp"
+
+namespace gl {
+
+namespace {
+	const float PI = 3.14159265358979f;
+	// support of Kaiser windowed sinc, in destination texels
+	const float KAISER_RADIUS = 2.0f;
+	const float KAISER_ALPHA = 4.0f;
+
+	struct Tap {
+		uint32_t index;
+		float weight;
+	};
+
+	// Channels are interleaved so that inner loops work on 4 consecutive
+	// floats and vectorize.
+	struct Image {
+		std::vector<float> pixels;
+		uint32_t width, height;
+	};
+
+	float SRGBToLinear(float c) {
+		return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float LinearToSRGB(float c) {
+		return c <= 0.0031308f ? c * 12.92f
+			: 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+	}
+
+	float BesselI0(float x) {
+		float sum = 1.0f, term = 1.0f;
+		const float q = x * x * 0.25f;
+		for(int k=1; k<32 && term > sum*1e-7f; ++k) {
+			term *= q / (float)(k * k);
+			sum += term;
+		}
+		return sum;
+	}
+
+	float Kaiser(float x) {
+		const float t = x / KAISER_RADIUS;
+		if(t <= -1.0f || t >= 1.0f) {
+			return 0.0f;
+		}
+		const float window = BesselI0(KAISER_ALPHA * sqrtf(1.0f - t*t))
+			/ BesselI0(KAISER_ALPHA);
+		const float sinc = fabsf(x) < 1e-5f ? 1.0f : sinf(PI*x) / (PI*x);
+		return sinc * window;
+	}
+
+	// Weights of source texels contributing to each destination texel.
+	std::vector<std::vector<Tap>> ComputeTaps(uint32_t src, uint32_t dst,
+			TextureCooker::MipFilter filter) {
+		std::vector<std::vector<Tap>> taps(dst);
+		const float scale = (float)src / (float)dst;
+		for(uint32_t i=0; i<dst; ++i) {
+			const float center = (i + 0.5f) * scale;
+			std::vector<Tap>& t = taps[i];
+			if(filter == TextureCooker::MIP_FILTER_BOX) {
+				const float begin = center - scale*0.5f;
+				const float end = center + scale*0.5f;
+				for(uint32_t j=(uint32_t)begin; j<src && j<end; ++j) {
+					const float w = std::min<float>(end, j+1)
+						- std::max<float>(begin, j);
+					if(w > 0.0f) {
+						t.push_back({j, w});
+					}
+				}
+			} else {
+				const int first = (int)floorf(center - KAISER_RADIUS*scale);
+				const int last = (int)ceilf(center + KAISER_RADIUS*scale);
+				for(int j=first; j<=last; ++j) {
+					const float w = Kaiser((j + 0.5f - center) / scale);
+					if(w != 0.0f) {
+						// clamp to edge
+						const uint32_t index = std::clamp<int>(j, 0, src-1);
+						t.push_back({index, w});
+					}
+				}
+			}
+			float sum = 0.0f;
+			for(const Tap& tap : t) {
+				sum += tap.weight;
+			}
+			for(Tap& tap : t) {
+				tap.weight /= sum;
+			}
+		}
+		return taps;
+	}
+
+	Image Downsample(const Image& src, TextureCooker::MipFilter filter) {
+		Image tmp, dst;
+		dst.width = std::max<uint32_t>(src.width/2, 1);
+		dst.height = std::max<uint32_t>(src.height/2, 1);
+		const std::vector<std::vector<Tap>> horizontal
+			= ComputeTaps(src.width, dst.width, filter);
+		const std::vector<std::vector<Tap>> vertical
+			= ComputeTaps(src.height, dst.height, filter);
+
+		tmp.width = dst.width;
+		tmp.height = src.height;
+		tmp.pixels.resize((size_t)tmp.width * tmp.height * 4);
+		for(uint32_t y=0; y<src.height; ++y) {
+			const float* row = &src.pixels[(size_t)y * src.width * 4];
+			float* out = &tmp.pixels[(size_t)y * tmp.width * 4];
+			for(uint32_t x=0; x<tmp.width; ++x) {
+				float acc[4] = {0, 0, 0, 0};
+				for(const Tap& tap : horizontal[x]) {
+					const float* p = row + tap.index*4;
+					for(int c=0; c<4; ++c) {
+						acc[c] += p[c] * tap.weight;
+					}
+				}
+				for(int c=0; c<4; ++c) {
+					out[x*4 + c] = acc[c];
+				}
+			}
+		}
+
+		// whole rows are accumulated at once, which keeps access sequential
+		dst.pixels.assign((size_t)dst.width * dst.height * 4, 0.0f);
+		const size_t rowFloats = (size_t)dst.width * 4;
+		for(uint32_t y=0; y<dst.height; ++y) {
+			float* out = &dst.pixels[y * rowFloats];
+			for(const Tap& tap : vertical[y]) {
+				const float* row = &tmp.pixels[tap.index * rowFloats];
+				for(size_t i=0; i<rowFloats; ++i) {
+					out[i] += row[i] * tap.weight;
+				}
+			}
+		}
+		return dst;
+	}
+
+	void Quantize(const Image& image, bool srgb, std::vector<uint8_t>& out) {
+		out.resize(image.pixels.size());
+		for(size_t i=0; i<image.pixels.size(); ++i) {
+			float v = std::clamp(image.pixels[i], 0.0f, 1.0f);
+			if(srgb && (i&3) != 3) {
+				v = LinearToSRGB(v);
+			}
+			out[i] = (uint8_t)(v * 255.0f + 0.5f);
+		}
+	}
+
+	void FetchBlock(const uint8_t* rgba, uint32_t w, uint32_t h, uint32_t bx,
+			uint32_t by, uint8_t block[16][4]) {
+		for(uint32_t i=0; i<16; ++i) {
+			const uint32_t x = std::min(bx*4 + (i&3), w-1);
+			const uint32_t y = std::min(by*4 + (i>>2), h-1);
+			memcpy(block[i], rgba + ((size_t)y*w + x)*4, 4);
+		}
+	}
+
+	uint16_t To565(const float c[3]) {
+		const int r = std::clamp((int)(c[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+		const int g = std::clamp((int)(c[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+		const int b = std::clamp((int)(c[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+		return (r << 11) | (g << 5) | b;
+	}
+
+	void From565(uint16_t c, int out[3]) {
+		const int r = c >> 11, g = (c >> 5) & 63, b = c & 31;
+		out[0] = (r << 3) | (r >> 2);
+		out[1] = (g << 2) | (g >> 4);
+		out[2] = (b << 3) | (b >> 2);
+	}
+
+	void Write16(uint8_t* out, uint16_t v) {
+		out[0] = v & 0xFF;
+		out[1] = v >> 8;
+	}
+
+	// Endpoints are extremes of block colors projected on principal axis.
+	void EncodeBC1(const uint8_t block[16][4], bool alpha, uint8_t* out) {
+		bool transparent[16];
+		bool anyTransparent = false;
+		float mean[3] = {0, 0, 0};
+		int opaque = 0;
+		for(int i=0; i<16; ++i) {
+			transparent[i] = alpha && block[i][3] < 128;
+			anyTransparent |= transparent[i];
+			if(!transparent[i]) {
+				for(int c=0; c<3; ++c) {
+					mean[c] += block[i][c];
+				}
+				++opaque;
+			}
+		}
+		if(opaque == 0) {
+			// color0 <= color1 selects 3 color mode, index 3 is transparent
+			memset(out, 0, 4);
+			memset(out+4, 0xFF, 4);
+			return;
+		}
+		for(int c=0; c<3; ++c) {
+			mean[c] /= opaque;
+		}
+		float cov[6] = {0, 0, 0, 0, 0, 0};
+		for(int i=0; i<16; ++i) {
+			if(transparent[i]) {
+				continue;
+			}
+			const float r = block[i][0]-mean[0], g = block[i][1]-mean[1],
+				  b = block[i][2]-mean[2];
+			cov[0] += r*r; cov[1] += r*g; cov[2] += r*b;
+			cov[3] += g*g; cov[4] += g*b; cov[5] += b*b;
+		}
+		float axis[3] = {1, 1, 1};
+		for(int it=0; it<8; ++it) {
+			const float x = cov[0]*axis[0] + cov[1]*axis[1] + cov[2]*axis[2];
+			const float y = cov[1]*axis[0] + cov[3]*axis[1] + cov[4]*axis[2];
+			const float z = cov[2]*axis[0] + cov[4]*axis[1] + cov[5]*axis[2];
+			const float len = std::max(fabsf(x), std::max(fabsf(y), fabsf(z)));
+			if(len < 1e-6f) {
+				break;
+			}
+			axis[0] = x/len; axis[1] = y/len; axis[2] = z/len;
+		}
+		const float axisLength = axis[0]*axis[0] + axis[1]*axis[1]
+			+ axis[2]*axis[2];
+		float minProj = 0, maxProj = 0;
+		for(int i=0; i<16; ++i) {
+			if(transparent[i]) {
+				continue;
+			}
+			const float p = ((block[i][0]-mean[0])*axis[0]
+					+ (block[i][1]-mean[1])*axis[1]
+					+ (block[i][2]-mean[2])*axis[2]) / axisLength;
+			minProj = std::min(minProj, p);
+			maxProj = std::max(maxProj, p);
+		}
+		float e0[3], e1[3];
+		for(int c=0; c<3; ++c) {
+			e0[c] = mean[c] + axis[c]*maxProj;
+			e1[c] = mean[c] + axis[c]*minProj;
+		}
+		uint16_t c0 = To565(e0), c1 = To565(e1);
+		if(anyTransparent ? c0 > c1 : c0 < c1) {
+			std::swap(c0, c1);
+		}
+
+		int palette[4][3];
+		From565(c0, palette[0]);
+		From565(c1, palette[1]);
+		int colors = 4;
+		for(int c=0; c<3; ++c) {
+			if(anyTransparent) {
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				colors = 3;
+			} else {
+				palette[2][c] = (2*palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2*palette[1][c]) / 3;
+			}
+		}
+		uint32_t indices = 0;
+		for(int i=0; i<16; ++i) {
+			uint32_t best = 3;
+			if(!transparent[i] && c0 != c1) {
+				int bestError = 0x7FFFFFFF;
+				for(int p=0; p<colors; ++p) {
+					int error = 0;
+					for(int c=0; c<3; ++c) {
+						const int d = block[i][c] - palette[p][c];
+						error += d*d;
+					}
+					if(error < bestError) {
+						bestError = error;
+						best = p;
+					}
+				}
+			} else if(!transparent[i]) {
+				best = 0;
+			}
+			indices |= best << (i*2);
+		}
+		Write16(out, c0);
+		Write16(out+2, c1);
+		for(int i=0; i<4; ++i) {
+			out[4+i] = (indices >> (i*8)) & 0xFF;
+		}
+	}
+
+	void EncodeBC4(const uint8_t block[16][4], int channel, uint8_t* out) {
+		int r0 = 0, r1 = 255;
+		for(int i=0; i<16; ++i) {
+			r0 = std::max<int>(r0, block[i][channel]);
+			r1 = std::min<int>(r1, block[i][channel]);
+		}
+		out[0] = r0;
+		out[1] = r1;
+		uint64_t indices = 0;
+		if(r0 != r1) {
+			// r0 > r1 selects 8 value mode
+			int palette[8] = {r0, r1};
+			for(int i=1; i<7; ++i) {
+				palette[i+1] = ((7-i)*r0 + i*r1 + 3) / 7;
+			}
+			for(int i=0; i<16; ++i) {
+				uint64_t best = 0;
+				int bestError = 256;
+				for(int p=0; p<8; ++p) {
+					const int error = abs(block[i][channel] - palette[p]);
+					if(error < bestError) {
+						bestError = error;
+						best = p;
+					}
+				}
+				indices |= best << (i*3);
+			}
+		}
+		for(int i=0; i<6; ++i) {
+			out[2+i] = (indices >> (i*8)) & 0xFF;
+		}
+	}
+}
+
+bool TextureCooker::IsSupportedFormat(TextureSizedInternalFormat format) {
+	switch(format) {
+		case RGBA8:
+		case SRGB8_ALPHA8:
+		case COMPRESSED_RGB_BC1:
+		case COMPRESSED_RGBA_BC1:
+		case COMPRESSED_SRGB_BC1:
+		case COMPRESSED_SRGB_ALPHA_BC1:
+		case COMPRESSED_RGBA_BC3:
+		case COMPRESSED_SRGB_ALPHA_BC3:
+		case COMPRESSED_RED_BC4:
+		case COMPRESSED_RG_BC5:
+			return true;
+		default:
+			return false;
+	}
+}
+
+bool TextureCooker::IsSRGBFormat(TextureSizedInternalFormat format) {
+	switch(format) {
+		case SRGB8:
+		case SRGB8_ALPHA8:
+		case COMPRESSED_SRGB_BC1:
+		case COMPRESSED_SRGB_ALPHA_BC1:
+		case COMPRESSED_SRGB_ALPHA_BC3:
+		case COMPRESSED_SRGB_ALPHA_BC7:
+			return true;
+		default:
+			return false;
+	}
+}
+
+bool TextureCooker::Cook(const uint8_t* pixels, uint32_t width,
+		uint32_t height, const Settings& settings) {
+	levels.clear();
+	if(IsSupportedFormat(settings.format) == false) {
+		printf("\n ERROR::TEXTURE_COOKER::UNSUPPORTED_FORMAT: 0x%X\n",
+				settings.format);
+		return false;
+	}
+	if(pixels == nullptr || width == 0 || height == 0) {
+		return false;
+	}
+	this->format = settings.format;
+	this->width = width;
+	this->height = height;
+	const bool srgb = IsSRGBFormat(format);
+
+	float table[256];
+	for(int i=0; i<256; ++i) {
+		table[i] = srgb ? SRGBToLinear(i / 255.0f) : i / 255.0f;
+	}
+	Image image;
+	image.width = width;
+	image.height = height;
+	image.pixels.resize((size_t)width * height * 4);
+	for(size_t i=0; i<image.pixels.size(); ++i) {
+		image.pixels[i] = (i&3) == 3 ? pixels[i] / 255.0f : table[pixels[i]];
+	}
+
+	std::vector<uint8_t> rgba;
+	const uint32_t count = settings.generateMipMap
+		? Texture::GetFullMipLevelsCount(width, height) : 1;
+	levels.resize(count);
+	for(uint32_t level=0; level<count; ++level) {
+		if(level) {
+			image = Downsample(image, settings.filter);
+		}
+		if(level == 0) {
+			rgba.assign(pixels, pixels + image.pixels.size());
+		} else {
+			Quantize(image, srgb, rgba);
+		}
+		Encode(rgba, image.width, image.height, levels[level]);
+	}
+	return true;
+}
+
+bool TextureCooker::CookFile(const std::string& fileName,
+		const Settings& settings) {
+	int w = 0, h = 0, channels = 0;
+	uint8_t* pixels = Texture::LoadImageData(fileName.c_str(), &w, &h,
+			&channels, 4);
+	if(pixels == nullptr) {
+		printf("\n ERROR::TEXTURE_COOKER::FILE_NOT_READ: `%s`\n",
+				fileName.c_str());
+		return false;
+	}
+	const bool ret = Cook(pixels, w, h, settings);
+	Texture::FreeImageData(pixels);
+	return ret;
+}
+
+void TextureCooker::Encode(const std::vector<uint8_t>& rgba, uint32_t w,
+		uint32_t h, std::vector<uint8_t>& out) const {
+	out.resize(Texture::GetImageBytes(format, w, h));
+	if(Texture::IsCompressedFormat(format) == false) {
+		memcpy(out.data(), rgba.data(), out.size());
+		return;
+	}
+	const uint32_t blocksX = (w+3)/4, blocksY = (h+3)/4;
+	const uint32_t blockBytes = out.size() / (blocksX * blocksY);
+	uint8_t block[16][4];
+	uint8_t* dst = out.data();
+	for(uint32_t by=0; by<blocksY; ++by) {
+		for(uint32_t bx=0; bx<blocksX; ++bx, dst+=blockBytes) {
+			FetchBlock(rgba.data(), w, h, bx, by, block);
+			switch(format) {
+				case COMPRESSED_RGB_BC1:
+				case COMPRESSED_SRGB_BC1:
+					EncodeBC1(block, false, dst);
+					break;
+				case COMPRESSED_RGBA_BC1:
+				case COMPRESSED_SRGB_ALPHA_BC1:
+					EncodeBC1(block, true, dst);
+					break;
+				case COMPRESSED_RGBA_BC3:
+				case COMPRESSED_SRGB_ALPHA_BC3:
+					EncodeBC4(block, 3, dst);
+					// color block of BC3 is always decoded in 4 color mode
+					EncodeBC1(block, false, dst+8);
+					break;
+				case COMPRESSED_RED_BC4:
+					EncodeBC4(block, 0, dst);
+					break;
+				case COMPRESSED_RG_BC5:
+					EncodeBC4(block, 0, dst);
+					EncodeBC4(block, 1, dst+8);
+					break;
+				default:
+					break;
+			}
+		}
+	}
+}
+
+bool TextureCooker::Write(const std::string& fileName) const {
+	if(levels.empty()) {
+		return false;
+	}
+	std::ofstream file(fileName, std::ios::binary);
+	if(!file.good()) {
+		printf("\n ERROR::TEXTURE_COOKER::FILE_NOT_WRITTEN: `%s`\n",
+				fileName.c_str());
+		return false;
+	}
+	CookedTextureHeader header;
+	memcpy(header.magic, COOKED_TEXTURE_MAGIC, sizeof(header.magic));
+	header.format = format;
+	header.width = width;
+	header.height = height;
+	header.levels = levels.size();
+	header.layers = 1;
+	header.faces = 1;
+	header.reserved = 0;
+	file.write((const char*)&header, sizeof(header));
+
+	uint64_t offset = sizeof(header) + levels.size() * 2 * sizeof(uint64_t);
+	offset = (offset + 15) & ~(uint64_t)15;
+	for(const std::vector<uint8_t>& level : levels) {
+		const uint64_t entry[2] = {offset, level.size()};
+		file.write((const char*)entry, sizeof(entry));
+		offset += level.size();
+	}
+	const char padding[16] = {};
+	file.write(padding, (16 - file.tellp()%16) % 16);
+	for(const std::vector<uint8_t>& level : levels) {
+		file.write((const char*)level.data(), level.size());
+	}
+	return file.good();
+}
+
+} // namespace gl
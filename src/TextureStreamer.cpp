@@ -0,0 +1,293 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <cstdio>
+
+#include "../include/openglwrapper/OpenGL.hpp"
+
+#include "../include/openglwrapper/TextureStreamer.hpp"
+
+namespace gl {
+
+namespace {
+	const uint32_t RING_ALIGNMENT = 16;
+
+	inline uint32_t AlignRing(uint64_t bytes) {
+		return (bytes + RING_ALIGNMENT-1) / RING_ALIGNMENT * RING_ALIGNMENT;
+	}
+}
+
+TextureStreamer::TextureStreamer(uint32_t threads, uint32_t ringBytes,
+		uint32_t frameBudgetBytes) :
+	ring(1, PIXEL_UNPACK_BUFFER, STREAM_DRAW),
+	frameBudgetBytes(frameBudgetBytes) {
+	const uint32_t checker[4] = {0xFFFF00FF, 0xFF808080, 0xFF808080,
+		0xFFFF00FF};
+	placeholder.Storage2(TEXTURE_2D, 2, 2, 1, RGBA8);
+	placeholder.Update2(checker, 0, 0, 2, 2, 0, RGBA, UNSIGNED_BYTE);
+	placeholder.SetDefaultParamPixelartClampBorderNoMipmap();
+
+	ringSize = ringBytes - ringBytes%RING_ALIGNMENT;
+	ringPointer = (uint8_t*)ring.InitMapPersistent(nullptr, ringSize,
+			MAP_WRITE_BIT | MAP_COHERENT_BIT);
+	if(ringPointer == nullptr) {
+		GL_PUSH_CUSTOM_ERROR(-1, "TextureStreamer: failed to map pixel "
+				"unpack ring, uploading from client memory");
+		ringSize = 0;
+	}
+	ringHead = ringTail = ringUsed = 0;
+	uploaded = 0;
+	uploadedLastFrame = 0;
+	pending = 0;
+
+	if(threads == 0) {
+		threads = std::thread::hardware_concurrency();
+		threads = threads > 1 ? threads-1 : 1;
+	}
+	running = true;
+	for(uint32_t i=0; i<threads; ++i) {
+		workers.emplace_back([this](){ Run(); });
+	}
+}
+
+TextureStreamer::~TextureStreamer() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		running = false;
+	}
+	jobsCondition.notify_all();
+	ringCondition.notify_all();
+	for(std::thread& t : workers) {
+		t.join();
+	}
+	for(Staged& s : staged) {
+		if(s.pixels) {
+			Texture::FreeImageData(s.pixels);
+		}
+	}
+}
+
+std::shared_ptr<StreamedTexture> TextureStreamer::Load(
+		const std::string& fileName, bool generateMipMap,
+		int forceChannelsCount) {
+	return Load(fileName, generateMipMap,
+			(gl::TextureSizedInternalFormat)gl::RGBA, forceChannelsCount);
+}
+
+std::shared_ptr<StreamedTexture> TextureStreamer::Load(
+		const std::string& fileName, bool generateMipMap,
+		gl::TextureSizedInternalFormat forceSizedInternalFormat,
+		int forceChannelsCount) {
+	std::shared_ptr<StreamedTexture> texture
+		= std::make_shared<StreamedTexture>();
+	texture->fileName = fileName;
+	texture->internalFormat = forceSizedInternalFormat;
+	texture->forceChannelsCount = forceChannelsCount;
+	texture->generateMipMap = generateMipMap;
+	texture->placeholder = &placeholder;
+	texture->state = StreamedTexture::QUEUED;
+	++pending;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.emplace_back(texture);
+	}
+	jobsCondition.notify_one();
+	return texture;
+}
+
+void TextureStreamer::Update() {
+	std::vector<std::shared_ptr<StreamedTexture>> release;
+	std::lock_guard<std::mutex> lock(mutex);
+	release.swap(finished);
+	Retire();
+
+	uint64_t budget = frameBudgetBytes;
+	uint32_t count = 0;
+	GLint alignment = 4;
+	for(; uploaded < staged.size(); ++uploaded, ++count) {
+		Staged& s = staged[uploaded];
+		const uint64_t bytes = (uint64_t)s.width * s.height * s.channels;
+		// always progress by at least one texture per frame
+		if(s.ready == false || (count && bytes > budget)) {
+			break;
+		}
+		if(count == 0) {
+			glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		}
+		Upload(s);
+		budget = bytes > budget ? 0 : budget-bytes;
+	}
+	uploadedLastFrame = frameBudgetBytes - budget;
+	if(count) {
+		glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+		batches.push_back(Batch{Sync(), count});
+		batches.back().fence.StartFence();
+	}
+	// dropped textures are released here, on rendering thread
+	release.clear();
+}
+
+void TextureStreamer::Upload(Staged& s) {
+	StreamedTexture& t = *s.texture;
+	TextureDataFormat format = RGBA;
+	switch(s.channels) {
+		case 1: format = RED; break;
+		case 2: format = RG; break;
+		case 3: format = RGB; break;
+		default: format = RGBA; break;
+	}
+	t.texture.Storage2(TEXTURE_2D, s.width, s.height,
+			t.generateMipMap ? 0 : 1, t.internalFormat);
+	if(s.pixels) {
+		t.texture.Update2(s.pixels, 0, 0, s.width, s.height, 0, format,
+				UNSIGNED_BYTE);
+		Texture::FreeImageData(s.pixels);
+		s.pixels = nullptr;
+	} else {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring.GetIdGL());
+		t.texture.Update2((const void*)(uintptr_t)s.ringOffset, 0, 0, s.width,
+				s.height, 0, format, UNSIGNED_BYTE);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	if(t.generateMipMap) {
+		t.texture.GenerateMipmaps();
+	}
+	GL_CHECK_PUSH_ERROR;
+	t.state = StreamedTexture::UPLOADING;
+}
+
+void TextureStreamer::Retire() {
+	bool freed = false;
+	while(batches.size() && batches.front().fence.IsDone()) {
+		for(uint32_t i=0; i<batches.front().count; ++i) {
+			Staged& s = staged.front();
+			if(s.ringBytes) {
+				ringUsed -= s.ringBytes;
+				ringTail = s.ringOffset
+					+ AlignRing((uint64_t)s.width * s.height * s.channels);
+				freed = true;
+			}
+			s.texture->state = StreamedTexture::RESIDENT;
+			--pending;
+			staged.pop_front();
+			--uploaded;
+		}
+		batches.pop_front();
+	}
+	if(ringUsed == 0) {
+		ringHead = ringTail = 0;
+	}
+	if(freed) {
+		ringCondition.notify_all();
+	}
+}
+
+bool TextureStreamer::RingAllocate(uint32_t bytes, uint32_t& offset,
+		uint32_t& taken) {
+	bytes = AlignRing(bytes);
+	const bool wrapped = ringUsed > 0 && ringHead <= ringTail;
+	if(wrapped) {
+		if(ringTail - ringHead < bytes) {
+			return false;
+		}
+		offset = ringHead;
+		taken = bytes;
+	} else if(ringSize - ringHead >= bytes) {
+		offset = ringHead;
+		taken = bytes;
+	} else if(ringTail >= bytes) {
+		// skip space at the end of ring
+		offset = 0;
+		taken = bytes + (ringSize - ringHead);
+	} else {
+		return false;
+	}
+	ringHead = offset + bytes;
+	ringUsed += taken;
+	return true;
+}
+
+void TextureStreamer::Run() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while(running) {
+		if(jobs.empty()) {
+			jobsCondition.wait(lock);
+			continue;
+		}
+		std::shared_ptr<StreamedTexture> texture = std::move(jobs.front());
+		jobs.pop_front();
+		// nobody waits for this texture anymore
+		if(texture.use_count() == 1) {
+			texture->state = StreamedTexture::FAILED;
+			--pending;
+			finished.emplace_back(std::move(texture));
+			continue;
+		}
+		lock.unlock();
+
+		Staged s{nullptr, nullptr, 0, 0, 0, 0, 0, false};
+		s.pixels = Texture::LoadImageData(texture->fileName.c_str(), &s.width,
+				&s.height, &s.channels, texture->forceChannelsCount);
+		if(texture->forceChannelsCount) {
+			s.channels = texture->forceChannelsCount;
+		}
+		const uint64_t bytes = (uint64_t)s.width * s.height * s.channels;
+
+		lock.lock();
+		if(s.pixels == nullptr || s.channels < 1 || s.channels > 4) {
+			printf("\n ERROR::TEXTURE_STREAMER::LOAD_FAILED: `%s`\n",
+					texture->fileName.c_str());
+			if(s.pixels) {
+				Texture::FreeImageData(s.pixels);
+			}
+			texture->state = StreamedTexture::FAILED;
+			--pending;
+			finished.emplace_back(std::move(texture));
+			continue;
+		}
+
+		s.texture = std::move(texture);
+		if(bytes + RING_ALIGNMENT <= ringSize) {
+			while(running && !RingAllocate(bytes, s.ringOffset, s.ringBytes)) {
+				ringCondition.wait(lock);
+			}
+			if(!running) {
+				Texture::FreeImageData(s.pixels);
+				break;
+			}
+			staged.emplace_back(std::move(s));
+			Staged& entry = staged.back();
+			uint8_t* src = entry.pixels;
+			uint8_t* dst = ringPointer + entry.ringOffset;
+			entry.pixels = nullptr;
+			lock.unlock();
+			// deque references stay valid while other threads append
+			memcpy(dst, src, bytes);
+			Texture::FreeImageData(src);
+			lock.lock();
+			entry.ready = true;
+		} else {
+			s.ready = true;
+			staged.emplace_back(std::move(s));
+		}
+	}
+}
+
+} // namespace gl
@@ -0,0 +1,902 @@
+/*
+ *  This file is part of OpenGLWrapper.
+ *  Copyright (C) 2023 Marek Zalewski aka Drwalin
+ *
+ *  OpenGLWrapper is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  OpenGLWrapper is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <functional>
+
+#include "../include/openglwrapper/OpenGL.hpp"
+#include "../include/openglwrapper/TextureCooker.hpp"
+
+#include "../include/openglwrapper/VirtualTexture.hpp"
+
+namespace gl {
+
+namespace {
+	const uint32_t MAX_LEVELS = 15;
+	const uint32_t MAX_PAGES = 0x4000;
+
+	inline bool IsPowerOfTwo(uint32_t v) {
+		return v && (v & (v-1)) == 0;
+	}
+
+	// Marks every page ID read from feedback texture in bit set, first
+	// invocation setting the bit appends ID to request list. Cleared feedback
+	// texels have level 15 and are skipped.
+	const char* DEDUP_GLSL = R"(
+#version 450 core
+layout(local_size_x = 16, local_size_y = 16) in;
+uniform usampler2D feedback;
+layout(std430, binding = 0) buffer Seen { uint seen[]; };
+layout(std430, binding = 1) buffer Requests {
+	uint requestCount;
+	uint requests[];
+};
+uniform uint levels;
+uniform uint tiles;
+uniform uint maxRequests;
+uniform uint firstTile[16];
+uniform uint pagesX[16];
+void main() {
+	ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+	if(any(greaterThanEqual(p, textureSize(feedback, 0)))) {
+		return;
+	}
+	uint id = texelFetch(feedback, p, 0).r;
+	uint level = id >> 28;
+	if(level >= levels) {
+		return;
+	}
+	uint index = firstTile[level] + ((id >> 14) & 0x3FFFu) * pagesX[level]
+		+ (id & 0x3FFFu);
+	if(index >= tiles) {
+		return;
+	}
+	uint bit = 1u << (index & 31u);
+	if((seen[index >> 5] & bit) != 0u) {
+		return;
+	}
+	if((atomicOr(seen[index >> 5], bit) & bit) == 0u) {
+		uint slot = atomicAdd(requestCount, 1u);
+		if(slot < maxRequests) {
+			requests[slot] = id;
+		}
+	}
+}
+)";
+
+	const char* COMMON_GLSL = R"(
+float VTLod(vec2 uv) {
+	vec2 dx = dFdx(uv * VT_SIZE);
+	vec2 dy = dFdy(uv * VT_SIZE);
+	return 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8));
+}
+uint VTFeedback(vec2 uv) {
+	uint level = uint(clamp(VTLod(uv) - VT_FEEDBACK_BIAS, 0.0,
+			float(VT_LEVELS - 1)));
+	uvec2 pages = max(uvec2(VT_SIZE / VT_TILE_SIZE) >> level, uvec2(1));
+	uvec2 page = min(uvec2(clamp(uv, 0.0, 1.0) * vec2(pages)), pages - 1u);
+	return (level << 28) | (page.y << 14) | page.x;
+}
+)";
+
+	const char* SPARSE_GLSL = R"(
+uniform sampler2D vtTexture;
+uniform usampler2D vtMinLod;
+vec4 VTSample(vec2 uv) {
+	uv = clamp(uv, 0.0, 1.0);
+	ivec2 pages = textureSize(vtMinLod, 0);
+	float minLod = float(texelFetch(vtMinLod,
+			min(ivec2(uv * vec2(pages)), pages - 1), 0).r);
+	return textureLod(vtTexture, uv, max(VTLod(uv), minLod));
+}
+)";
+
+	// Page table entry holds slot of the finest resident page covering
+	// requested one and level of that page.
+	const char* SOFTWARE_GLSL = R"(
+uniform usampler2D vtPageTable;
+uniform sampler2D vtCache;
+vec4 VTSample(vec2 uv) {
+	uv = clamp(uv, 0.0, 1.0);
+	int level = int(clamp(VTLod(uv), 0.0, float(VT_LEVELS - 1)));
+	ivec2 pages = textureSize(vtPageTable, level);
+	uvec4 entry = texelFetch(vtPageTable,
+			min(ivec2(uv * vec2(pages)), pages - 1), level);
+	vec2 levelSize = max(floor(VT_SIZE / exp2(float(entry.z))), vec2(1.0));
+	vec2 texel = uv * levelSize;
+	vec2 page = min(floor(texel / VT_TILE_SIZE),
+			ceil(levelSize / VT_TILE_SIZE) - 1.0);
+	vec2 physical = vec2(entry.xy) * VT_SLOT_SIZE + VT_BORDER
+		+ texel - page * VT_TILE_SIZE;
+	return textureLod(vtCache, physical / vec2(textureSize(vtCache, 0)), 0.0);
+}
+)";
+}
+
+uint32_t VirtualTextureFile::GetPageLevelsCount(uint32_t width,
+		uint32_t height, uint32_t tileSize) {
+	uint32_t pages = std::max(width, height) / tileSize;
+	uint32_t levels = 1;
+	while(pages > 1) {
+		pages >>= 1;
+		++levels;
+	}
+	return levels;
+}
+
+bool VirtualTextureFile::Write(const std::string& fileName,
+		const TextureCooker& cooker, uint32_t tileSize, uint32_t border) {
+	const uint32_t width = cooker.GetWidth(), height = cooker.GetHeight();
+	if(cooker.GetFormat() != RGBA8 && cooker.GetFormat() != SRGB8_ALPHA8) {
+		GL_PUSH_CUSTOM_ERROR(-1, "Virtual texture needs RGBA8 or "
+				"SRGB8_ALPHA8 format");
+		return false;
+	}
+	if(tileSize == 0 || border >= tileSize || width % tileSize
+			|| height % tileSize || !IsPowerOfTwo(width / tileSize)
+			|| !IsPowerOfTwo(height / tileSize)) {
+		GL_PUSH_CUSTOM_ERROR(-1, "Virtual texture size needs to be power of "
+				"two multiple of tile size");
+		return false;
+	}
+	const uint32_t levels = GetPageLevelsCount(width, height, tileSize);
+	if(cooker.GetLevels().size() < levels) {
+		GL_PUSH_CUSTOM_ERROR(-1, "Virtual texture needs cooked mip levels");
+		return false;
+	}
+	std::ofstream file(fileName, std::ios::binary);
+	if(!file.good()) {
+		printf("\n ERROR::VIRTUAL_TEXTURE::FILE_NOT_WRITTEN: `%s`\n",
+				fileName.c_str());
+		return false;
+	}
+	VirtualTextureHeader header;
+	memcpy(header.magic, VIRTUAL_TEXTURE_MAGIC, sizeof(header.magic));
+	header.format = cooker.GetFormat();
+	header.width = width;
+	header.height = height;
+	header.tileSize = tileSize;
+	header.border = border;
+	header.levels = levels;
+	header.reserved = 0;
+	file.write((const char*)&header, sizeof(header));
+
+	const int slotSize = tileSize + 2*border;
+	std::vector<uint32_t> tile(slotSize * slotSize);
+	for(uint32_t level=0; level<levels; ++level) {
+		const int w = std::max(width>>level, 1u);
+		const int h = std::max(height>>level, 1u);
+		const uint32_t* src = (const uint32_t*)cooker.GetLevels()[level].data();
+		const int pagesX = std::max((width/tileSize)>>level, 1u);
+		const int pagesY = std::max((height/tileSize)>>level, 1u);
+		for(int py=0; py<pagesY; ++py) {
+			for(int px=0; px<pagesX; ++px) {
+				for(int y=0; y<slotSize; ++y) {
+					const int sy = std::clamp<int>(py*tileSize + y - border,
+							0, h-1);
+					for(int x=0; x<slotSize; ++x) {
+						const int sx = std::clamp<int>(px*tileSize + x - border,
+								0, w-1);
+						tile[y*slotSize + x] = src[sy*w + sx];
+					}
+				}
+				file.write((const char*)tile.data(), tile.size()*4);
+			}
+		}
+	}
+	if(!file.good()) {
+		printf("\n ERROR::VIRTUAL_TEXTURE::FILE_NOT_WRITTEN: `%s`\n",
+				fileName.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool VirtualTextureFile::Open(const std::string& fileName) {
+	Close();
+	file.open(fileName, std::ios::binary);
+	if(!file.good()) {
+		printf("\n ERROR::VIRTUAL_TEXTURE::FILE_NOT_READ: `%s`\n",
+				fileName.c_str());
+		return false;
+	}
+	file.read((char*)&header, sizeof(header));
+	const bool valid = file.good()
+		&& !memcmp(header.magic, VIRTUAL_TEXTURE_MAGIC, sizeof(header.magic))
+		&& (header.format == RGBA8 || header.format == SRGB8_ALPHA8)
+		&& header.tileSize && header.border < header.tileSize
+		&& header.width % header.tileSize == 0
+		&& header.height % header.tileSize == 0
+		&& IsPowerOfTwo(header.width / header.tileSize)
+		&& IsPowerOfTwo(header.height / header.tileSize)
+		&& header.levels == GetPageLevelsCount(header.width, header.height,
+				header.tileSize);
+	if(!valid) {
+		printf("\n ERROR::VIRTUAL_TEXTURE::INVALID_FILE: `%s`\n",
+				fileName.c_str());
+		Close();
+		return false;
+	}
+	const uint32_t slotSize = header.tileSize + 2*header.border;
+	tileBytes = slotSize * slotSize * 4;
+	firstTile.resize(header.levels + 1);
+	firstTile[0] = 0;
+	for(uint32_t level=0; level<header.levels; ++level) {
+		firstTile[level+1] = firstTile[level]
+			+ GetPagesX(level) * GetPagesY(level);
+	}
+	file.seekg(0, std::ios::end);
+	const uint64_t size = file.tellg();
+	if(size < sizeof(header) + (uint64_t)firstTile.back() * tileBytes) {
+		printf("\n ERROR::VIRTUAL_TEXTURE::INVALID_FILE: `%s`\n",
+				fileName.c_str());
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void VirtualTextureFile::Close() {
+	if(file.is_open()) {
+		file.close();
+	}
+	file.clear();
+	firstTile.clear();
+	tileBytes = 0;
+}
+
+bool VirtualTextureFile::ReadTile(uint32_t level, uint32_t x, uint32_t y,
+		uint8_t* pixels) {
+	const uint64_t tile = firstTile[level] + y * GetPagesX(level) + x;
+	file.seekg(sizeof(header) + tile * tileBytes);
+	file.read((char*)pixels, tileBytes);
+	if(!file.good()) {
+		file.clear();
+		return false;
+	}
+	return true;
+}
+
+
+
+VirtualTexture::VirtualTexture() : seen(sizeof(uint32_t),
+		SHADER_STORAGE_BUFFER, STREAM_DRAW) {
+	levels = 0;
+	sparse = false;
+	opened = false;
+	residentCount = 0;
+	pendingCount = 0;
+	frame = 0;
+	pageTableDirty = false;
+	sparseLevels = 0;
+	slotsX = 1;
+	readbackHead = 0;
+	feedbackWidth = feedbackHeight = 0;
+	requestsLastFrame = 0;
+	uploadsLastFrame = 0;
+	evictionsLastFrame = 0;
+	running = false;
+}
+
+VirtualTexture::~VirtualTexture() {
+	Destroy();
+}
+
+bool VirtualTexture::Open(const std::string& fileName,
+		const Settings& settings) {
+	Destroy();
+	if(!file.Open(fileName)) {
+		return false;
+	}
+	this->settings = settings;
+	levels = file.GetHeader().levels;
+	if(levels > MAX_LEVELS || file.GetPagesX(0) > MAX_PAGES
+			|| file.GetPagesY(0) > MAX_PAGES) {
+		GL_PUSH_CUSTOM_ERROR(-1, "Virtual texture has too many pages");
+		file.Close();
+		return false;
+	}
+	pages.assign(file.GetFirstTile(levels), Page{});
+
+	sparse = !settings.forceSoftware && CreateSparse();
+	if(!sparse && !CreateSoftware()) {
+		Destroy();
+		return false;
+	}
+	CreateFeedbackPass();
+	GenerateGLSL();
+
+	// coarsest page level and mip tail of sparse texture are always resident
+	uint32_t firstPinned = levels-1;
+	if(sparse) {
+		firstPinned = std::min(firstPinned, sparseLevels);
+	}
+	std::vector<uint8_t> pixels(file.GetTileBytes());
+	for(uint32_t page=file.GetFirstTile(firstPinned); page<pages.size();
+			++page) {
+		uint32_t level, x, y;
+		DecodePage(page, level, x, y);
+		if(!file.ReadTile(level, x, y, pixels.data())) {
+			GL_PUSH_CUSTOM_ERROR(-1, "Cannot read virtual texture tile");
+			Destroy();
+			return false;
+		}
+		if(!sparse) {
+			pages[page].slot = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		Upload(page, pixels.data());
+		pages[page].state = PAGE_PINNED;
+	}
+	UpdatePageTable();
+
+	opened = true;
+	running = true;
+	worker = std::thread(&VirtualTexture::Run, this);
+	return true;
+}
+
+void VirtualTexture::Destroy() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		running = false;
+		jobs.clear();
+	}
+	jobsCondition.notify_all();
+	if(worker.joinable()) {
+		worker.join();
+	}
+	loaded.clear();
+	pages.clear();
+	lru.clear();
+	freeSlots.clear();
+	residentCount = 0;
+	pendingCount = 0;
+	pageTableDirty = false;
+
+	texture.Destroy();
+	minLod.Destroy();
+	cache.Destroy();
+	pageTable.Destroy();
+	feedbackFbo.Destroy();
+	feedbackColor.Destroy();
+	feedbackDepth.Destroy();
+	feedbackWidth = feedbackHeight = 0;
+	dedupShader.Destroy();
+	seen.Destroy();
+	for(Readback& readback : readbacks) {
+		readback.requests.Destroy();
+		readback.fence.Destroy();
+		readback.pending = false;
+	}
+	readbackHead = 0;
+	glsl.clear();
+	file.Close();
+	opened = false;
+}
+
+bool VirtualTexture::CreateSparse() {
+	if(!GLEW_ARB_sparse_texture) {
+		return false;
+	}
+	const VirtualTextureHeader& header = file.GetHeader();
+	GLint count = 0;
+	glGetInternalformativ(GL_TEXTURE_2D, header.format,
+			GL_NUM_VIRTUAL_PAGE_SIZES_ARB, 1, &count);
+	GL_CHECK_PUSH_ERROR;
+	if(count <= 0) {
+		return false;
+	}
+	std::vector<GLint> sizesX(count), sizesY(count);
+	glGetInternalformativ(GL_TEXTURE_2D, header.format,
+			GL_VIRTUAL_PAGE_SIZE_X_ARB, count, sizesX.data());
+	glGetInternalformativ(GL_TEXTURE_2D, header.format,
+			GL_VIRTUAL_PAGE_SIZE_Y_ARB, count, sizesY.data());
+	GL_CHECK_PUSH_ERROR;
+	// pages of the file need to match pages of the hardware
+	int pageSizeIndex = -1;
+	for(int i=0; i<count; ++i) {
+		if(sizesX[i] == (GLint)header.tileSize
+				&& sizesY[i] == (GLint)header.tileSize) {
+			pageSizeIndex = i;
+			break;
+		}
+	}
+	if(pageSizeIndex < 0) {
+		return false;
+	}
+	if(!texture.SparseStorage2(TEXTURE_2D, header.width, header.height,
+				levels, (TextureSizedInternalFormat)header.format,
+				pageSizeIndex)) {
+		return false;
+	}
+	GLint numSparseLevels = 0;
+	glGetTextureParameteriv(texture.GetTexture(), GL_NUM_SPARSE_LEVELS_ARB,
+			&numSparseLevels);
+	GL_CHECK_PUSH_ERROR;
+	sparseLevels = std::min<uint32_t>(std::max(numSparseLevels, 0), levels);
+	texture.MinFilter(LINEAR_MIPMAP_LINEAR);
+	texture.MagFilter(MAG_LINEAR);
+	texture.WrapX(CLAMP_TOtEDGE);
+	texture.WrapY(CLAMP_TOtEDGE);
+	if(sparseLevels < levels) {
+		texture.CommitPages(sparseLevels, 0, 0, 0,
+				std::max(header.width>>sparseLevels, 1u),
+				std::max(header.height>>sparseLevels, 1u), 1, true);
+	}
+
+	minLod.Storage2(TEXTURE_2D, file.GetPagesX(0), file.GetPagesY(0), 1, R8UI);
+	freeSlots.resize(settings.cachePages);
+	for(uint32_t i=0; i<settings.cachePages; ++i) {
+		freeSlots[i] = settings.cachePages-1-i;
+	}
+	return true;
+}
+
+bool VirtualTexture::CreateSoftware() {
+	const VirtualTextureHeader& header = file.GetHeader();
+	const uint32_t slotSize = header.tileSize + 2*header.border;
+	const uint32_t pinned = pages.size() - file.GetFirstTile(levels-1);
+	const uint32_t slots = settings.cachePages + pinned;
+	GLint maxSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+	// page table stores slot coordinates in 8 bits
+	const uint32_t maxSlots = std::min<uint32_t>(maxSize / slotSize, 256);
+	slotsX = std::min<uint32_t>(ceil(sqrt((double)slots)), maxSlots);
+	const uint32_t slotsY = std::min((slots + slotsX - 1) / slotsX, maxSlots);
+	if(slotsX * slotsY <= pinned) {
+		GL_PUSH_CUSTOM_ERROR(-1, "Virtual texture cache exceeds maximum "
+				"texture size");
+		return false;
+	}
+	const uint32_t capacity = std::min(slots, slotsX * slotsY);
+	cache.Storage2(TEXTURE_2D, slotsX * slotSize, slotsY * slotSize, 1,
+			(TextureSizedInternalFormat)header.format);
+	cache.MinFilter(LINEAR);
+	cache.MagFilter(MAG_LINEAR);
+	cache.WrapX(CLAMP_TOtEDGE);
+	cache.WrapY(CLAMP_TOtEDGE);
+
+	pageTable.Storage2(TEXTURE_2D, file.GetPagesX(0), file.GetPagesY(0),
+			levels, RGBA8UI);
+	// fetched levels above base need mipmapped filter to be complete
+	pageTable.MinFilter(NEAREST_MIPMAP_NEAREST);
+
+	freeSlots.resize(capacity);
+	for(uint32_t i=0; i<capacity; ++i) {
+		freeSlots[i] = capacity-1-i;
+	}
+	return true;
+}
+
+void VirtualTexture::CreateFeedbackPass() {
+	if(dedupShader.Compile(DEDUP_GLSL)) {
+		return;
+	}
+	std::vector<uint32_t> firstTile(16, 0), pagesX(16, 0);
+	for(uint32_t level=0; level<levels; ++level) {
+		firstTile[level] = file.GetFirstTile(level);
+		pagesX[level] = file.GetPagesX(level);
+	}
+	dedupShader.SetUInt(dedupShader.GetUniformLocation("levels"), levels);
+	dedupShader.SetUInt(dedupShader.GetUniformLocation("tiles"),
+			(uint32_t)pages.size());
+	dedupShader.SetUInt(dedupShader.GetUniformLocation("maxRequests"),
+			settings.maxRequests);
+	dedupShader.SetUInt(dedupShader.GetUniformLocation("firstTile"),
+			firstTile);
+	dedupShader.SetUInt(dedupShader.GetUniformLocation("pagesX"), pagesX);
+
+	seen.Init((pages.size() + 31) / 32);
+	for(Readback& readback : readbacks) {
+		readback.requests.Init(1 + settings.maxRequests);
+	}
+}
+
+void VirtualTexture::GenerateGLSL() {
+	const VirtualTextureHeader& header = file.GetHeader();
+	glsl = "#define VT_LEVELS " + std::to_string(levels) + "u\n"
+		"#define VT_TILE_SIZE " + std::to_string(header.tileSize) + ".0\n"
+		"#define VT_SLOT_SIZE "
+		+ std::to_string(header.tileSize + 2*header.border) + ".0\n"
+		"#define VT_BORDER " + std::to_string(header.border) + ".0\n"
+		"#define VT_FEEDBACK_BIAS "
+		+ std::to_string(log2((double)std::max(settings.feedbackDivisor, 1u)))
+		+ "\n"
+		"const vec2 VT_SIZE = vec2(" + std::to_string(header.width) + ".0, "
+		+ std::to_string(header.height) + ".0);\n";
+	glsl += COMMON_GLSL;
+	glsl += sparse ? SPARSE_GLSL : SOFTWARE_GLSL;
+}
+
+void VirtualTexture::BeginFeedback(uint32_t screenWidth,
+		uint32_t screenHeight) {
+	const uint32_t divisor = std::max(settings.feedbackDivisor, 1u);
+	const uint32_t w = std::max(screenWidth / divisor, 1u);
+	const uint32_t h = std::max(screenHeight / divisor, 1u);
+	if(w != feedbackWidth || h != feedbackHeight) {
+		feedbackColor.Storage2(TEXTURE_2D, w, h, 1, R32UI);
+		feedbackDepth.Storage2(TEXTURE_2D, w, h, 1, DEPTH_COMPONENT32F);
+		feedbackFbo.AttachColor(&feedbackColor, 0, 0);
+		feedbackFbo.AttachDepth(&feedbackDepth);
+		feedbackWidth = w;
+		feedbackHeight = h;
+	}
+	feedbackFbo.Bind();
+	feedbackFbo.Viewport(0, 0, w, h);
+	const GLuint clearId[4] = {0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF};
+	const GLfloat clearDepth = 1.0f;
+	glClearNamedFramebufferuiv(feedbackFbo.FboId(), GL_COLOR, 0, clearId);
+	glClearNamedFramebufferfv(feedbackFbo.FboId(), GL_DEPTH, 0, &clearDepth);
+	GL_CHECK_PUSH_ERROR;
+}
+
+void VirtualTexture::EndFeedback() {
+	FBO::Unbind();
+	Readback& readback = readbacks[readbackHead];
+	// previous requests of this buffer were not read yet, skip the frame
+	if(readback.pending || dedupShader.GetProgram() == 0
+			|| feedbackWidth == 0) {
+		return;
+	}
+	const uint32_t zero = 0;
+	glClearNamedBufferData(seen.GetIdGL(), GL_R32UI, GL_RED_INTEGER,
+			GL_UNSIGNED_INT, &zero);
+	glClearNamedBufferSubData(readback.requests.GetIdGL(), GL_R32UI, 0,
+			sizeof(uint32_t), GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	GL_CHECK_PUSH_ERROR;
+	dedupShader.Use();
+	glBindTextureUnit(dedupShader.GetTextureUnit("feedback"),
+			feedbackColor.GetTexture());
+	seen.BindBufferBase(SHADER_STORAGE_BUFFER, 0);
+	readback.requests.BindBufferBase(SHADER_STORAGE_BUFFER, 1);
+	dedupShader.Dispatch((feedbackWidth+15)/16, (feedbackHeight+15)/16, 1);
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	GL_CHECK_PUSH_ERROR;
+	readback.fence.StartFence();
+	readback.pending = true;
+	readbackHead = (readbackHead + 1) % 2;
+}
+
+void VirtualTexture::Update() {
+	if(!opened) {
+		return;
+	}
+	++frame;
+	requestsLastFrame = 0;
+	uploadsLastFrame = 0;
+	evictionsLastFrame = 0;
+
+	// oldest readback first
+	std::vector<uint32_t> loads;
+	for(uint32_t i=0; i<2; ++i) {
+		Readback& readback = readbacks[(readbackHead + i) % 2];
+		if(!readback.pending || !readback.fence.IsDone()) {
+			continue;
+		}
+		readback.pending = false;
+		uint32_t count = 0;
+		readback.requests.Fetch(&count, 0, sizeof(uint32_t));
+		count = std::min(count, settings.maxRequests);
+		requestIds.resize(count);
+		if(count) {
+			readback.requests.Fetch(requestIds.data(), sizeof(uint32_t),
+					count * sizeof(uint32_t));
+		}
+		requestsLastFrame += count;
+		for(uint32_t id : requestIds) {
+			const uint32_t level = id >> 28;
+			const uint32_t y = (id >> 14) & 0x3FFF;
+			const uint32_t x = id & 0x3FFF;
+			if(level < levels && x < file.GetPagesX(level)
+					&& y < file.GetPagesY(level)) {
+				Request(PageIndex(level, x, y), loads);
+			}
+		}
+	}
+	if(loads.size()) {
+		// coarse pages first, finer ones are useless without them
+		std::sort(loads.begin(), loads.end(), std::greater<uint32_t>());
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.insert(jobs.end(), loads.begin(), loads.end());
+		}
+		jobsCondition.notify_one();
+	}
+
+	std::vector<LoadedTile> ready;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		while(loaded.size() && ready.size() < settings.uploadsPerFrame) {
+			ready.emplace_back(std::move(loaded.front()));
+			loaded.pop_front();
+		}
+	}
+	for(LoadedTile& tile : ready) {
+		Page& page = pages[tile.page];
+		--pendingCount;
+		if(!tile.ok) {
+			uint32_t level, x, y;
+			DecodePage(tile.page, level, x, y);
+			printf("\n ERROR::VIRTUAL_TEXTURE::TILE_NOT_READ: level %u, "
+					"page %u %u\n", level, x, y);
+			page.state = PAGE_FAILED;
+			continue;
+		}
+		// cache is full of pages used in this frame, requested again when
+		// still visible
+		if(!AllocateSlot(page.slot)) {
+			page.state = PAGE_EMPTY;
+			continue;
+		}
+		Upload(tile.page, tile.pixels.data());
+		page.state = PAGE_RESIDENT;
+		page.lru = lru.insert(lru.end(), tile.page);
+		++residentCount;
+		++uploadsLastFrame;
+		pageTableDirty = true;
+	}
+
+	if(pageTableDirty) {
+		UpdatePageTable();
+	}
+}
+
+void VirtualTexture::Bind(const Shader& shader) const {
+	const Texture* textures[2] = {&pageTable, &cache};
+	const char* names[2] = {"vtPageTable", "vtCache"};
+	if(sparse) {
+		textures[0] = &texture;
+		textures[1] = &minLod;
+		names[0] = "vtTexture";
+		names[1] = "vtMinLod";
+	}
+	for(int i=0; i<2; ++i) {
+		const int unit = shader.GetTextureUnit(names[i]);
+		if(unit >= 0) {
+			glBindTextureUnit(unit, textures[i]->GetTexture());
+		}
+	}
+	GL_CHECK_PUSH_ERROR;
+}
+
+uint32_t VirtualTexture::EncodePageId(uint32_t level, uint32_t x,
+		uint32_t y) {
+	return (level << 28) | (y << 14) | x;
+}
+
+void VirtualTexture::Run() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while(running) {
+		if(jobs.empty()) {
+			jobsCondition.wait(lock);
+			continue;
+		}
+		LoadedTile tile;
+		tile.page = jobs.front();
+		jobs.pop_front();
+		lock.unlock();
+		uint32_t level, x, y;
+		DecodePage(tile.page, level, x, y);
+		tile.pixels.resize(file.GetTileBytes());
+		tile.ok = file.ReadTile(level, x, y, tile.pixels.data());
+		lock.lock();
+		loaded.emplace_back(std::move(tile));
+	}
+}
+
+uint32_t VirtualTexture::PageIndex(uint32_t level, uint32_t x,
+		uint32_t y) const {
+	return file.GetFirstTile(level) + y * file.GetPagesX(level) + x;
+}
+
+void VirtualTexture::DecodePage(uint32_t page, uint32_t& level, uint32_t& x,
+		uint32_t& y) const {
+	level = 0;
+	while(file.GetFirstTile(level+1) <= page) {
+		++level;
+	}
+	const uint32_t i = page - file.GetFirstTile(level);
+	x = i % file.GetPagesX(level);
+	y = i / file.GetPagesX(level);
+}
+
+void VirtualTexture::Touch(uint32_t page) {
+	Page& p = pages[page];
+	p.lastUsed = frame;
+	if(p.state == PAGE_RESIDENT) {
+		lru.splice(lru.end(), lru, p.lru);
+	}
+}
+
+void VirtualTexture::Request(uint32_t page, std::vector<uint32_t>& loads) {
+	uint32_t level, x, y;
+	DecodePage(page, level, x, y);
+	// parents are touched after children, so they are evicted later
+	for(;;) {
+		const uint32_t index = PageIndex(level, x, y);
+		Touch(index);
+		if(pages[index].state == PAGE_EMPTY) {
+			pages[index].state = PAGE_LOADING;
+			++pendingCount;
+			loads.emplace_back(index);
+		}
+		if(level+1 >= levels) {
+			break;
+		}
+		++level;
+		x >>= 1;
+		y >>= 1;
+	}
+}
+
+bool VirtualTexture::AllocateSlot(uint32_t& slot) {
+	if(freeSlots.empty()) {
+		if(lru.empty() || pages[lru.front()].lastUsed == frame) {
+			return false;
+		}
+		Evict(lru.front());
+	}
+	slot = freeSlots.back();
+	freeSlots.pop_back();
+	return true;
+}
+
+void VirtualTexture::Evict(uint32_t page) {
+	Page& p = pages[page];
+	lru.erase(p.lru);
+	if(sparse) {
+		Commit(page, false);
+	}
+	freeSlots.emplace_back(p.slot);
+	p.slot = 0xFFFFFFFF;
+	p.state = PAGE_EMPTY;
+	--residentCount;
+	++evictionsLastFrame;
+	pageTableDirty = true;
+}
+
+void VirtualTexture::Upload(uint32_t page, const uint8_t* pixels) {
+	const VirtualTextureHeader& header = file.GetHeader();
+	const uint32_t slotSize = header.tileSize + 2*header.border;
+	if(sparse) {
+		uint32_t level, x, y;
+		DecodePage(page, level, x, y);
+		if(level < sparseLevels) {
+			Commit(page, true);
+		}
+		const uint32_t w = std::min(header.tileSize,
+				std::max(header.width>>level, 1u) - x*header.tileSize);
+		const uint32_t h = std::min(header.tileSize,
+				std::max(header.height>>level, 1u) - y*header.tileSize);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, slotSize);
+		texture.Update2(pixels + (header.border*slotSize + header.border)*4,
+				x*header.tileSize, y*header.tileSize, w, h, level, RGBA,
+				UNSIGNED_BYTE);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	} else {
+		const uint32_t slot = pages[page].slot;
+		cache.Update2(pixels, (slot % slotsX) * slotSize,
+				(slot / slotsX) * slotSize, slotSize, slotSize, 0, RGBA,
+				UNSIGNED_BYTE);
+	}
+}
+
+void VirtualTexture::Commit(uint32_t page, bool commit) {
+	const VirtualTextureHeader& header = file.GetHeader();
+	uint32_t level, x, y;
+	DecodePage(page, level, x, y);
+	const uint32_t w = std::min(header.tileSize,
+			std::max(header.width>>level, 1u) - x*header.tileSize);
+	const uint32_t h = std::min(header.tileSize,
+			std::max(header.height>>level, 1u) - y*header.tileSize);
+	texture.CommitPages(level, x*header.tileSize, y*header.tileSize, 0, w, h,
+			1, commit);
+}
+
+void VirtualTexture::UpdatePageTable() {
+	pageTableDirty = false;
+	// page is usable when it and all its parents are resident, otherwise
+	// it resolves to the finest usable parent
+	std::vector<uint32_t> resolved(pages.size());
+	std::vector<uint8_t> usable(pages.size());
+	for(int level=levels-1; level>=0; --level) {
+		const uint32_t pagesX = file.GetPagesX(level);
+		const uint32_t pagesY = file.GetPagesY(level);
+		for(uint32_t y=0; y<pagesY; ++y) {
+			for(uint32_t x=0; x<pagesX; ++x) {
+				const uint32_t index = PageIndex(level, x, y);
+				const bool resident = pages[index].state == PAGE_RESIDENT
+					|| pages[index].state == PAGE_PINNED;
+				if(level+1 == (int)levels) {
+					usable[index] = resident;
+					resolved[index] = index;
+					continue;
+				}
+				const uint32_t parent = PageIndex(level+1, x>>1, y>>1);
+				usable[index] = resident && usable[parent];
+				resolved[index] = usable[index] ? index : resolved[parent];
+			}
+		}
+	}
+
+	GLint alignment = 4;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	if(sparse) {
+		// bilinear footprint reaches neighbouring pages, LOD is clamped to
+		// the finest level with all 3x3 neighbours usable
+		std::vector<uint8_t> safe(pages.size());
+		for(uint32_t level=0; level<levels; ++level) {
+			const int pagesX = file.GetPagesX(level);
+			const int pagesY = file.GetPagesY(level);
+			for(int y=0; y<pagesY; ++y) {
+				for(int x=0; x<pagesX; ++x) {
+					bool all = true;
+					for(int ny=std::max(y-1, 0); ny<=std::min(y+1, pagesY-1);
+							++ny) {
+						for(int nx=std::max(x-1, 0);
+								nx<=std::min(x+1, pagesX-1); ++nx) {
+							all = all && usable[PageIndex(level, nx, ny)];
+						}
+					}
+					safe[PageIndex(level, x, y)] = all;
+				}
+			}
+		}
+		const uint32_t pagesX = file.GetPagesX(0);
+		const uint32_t pagesY = file.GetPagesY(0);
+		std::vector<uint8_t> data(pagesX * pagesY);
+		for(uint32_t y=0; y<pagesY; ++y) {
+			for(uint32_t x=0; x<pagesX; ++x) {
+				uint32_t level = 0;
+				while(level+1 < levels
+						&& !safe[PageIndex(level, x>>level, y>>level)]) {
+					++level;
+				}
+				data[y*pagesX + x] = level;
+			}
+		}
+		minLod.Update2(data.data(), 0, 0, pagesX, pagesY, 0, RED_INTEGER,
+				UNSIGNED_BYTE);
+	} else {
+		std::vector<uint8_t> data;
+		for(uint32_t level=0; level<levels; ++level) {
+			const uint32_t pagesX = file.GetPagesX(level);
+			const uint32_t pagesY = file.GetPagesY(level);
+			data.resize(pagesX * pagesY * 4);
+			for(uint32_t i=0; i<pagesX*pagesY; ++i) {
+				const uint32_t page = resolved[file.GetFirstTile(level) + i];
+				const uint32_t slot = pages[page].slot;
+				uint32_t resolvedLevel, x, y;
+				DecodePage(page, resolvedLevel, x, y);
+				data[i*4+0] = slot % slotsX;
+				data[i*4+1] = slot / slotsX;
+				data[i*4+2] = resolvedLevel;
+				data[i*4+3] = 0;
+			}
+			pageTable.Update2(data.data(), 0, 0, pagesX, pagesY, level,
+					RGBA_INTEGER, UNSIGNED_BYTE);
+		}
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+}
+
+} // namespace gl
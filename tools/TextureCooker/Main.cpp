@@ -0,0 +1,103 @@
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+
+#include "../../include/openglwrapper/TextureCooker.hpp"
+#include "../../include/openglwrapper/VirtualTexture.hpp"
+
+struct FormatName {
+	const char* name;
+	gl::TextureSizedInternalFormat format;
+} formats[] = {
+	{"rgba8", gl::RGBA8},
+	{"srgb8_alpha8", gl::SRGB8_ALPHA8},
+	{"bc1", gl::COMPRESSED_RGB_BC1},
+	{"bc1a", gl::COMPRESSED_RGBA_BC1},
+	{"bc1_srgb", gl::COMPRESSED_SRGB_BC1},
+	{"bc1a_srgb", gl::COMPRESSED_SRGB_ALPHA_BC1},
+	{"bc3", gl::COMPRESSED_RGBA_BC3},
+	{"bc3_srgb", gl::COMPRESSED_SRGB_ALPHA_BC3},
+	{"bc4", gl::COMPRESSED_RED_BC4},
+	{"bc5", gl::COMPRESSED_RG_BC5},
+};
+
+void PrintUsage(const char* name) {
+	printf("Usage: %s [options] <input image> <output.oglwtex>\n", name);
+	printf("Options:\n");
+	printf("  -f <format>   output format, default srgb8_alpha8:\n               ");
+	for(const FormatName& f : formats) {
+		printf(" %s", f.name);
+	}
+	printf("\n  -m <filter>   mip filter: box, kaiser (default)\n");
+	printf("  -n            do not generate mip levels\n");
+	printf("  -v <tile>     write tiled virtual texture with given tile size,\n"
+			"                format needs to be rgba8 or srgb8_alpha8\n");
+}
+
+int main(int argc, char** argv) {
+	gl::TextureCooker::Settings settings;
+	const char* input = nullptr;
+	const char* output = nullptr;
+	uint32_t virtualTileSize = 0;
+	for(int i=1; i<argc; ++i) {
+		if(!strcmp(argv[i], "-f") && i+1 < argc) {
+			const char* name = argv[++i];
+			bool found = false;
+			for(const FormatName& f : formats) {
+				if(!strcmp(f.name, name)) {
+					settings.format = f.format;
+					found = true;
+				}
+			}
+			if(!found) {
+				printf(" Unknown format: %s\n", name);
+				return 1;
+			}
+		} else if(!strcmp(argv[i], "-m") && i+1 < argc) {
+			const char* name = argv[++i];
+			if(!strcmp(name, "box")) {
+				settings.filter = gl::TextureCooker::MIP_FILTER_BOX;
+			} else if(!strcmp(name, "kaiser")) {
+				settings.filter = gl::TextureCooker::MIP_FILTER_KAISER;
+			} else {
+				printf(" Unknown mip filter: %s\n", name);
+				return 1;
+			}
+		} else if(!strcmp(argv[i], "-n")) {
+			settings.generateMipMap = false;
+		} else if(!strcmp(argv[i], "-v") && i+1 < argc) {
+			virtualTileSize = atoi(argv[++i]);
+		} else if(input == nullptr) {
+			input = argv[i];
+		} else if(output == nullptr) {
+			output = argv[i];
+		} else {
+			PrintUsage(argv[0]);
+			return 1;
+		}
+	}
+	if(output == nullptr) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+
+	gl::TextureCooker cooker;
+	if(!cooker.CookFile(input, settings)) {
+		return 1;
+	}
+	if(virtualTileSize) {
+		if(!gl::VirtualTextureFile::Write(output, cooker, virtualTileSize)) {
+			return 1;
+		}
+	} else if(!cooker.Write(output)) {
+		return 1;
+	}
+	uint64_t bytes = 0;
+	for(const std::vector<uint8_t>& level : cooker.GetLevels()) {
+		bytes += level.size();
+	}
+	printf(" %s -> %s: %ux%u, %u levels, %llu bytes\n", input, output,
+			cooker.GetWidth(), cooker.GetHeight(),
+			(uint32_t)cooker.GetLevels().size(), (unsigned long long)bytes);
+	return 0;
+}